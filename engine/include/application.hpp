@@ -2,8 +2,11 @@
 #include "device.hpp"
 #include "event.hpp"
 #include "frame_info.hpp"
+#include "gpu_profiler.hpp"
+#include "gpu_profiler_panel.hpp"
 #include "key_event.hpp"
 #include "renderer.hpp"
+#include "scene.hpp"
 #include "ui_manager.hpp"
 #include "util/logger.hpp"
 #include "window.hpp"
@@ -23,6 +26,12 @@ struct ApplicationConfig {
   int width;
   int height;
   std::string name;
+  /** Render offscreen without a window, surface or UI */
+  bool headless = false;
+  /** Stop after this many rendered frames, 0 runs until closed */
+  u64 frameLimit = 0;
+  /** Per frame scratch memory, see FrameAllocator */
+  vk::DeviceSize frameAllocatorSize = FrameAllocator::DEFAULT_REGION_SIZE;
 };
 
 class Application {
@@ -38,6 +47,18 @@ class Application {
 
   void registerPanel(std::unique_ptr<Panel> panel);
 
+  /**
+   * Replaces the scene rendered every frame, the previous one is destroyed
+   * once the GPU is done with it
+   */
+  void setScene(std::unique_ptr<Scene> scene);
+
+  /** Ends run() after the current frame */
+  void stop() { this->isRunning = false; }
+
+  Device& getDevice() { return this->device; }
+  Renderer& getRenderer() { return this->renderer; }
+
   void onEvent(KeyReleasedEvent& event);
 
  private:
@@ -48,6 +69,7 @@ class Application {
 
   std::unique_ptr<hep::DescriptorPool> imguiDescriptorPool;
   std::unique_ptr<UIManager> uiManager;
+  std::unique_ptr<Scene> scene;
 
   bool isRunning = true;
 };
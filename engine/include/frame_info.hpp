@@ -10,11 +10,24 @@
 
 namespace hep {
 
+class BindlessTable;
+class DescriptorAllocator;
+class FrameAllocator;
+class GpuProfiler;
+
 struct FrameInfo {
   u32 frameIndex;
   double elapsedTime;
   double deltaTime;
   glm::vec2 currentFramebufferExtent;
+  /** Optional, wrap GPU work in a GpuProfiler::Zone when set */
+  GpuProfiler* profiler = nullptr;
+  /** Sets allocated here are only valid until the frame is submitted */
+  DescriptorAllocator* descriptorAllocator = nullptr;
+  /** Scratch uniform/storage memory that lives until the frame retires */
+  FrameAllocator* frameAllocator = nullptr;
+  /** Set when the device supports bindless descriptors */
+  BindlessTable* bindless = nullptr;
 };
 
 }  // namespace hep
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include "frame_info.hpp"
+
+namespace hep {
+
+/**
+ * Client rendering hook driven by Application::run once per frame, see
+ * Application::setScene
+ */
+class Scene {
+ public:
+  Scene(const Scene&) = delete;
+  Scene& operator=(const Scene&) = delete;
+
+  Scene() = default;
+  virtual ~Scene() = default;
+
+  /** Before the swapchain pass begins, for compute and offscreen passes */
+  virtual void onPrepare(vk::CommandBuffer commandBuffer, FrameInfo frameInfo);
+
+  /** Inside the swapchain pass, before the UI */
+  virtual void onRender(vk::CommandBuffer commandBuffer, FrameInfo frameInfo);
+
+  /**
+   * Scenes returning eSecondaryCommandBuffers may only execute buffers from
+   * Renderer::recordSecondaryCommandBuffers in onRender, the UI isn't drawn
+   * for them
+   */
+  virtual vk::SubpassContents getSubpassContents() const {
+    return vk::SubpassContents::eInline;
+  }
+};
+
+}  // namespace hep
@@ -1,5 +1,10 @@
+#pragma once
+
+#include <filesystem>
 #include <fstream>
 #include <shaderc/shaderc.hpp>
+#include <string>
+#include <vector>
 
 #include "types.hpp"
 
@@ -7,19 +12,45 @@ namespace hep {
 
 enum class ShaderStage { VERTEX, FRAGMENT, COMPUTE };
 
+/** Preprocessor macro passed to the compiler, an empty value defines it */
+struct ShaderDefine {
+  std::string name;
+  std::string value;
+};
+
 class Shader {
  public:
+  static constexpr const char* DEFAULT_CACHE_DIRECTORY = "cache/shaders";
+
   Shader(const Shader&) = delete;
   Shader& operator=(const Shader&) = delete;
 
   Shader() = default;
   ~Shader() = default;
 
-  void compile(const std::string& path, ShaderStage shaderStage);
+  /**
+   * Compiles the GLSL file at path to SPIR-V
+   *
+   * Results are cached on disk under a hash of the source, stage, defines,
+   * compiler options and shaderc version, a warm start reads the SPIR-V
+   * back without running shaderc.
+   */
+  void compile(const std::string& path,
+               ShaderStage shaderStage,
+               const std::vector<ShaderDefine>& defines = {});
+
+  const std::vector<u32>& getSpirv() const { return this->spirv; }
+
+  /** An empty directory disables the cache */
+  void setCacheDirectory(std::filesystem::path directory) {
+    this->cacheDirectory = std::move(directory);
+  }
 
  private:
   shaderc_shader_kind stage;
   std::vector<u32> spirv;
+
+  std::filesystem::path cacheDirectory = DEFAULT_CACHE_DIRECTORY;
 };
 
 }  // namespace hep
@@ -1,12 +1,17 @@
 #include "application.hpp"
 
+#include "deletion_queue.hpp"
+
 namespace hep {
 
 Application::Application(const ApplicationConfig& config)
     : config{config},
-      window{config.width, config.height, config.name},
+      window{config.width, config.height, config.name, config.headless},
       device{this->window},
-      renderer{this->window, this->device} {
+      renderer{this->window, this->device, config.frameAllocatorSize} {
+  // ImGui needs a GLFW window to drive it
+  if (this->config.headless) { return; }
+
   this->imguiDescriptorPool =
       DescriptorPool::Builder(this->device)
           .addPoolSize(vk::DescriptorType::eCombinedImageSampler,
@@ -22,9 +27,17 @@ Application::Application(const ApplicationConfig& config)
           .setDocking(true)
           .setKeyboard(true)
           .build();
+
+  this->uiManager->registerPanel(
+      std::make_unique<GpuProfilerPanel>(this->renderer.getProfiler()));
 };
 
-Application::~Application() { this->device.waitIdle(); };
+Application::~Application() {
+  this->device.waitIdle();
+  this->scene.reset();
+  // Deferred deleters may call into ImGui, run them before it shuts down
+  this->device.getDeletionQueue().flushAll();
+};
 
 void Application::run() {
   auto startTime = std::chrono::high_resolution_clock::now();
@@ -33,8 +46,10 @@ void Application::run() {
   EventSystem::get().addListener<KeyReleasedEvent>(
       std::bind(&Application::onEvent, this, std::placeholders::_1));
 
+  u64 frameCount = 0;
+
   while (this->isRunning) {
-    glfwPollEvents();
+    if (!this->config.headless) { glfwPollEvents(); }
 
     auto newTime = std::chrono::high_resolution_clock::now();
     double deltaTime =
@@ -52,20 +67,48 @@ void Application::run() {
                            static_cast<float>(extent.height));
 
       FrameInfo frameInfo{this->renderer.getFrameIndex(), elapsedTime,
-                          deltaTime, extentVec2};
+                          deltaTime, extentVec2,
+                          &this->renderer.getProfiler(),
+                          &this->renderer.getDescriptorAllocator(),
+                          &this->renderer.getFrameAllocator(),
+                          this->renderer.getBindlessTable()};
 
       /* ---- BEGIN UPDATE ----*/
-      uiManager->updatePanels();
+      if (this->uiManager) { uiManager->updatePanels(); }
       /* ---- END UPDATE ----*/
 
-      this->renderer.beginSwapChainRenderPass(commandBuffer);
+      if (this->scene) { this->scene->onPrepare(commandBuffer, frameInfo); }
+
+      vk::SubpassContents contents = this->scene
+                                         ? this->scene->getSubpassContents()
+                                         : vk::SubpassContents::eInline;
+      this->renderer.beginSwapChainRenderPass(commandBuffer, contents);
 
       /* ---- BEGIN RENDER ---- */
-      uiManager->renderPanels(commandBuffer);
+      if (contents == vk::SubpassContents::eSecondaryCommandBuffers) {
+        this->scene->onRender(commandBuffer, frameInfo);
+      } else {
+        GpuProfiler::Zone zone{*frameInfo.profiler, commandBuffer,
+                               "swapchain pass"};
+
+        if (this->scene) { this->scene->onRender(commandBuffer, frameInfo); }
+
+        if (this->uiManager) {
+          GpuProfiler::Zone uiZone{*frameInfo.profiler, commandBuffer,
+                                   "imgui"};
+          uiManager->renderPanels(commandBuffer);
+        }
+      }
       /* ---- END RENDER ---- */
 
       this->renderer.endSwapChainRenderPass(commandBuffer);
       this->renderer.endFrame();
+
+      frameCount++;
+      if (this->config.frameLimit != 0 &&
+          frameCount >= this->config.frameLimit) {
+        this->isRunning = false;
+      }
     }
   }
 
@@ -75,9 +118,30 @@ void Application::run() {
   double totalRuntime =
       std::chrono::duration<double>(endTime - startTime).count();
   log::info("Application ran for", totalRuntime, "s");
+  log::info("Rendered", frameCount, "frames at",
+            static_cast<double>(frameCount) / totalRuntime, "fps");
+
+  DescriptorSetCache::Stats cacheStats =
+      this->renderer.getDescriptorSetCache().getStats();
+  log::info("Descriptor set cache:", cacheStats.hits, "hits,",
+            cacheStats.misses, "misses,", cacheStats.invalidations,
+            "invalidations");
+}
+
+void Application::setScene(std::unique_ptr<Scene> scene) {
+  if (this->scene) {
+    // A frame in flight may still reference the old scene's resources
+    this->device.waitIdle();
+  }
+  this->scene = std::move(scene);
 }
 
 void Application::registerPanel(std::unique_ptr<Panel> panel) {
+  if (!this->uiManager) {
+    log::warning("no UI in headless mode, dropping panel");
+    return;
+  }
+
   uiManager->registerPanel(std::move(panel));
 }
 
@@ -28,30 +28,31 @@ Buffer::Buffer(Device& device,
   alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
   bufferSize = alignmentSize * instanceCount;
   device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer,
-                      memory);
+                      allocation);
 }
 
 Buffer::~Buffer() {
   unmap();
-  this->device.get()->destroyBuffer(this->buffer);
-  this->device.get()->freeMemory(this->memory);
+  this->device.destroyBuffer(this->buffer, this->allocation);
 }
 
+/**
+ * Host visible allocations are persistently mapped by the Allocator, so
+ * mapping only hands out a pointer into that mapping
+ */
 vk::Result Buffer::map(vk::DeviceSize size, vk::DeviceSize offset) {
-  assert(buffer && memory && "Called map on buffer before create");
+  (void)size;
+  assert(buffer && allocation.isValid() &&
+         "Called map on buffer before create");
 
-  vk::MemoryMapFlags emptyFlag{};
-  return this->device.get()->mapMemory(this->memory, offset, size, emptyFlag,
-                                       &this->mapped);
-}
+  if (!this->allocation.mapped) { return vk::Result::eErrorMemoryMapFailed; }
 
-void Buffer::unmap() {
-  if (mapped) {
-    this->device.get()->unmapMemory(this->memory);
-    mapped = nullptr;
-  }
+  this->mapped = static_cast<char*>(this->allocation.mapped) + offset;
+  return vk::Result::eSuccess;
 }
 
+void Buffer::unmap() { mapped = nullptr; }
+
 void Buffer::writeToBuffer(void* data,
                            vk::DeviceSize size,
                            vk::DeviceSize offset) {
@@ -68,17 +69,17 @@ void Buffer::writeToBuffer(void* data,
 
 vk::Result Buffer::flush(vk::DeviceSize size, vk::DeviceSize offset) {
   vk::MappedMemoryRange mappedRange = {};
-  mappedRange.memory = memory;
-  mappedRange.offset = offset;
-  mappedRange.size = size;
+  mappedRange.memory = allocation.memory;
+  mappedRange.offset = allocation.offset + offset;
+  mappedRange.size = size == VK_WHOLE_SIZE ? allocation.size - offset : size;
   return this->device.get()->flushMappedMemoryRanges(1, &mappedRange);
 }
 
 vk::Result Buffer::invalidate(vk::DeviceSize size, vk::DeviceSize offset) {
   vk::MappedMemoryRange mappedRange = {};
-  mappedRange.memory = memory;
-  mappedRange.offset = offset;
-  mappedRange.size = size;
+  mappedRange.memory = allocation.memory;
+  mappedRange.offset = allocation.offset + offset;
+  mappedRange.size = size == VK_WHOLE_SIZE ? allocation.size - offset : size;
   return this->device.get()->invalidateMappedMemoryRanges(1, &mappedRange);
 }
 
@@ -44,7 +44,7 @@ class Buffer {
   void* getMappedMemory() const { return mapped; }
   uint32_t getInstanceCount() const { return instanceCount; }
   vk::DeviceSize getInstanceSize() const { return instanceSize; }
-  vk::DeviceSize getAlignmentSize() const { return instanceSize; }
+  vk::DeviceSize getAlignmentSize() const { return alignmentSize; }
   vk::BufferUsageFlags getUsageFlags() const { return usageFlags; }
   vk::MemoryPropertyFlags getMemoryPropertyFlags() const {
     return memoryPropertyFlags;
@@ -58,7 +58,7 @@ class Buffer {
   Device& device;
   void* mapped = nullptr;
   vk::Buffer buffer = VK_NULL_HANDLE;
-  vk::DeviceMemory memory = VK_NULL_HANDLE;
+  Allocation allocation;
 
   vk::DeviceSize bufferSize;
   uint32_t instanceCount;
@@ -0,0 +1,43 @@
+#include "compute_pipeline.hpp"
+
+#include "util/logger.hpp"
+
+namespace hep {
+
+ComputePipeline::ComputePipeline(Device& device,
+                                 const std::string& shaderFilename,
+                                 vk::PipelineLayout pipelineLayout)
+    : device{device}, pipelineLayout{pipelineLayout} {
+  vk::UniqueShaderModule shaderModule =
+      this->device.createShaderModule(shaderFilename);
+
+  vk::ComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.stage = vk::PipelineShaderStageCreateInfo{
+      vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eCompute,
+      shaderModule.get(), "main"};
+  pipelineInfo.layout = pipelineLayout;
+
+  try {
+    this->computePipeline =
+        this->device.get()
+            ->createComputePipeline(this->device.getPipelineCache(),
+                                    pipelineInfo)
+            .value;
+    log::trace("created compute vk::Pipeline");
+  } catch (const vk::SystemError& err) {
+    log::fatal("failed to create compute vk::Pipeline");
+    throw std::runtime_error("failed to create compute vk::Pipeline");
+  }
+}
+
+ComputePipeline::~ComputePipeline() {
+  this->device.get()->destroyPipeline(this->computePipeline);
+  log::trace("destroyed compute vk::Pipeline");
+}
+
+void ComputePipeline::bind(vk::CommandBuffer commandBuffer) {
+  commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute,
+                             this->computePipeline);
+}
+
+}  // namespace hep
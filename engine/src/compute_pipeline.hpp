@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vulkan/vulkan.hpp>
+
+#include "device.hpp"
+#include "types.hpp"
+
+namespace hep {
+
+class ComputePipeline {
+ public:
+  ComputePipeline(const ComputePipeline&) = delete;
+  ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+  /**
+   * @param pipelineLayout not owned, usually from the LayoutCache
+   */
+  ComputePipeline(Device& device,
+                  const std::string& shaderFilename,
+                  vk::PipelineLayout pipelineLayout);
+  ~ComputePipeline();
+
+  void bind(vk::CommandBuffer commandBuffer);
+
+  vk::PipelineLayout getPipelineLayout() const { return this->pipelineLayout; }
+
+ private:
+  Device& device;
+  vk::PipelineLayout pipelineLayout;
+  vk::Pipeline computePipeline;
+};
+
+}  // namespace hep
@@ -0,0 +1,99 @@
+#include "deletion_queue.hpp"
+
+#include <vector>
+
+#include "device.hpp"
+#include "swapchain.hpp"
+#include "util/hash.hpp"
+
+namespace hep {
+
+DeletionQueue::DeletionQueue(Device& device) : device{device} {}
+
+DeletionQueue::~DeletionQueue() { flushAll(); }
+
+void DeletionQueue::push(std::function<void()> deleter) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->entries.push_back({this->frameSerial, std::move(deleter)});
+}
+
+void DeletionQueue::destroyBuffer(vk::Buffer buffer, Allocation allocation) {
+  // Notify right away so caches stop handing out the handle while it waits
+  this->device.notifyResourceDestroyed(handleKey(buffer));
+  push([this, buffer, allocation]() mutable {
+    this->device.destroyBuffer(buffer, allocation);
+  });
+}
+
+void DeletionQueue::destroyImage(vk::Image image, Allocation allocation) {
+  push([this, image, allocation]() mutable {
+    this->device.destroyImage(image, allocation);
+  });
+}
+
+void DeletionQueue::destroyImageView(vk::ImageView imageView) {
+  this->device.notifyResourceDestroyed(handleKey(imageView));
+  push([this, imageView]() {
+    this->device.get()->destroyImageView(imageView);
+  });
+}
+
+void DeletionQueue::destroyFramebuffer(vk::Framebuffer framebuffer) {
+  push([this, framebuffer]() {
+    this->device.get()->destroyFramebuffer(framebuffer);
+  });
+}
+
+void DeletionQueue::destroyRenderPass(vk::RenderPass renderPass) {
+  push([this, renderPass]() {
+    this->device.get()->destroyRenderPass(renderPass);
+  });
+}
+
+void DeletionQueue::destroySampler(vk::Sampler sampler) {
+  this->device.notifyResourceDestroyed(handleKey(sampler));
+  push([this, sampler]() { this->device.get()->destroySampler(sampler); });
+}
+
+void DeletionQueue::freeDescriptorSet(vk::DescriptorPool pool,
+                                      vk::DescriptorSet set) {
+  push([this, pool, set]() {
+    this->device.get()->freeDescriptorSets(pool, set);
+  });
+}
+
+void DeletionQueue::beginFrame() {
+  std::vector<std::function<void()>> ready;
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->frameSerial++;
+
+    while (!this->entries.empty() &&
+           this->entries.front().frameSerial +
+                   Swapchain::MAX_FRAMES_IN_FLIGHT <=
+               this->frameSerial) {
+      ready.push_back(std::move(this->entries.front().deleter));
+      this->entries.pop_front();
+    }
+  }
+
+  // Run outside the lock, deleters may retire further resources
+  for (auto& deleter : ready) { deleter(); }
+}
+
+void DeletionQueue::flushAll() {
+  while (true) {
+    std::deque<Entry> pending;
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      if (this->entries.empty()) { return; }
+      pending.swap(this->entries);
+    }
+
+    for (auto& entry : pending) { entry.deleter(); }
+  }
+}
+
+}  // namespace hep
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vulkan/vulkan.hpp>
+
+#include "memory/allocator.hpp"
+#include "types.hpp"
+
+namespace hep {
+
+class Device;
+
+/**
+ * Defers destruction of GPU resources until no frame in flight can still
+ * reference them
+ *
+ * Every retired resource is tagged with the current frame serial. The
+ * Renderer advances the serial in beginFrame, after the frame's fence has
+ * been waited on; a resource retired during frame N is destroyed once frame
+ * N + MAX_FRAMES_IN_FLIGHT begins, which is the first point at which frame
+ * N is known to have finished executing.
+ *
+ * @note thread safe
+ */
+class DeletionQueue {
+ public:
+  DeletionQueue(const DeletionQueue&) = delete;
+  DeletionQueue& operator=(const DeletionQueue&) = delete;
+
+  DeletionQueue(Device& device);
+  ~DeletionQueue();
+
+  /**
+   * deleter runs once the current frame has retired, captured objects are
+   * kept alive until then
+   */
+  void push(std::function<void()> deleter);
+
+  void destroyBuffer(vk::Buffer buffer, Allocation allocation);
+  void destroyImage(vk::Image image, Allocation allocation);
+  void destroyImageView(vk::ImageView imageView);
+  void destroyFramebuffer(vk::Framebuffer framebuffer);
+  void destroyRenderPass(vk::RenderPass renderPass);
+  void destroySampler(vk::Sampler sampler);
+  void freeDescriptorSet(vk::DescriptorPool pool, vk::DescriptorSet set);
+
+  /**
+   * Advances the frame serial and runs every deleter whose frame has
+   * retired. Called by the Renderer once per frame.
+   */
+  void beginFrame();
+
+  /** Runs every pending deleter, the device must be idle */
+  void flushAll();
+
+  u64 getFrameSerial() const { return this->frameSerial; }
+
+ private:
+  struct Entry {
+    u64 frameSerial;
+    std::function<void()> deleter;
+  };
+
+  Device& device;
+
+  std::mutex mutex;
+  std::deque<Entry> entries;
+  u64 frameSerial = 0;
+};
+
+}  // namespace hep
@@ -0,0 +1,217 @@
+#include "bindless_table.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include "deletion_queue.hpp"
+#include "layout_cache.hpp"
+#include "swapchain.hpp"
+#include "util/logger.hpp"
+
+namespace hep {
+
+BindlessTable::BindlessTable(Device& device) : device{device} {
+  assert(this->device.isBindlessEnabled() &&
+         "BindlessTable needs descriptor indexing");
+
+  vk::PhysicalDeviceVulkan12Properties limits =
+      this->device.getVulkan12Properties();
+
+  this->images.capacity = std::min(
+      {MAX_SAMPLED_IMAGES, limits.maxDescriptorSetUpdateAfterBindSampledImages,
+       limits.maxPerStageDescriptorUpdateAfterBindSampledImages});
+  this->samplers.capacity = std::min(
+      {MAX_SAMPLERS, limits.maxDescriptorSetUpdateAfterBindSamplers,
+       limits.maxPerStageDescriptorUpdateAfterBindSamplers});
+  this->buffers.capacity =
+      std::min({MAX_STORAGE_BUFFERS,
+                limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+
+  createLayouts();
+  createDescriptorSet();
+
+  log::verbose("Bindless table:", this->images.capacity, "images,",
+               this->samplers.capacity, "samplers,", this->buffers.capacity,
+               "storage buffers");
+}
+
+// Layouts belong to the LayoutCache, the set goes with its pool
+BindlessTable::~BindlessTable() {}
+
+u32 BindlessTable::registerImage(vk::ImageView imageView,
+                                 vk::ImageLayout imageLayout) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  u32 index = acquireSlot(this->images);
+  if (index == INVALID_INDEX) { return index; }
+
+  vk::DescriptorImageInfo imageInfo{};
+  imageInfo.imageView = imageView;
+  imageInfo.imageLayout = imageLayout;
+
+  vk::WriteDescriptorSet write{};
+  write.dstSet = this->set;
+  write.dstBinding = SAMPLED_IMAGE_BINDING;
+  write.dstArrayElement = index;
+  write.descriptorType = vk::DescriptorType::eSampledImage;
+  write.descriptorCount = 1;
+  write.pImageInfo = &imageInfo;
+
+  this->device.get()->updateDescriptorSets(write, nullptr);
+  return index;
+}
+
+u32 BindlessTable::registerSampler(vk::Sampler sampler) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  u32 index = acquireSlot(this->samplers);
+  if (index == INVALID_INDEX) { return index; }
+
+  vk::DescriptorImageInfo imageInfo{};
+  imageInfo.sampler = sampler;
+
+  vk::WriteDescriptorSet write{};
+  write.dstSet = this->set;
+  write.dstBinding = SAMPLER_BINDING;
+  write.dstArrayElement = index;
+  write.descriptorType = vk::DescriptorType::eSampler;
+  write.descriptorCount = 1;
+  write.pImageInfo = &imageInfo;
+
+  this->device.get()->updateDescriptorSets(write, nullptr);
+  return index;
+}
+
+u32 BindlessTable::registerBuffer(vk::Buffer buffer,
+                                  vk::DeviceSize offset,
+                                  vk::DeviceSize range) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  u32 index = acquireSlot(this->buffers);
+  if (index == INVALID_INDEX) { return index; }
+
+  vk::DescriptorBufferInfo bufferInfo{};
+  bufferInfo.buffer = buffer;
+  bufferInfo.offset = offset;
+  bufferInfo.range = range;
+
+  vk::WriteDescriptorSet write{};
+  write.dstSet = this->set;
+  write.dstBinding = STORAGE_BUFFER_BINDING;
+  write.dstArrayElement = index;
+  write.descriptorType = vk::DescriptorType::eStorageBuffer;
+  write.descriptorCount = 1;
+  write.pBufferInfo = &bufferInfo;
+
+  this->device.get()->updateDescriptorSets(write, nullptr);
+  return index;
+}
+
+void BindlessTable::releaseImage(u32 index) {
+  releaseSlot(this->images, index);
+}
+
+void BindlessTable::releaseSampler(u32 index) {
+  releaseSlot(this->samplers, index);
+}
+
+void BindlessTable::releaseBuffer(u32 index) {
+  releaseSlot(this->buffers, index);
+}
+
+void BindlessTable::bind(vk::CommandBuffer commandBuffer,
+                         vk::PipelineBindPoint bindPoint) {
+  commandBuffer.bindDescriptorSets(bindPoint, this->pipelineLayout, 0,
+                                   this->set, nullptr);
+}
+
+void BindlessTable::createLayouts() {
+  vk::ShaderStageFlags stages = vk::ShaderStageFlagBits::eAll;
+
+  std::vector<vk::DescriptorSetLayoutBinding> bindings = {
+      {SAMPLED_IMAGE_BINDING, vk::DescriptorType::eSampledImage,
+       this->images.capacity, stages},
+      {SAMPLER_BINDING, vk::DescriptorType::eSampler, this->samplers.capacity,
+       stages},
+      {STORAGE_BUFFER_BINDING, vk::DescriptorType::eStorageBuffer,
+       this->buffers.capacity, stages},
+  };
+
+  // Unused slots may hold stale or no descriptors, and slots not read by
+  // pending work may be rewritten while the set is bound
+  vk::DescriptorBindingFlags bindingFlags =
+      vk::DescriptorBindingFlagBits::ePartiallyBound |
+      vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+      vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+
+  LayoutCache& layoutCache = this->device.getLayoutCache();
+
+  this->layout = layoutCache.getDescriptorSetLayout(
+      bindings, vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool,
+      {bindingFlags, bindingFlags, bindingFlags});
+
+  vk::PushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = stages;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = PUSH_CONSTANT_SIZE;
+
+  this->pipelineLayout =
+      layoutCache.getPipelineLayout({this->layout}, {pushConstantRange});
+}
+
+void BindlessTable::createDescriptorSet() {
+  this->pool =
+      DescriptorPool::Builder(this->device)
+          .setMaxSets(1)
+          .setPoolFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind)
+          .addPoolSize(vk::DescriptorType::eSampledImage, this->images.capacity)
+          .addPoolSize(vk::DescriptorType::eSampler, this->samplers.capacity)
+          .addPoolSize(vk::DescriptorType::eStorageBuffer,
+                       this->buffers.capacity)
+          .build();
+
+  if (!this->pool->allocateDescriptorSet(this->layout, this->set)) {
+    log::fatal("failed to allocate bindless descriptor set");
+    throw std::runtime_error("failed to allocate bindless descriptor set");
+  }
+}
+
+u32 BindlessTable::acquireSlot(Slots& slots) {
+  // Same rule as the DeletionQueue, a slot released during frame N is safe
+  // to rewrite once frame N + MAX_FRAMES_IN_FLIGHT has begun
+  u64 frameSerial = this->device.getDeletionQueue().getFrameSerial();
+  while (!slots.retired.empty() &&
+         slots.retired.front().frameSerial + Swapchain::MAX_FRAMES_IN_FLIGHT <=
+             frameSerial) {
+    slots.free.push_back(slots.retired.front().index);
+    slots.retired.pop_front();
+  }
+
+  if (!slots.free.empty()) {
+    u32 index = slots.free.back();
+    slots.free.pop_back();
+    return index;
+  }
+
+  if (slots.next == slots.capacity) {
+    log::error("bindless table is out of", slots.name, "slots");
+    return INVALID_INDEX;
+  }
+
+  return slots.next++;
+}
+
+void BindlessTable::releaseSlot(Slots& slots, u32 index) {
+  if (index == INVALID_INDEX) { return; }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+  assert(index < slots.next && "releasing a slot that was never handed out");
+
+  // Frames in flight may still index the old descriptor
+  slots.retired.push_back(
+      {this->device.getDeletionQueue().getFrameSerial(), index});
+}
+
+}  // namespace hep
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "descriptor_pool.hpp"
+#include "device.hpp"
+
+namespace hep {
+
+/**
+ * One global descriptor set holding every sampled image, sampler and
+ * storage buffer in large partially bound, update after bind arrays
+ *
+ * Registering a resource writes it into a free slot and returns the slot
+ * index, which stays valid until released. Shaders include bindless.glsl
+ * and index the arrays with values passed through push constants, so a
+ * single bind() per command buffer replaces per draw descriptor sets.
+ * Released slots are only reused once no frame in flight can still read
+ * them.
+ *
+ * Requires Device::isBindlessEnabled()
+ *
+ * @note thread safe
+ */
+class BindlessTable {
+ public:
+  BindlessTable(const BindlessTable&) = delete;
+  BindlessTable& operator=(const BindlessTable&) = delete;
+
+  static constexpr u32 INVALID_INDEX = ~0u;
+
+  // Must match bindless.glsl
+  static constexpr u32 SAMPLED_IMAGE_BINDING = 0;
+  static constexpr u32 SAMPLER_BINDING = 1;
+  static constexpr u32 STORAGE_BUFFER_BINDING = 2;
+
+  // Upper bounds, lowered to the device's update after bind limits
+  static constexpr u32 MAX_SAMPLED_IMAGES = 16384;
+  static constexpr u32 MAX_SAMPLERS = 256;
+  static constexpr u32 MAX_STORAGE_BUFFERS = 16384;
+
+  /** Every bindless pipeline layout gets the guaranteed 128 bytes */
+  static constexpr u32 PUSH_CONSTANT_SIZE = 128;
+
+  BindlessTable(Device& device);
+  ~BindlessTable();
+
+  u32 registerImage(
+      vk::ImageView imageView,
+      vk::ImageLayout imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
+  u32 registerSampler(vk::Sampler sampler);
+  u32 registerBuffer(vk::Buffer buffer,
+                     vk::DeviceSize offset = 0,
+                     vk::DeviceSize range = VK_WHOLE_SIZE);
+
+  void releaseImage(u32 index);
+  void releaseSampler(u32 index);
+  void releaseBuffer(u32 index);
+
+  /** Binds the table as set 0 of getPipelineLayout() */
+  void bind(vk::CommandBuffer commandBuffer,
+            vk::PipelineBindPoint bindPoint = vk::PipelineBindPoint::eGraphics);
+
+  vk::DescriptorSetLayout getDescriptorSetLayout() const {
+    return this->layout;
+  }
+
+  /**
+   * Table as set 0 plus PUSH_CONSTANT_SIZE bytes of push constants for all
+   * stages, shared through the LayoutCache
+   */
+  vk::PipelineLayout getPipelineLayout() const { return this->pipelineLayout; }
+
+ private:
+  struct RetiredSlot {
+    u64 frameSerial;
+    u32 index;
+  };
+
+  struct Slots {
+    const char* name;
+    u32 capacity;
+    u32 next = 0;
+    std::vector<u32> free;
+    // Released slots wait here until their frame has retired
+    std::deque<RetiredSlot> retired;
+  };
+
+  void createLayouts();
+  void createDescriptorSet();
+
+  u32 acquireSlot(Slots& slots);
+  void releaseSlot(Slots& slots, u32 index);
+
+  Device& device;
+
+  std::unique_ptr<DescriptorPool> pool;
+  vk::DescriptorSetLayout layout;
+  vk::PipelineLayout pipelineLayout;
+  vk::DescriptorSet set;
+
+  std::mutex mutex;
+  Slots images{"sampled image"};
+  Slots samplers{"sampler"};
+  Slots buffers{"storage buffer"};
+};
+
+}  // namespace hep
@@ -0,0 +1,123 @@
+#include "descriptor_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+#include "util/logger.hpp"
+
+namespace hep {
+
+DescriptorAllocator::Builder& DescriptorAllocator::Builder::addPoolRatio(
+    vk::DescriptorType descriptorType,
+    float descriptorsPerSet) {
+  this->ratios.push_back({descriptorType, descriptorsPerSet});
+  return *this;
+}
+
+DescriptorAllocator::Builder& DescriptorAllocator::Builder::setFrameCount(
+    u32 count) {
+  this->frameCount = count;
+  return *this;
+}
+
+DescriptorAllocator::Builder&
+DescriptorAllocator::Builder::setInitialSetsPerPool(u32 count) {
+  this->initialSetsPerPool = count;
+  return *this;
+}
+
+std::unique_ptr<DescriptorAllocator> DescriptorAllocator::Builder::build()
+    const {
+  return std::make_unique<DescriptorAllocator>(
+      this->device, this->frameCount, this->initialSetsPerPool, this->ratios);
+}
+
+DescriptorAllocator::DescriptorAllocator(Device& device,
+                                         u32 frameCount,
+                                         u32 initialSetsPerPool,
+                                         const std::vector<PoolRatio>& ratios)
+    : device{device},
+      ratios{ratios},
+      frames(frameCount) {
+  assert(frameCount > 0 && "DescriptorAllocator needs at least one frame");
+
+  for (auto& frame : this->frames) {
+    frame.setsPerPool = std::max(initialSetsPerPool, 1u);
+  }
+}
+
+void DescriptorAllocator::beginFrame(u32 frameIndex) {
+  assert(frameIndex < this->frames.size() && "frameIndex out of range");
+
+  this->currentFrame = frameIndex;
+
+  FramePools& frame = this->frames[frameIndex];
+  for (auto& pool : frame.pools) { pool->resetPool(); }
+  frame.activePool = 0;
+}
+
+bool DescriptorAllocator::allocate(vk::DescriptorSetLayout layout,
+                                   vk::DescriptorSet& set) {
+  FramePools& frame = this->frames[this->currentFrame];
+
+  // A fresh pool is only tried once, a set that does not fit into an empty
+  // pool never will
+  bool triedFreshPool = false;
+
+  while (true) {
+    if (frame.activePool == frame.pools.size()) {
+      // Every pool the frame has ran out, it needs more than before. Grow
+      // the new one so the pool count per frame stays small.
+      if (!frame.pools.empty()) {
+        frame.setsPerPool =
+            std::min(frame.setsPerPool * 2, MAX_SETS_PER_POOL);
+      }
+
+      frame.pools.push_back(createPool(frame.setsPerPool));
+      triedFreshPool = true;
+    }
+
+    vk::Result result =
+        frame.pools[frame.activePool]->tryAllocateDescriptorSet(layout, set);
+
+    if (result == vk::Result::eSuccess) { return true; }
+
+    if (result != vk::Result::eErrorOutOfPoolMemory &&
+        result != vk::Result::eErrorFragmentedPool) {
+      log::fatal("failed to allocate descriptor set. Error: ",
+                 vk::to_string(result));
+      throw std::runtime_error("failed to allocate descriptor set");
+    }
+
+    if (triedFreshPool) {
+      log::error("descriptor set layout does not fit into an empty pool");
+      return false;
+    }
+
+    frame.activePool++;
+  }
+}
+
+u32 DescriptorAllocator::getPoolCount() const {
+  size_t count = 0;
+  for (const auto& frame : this->frames) { count += frame.pools.size(); }
+  return static_cast<u32>(count);
+}
+
+std::unique_ptr<DescriptorPool> DescriptorAllocator::createPool(
+    u32 setsPerPool) {
+  DescriptorPool::Builder builder{this->device};
+  builder.setMaxSets(setsPerPool);
+
+  for (const auto& ratio : this->ratios) {
+    u32 count =
+        static_cast<u32>(std::ceil(ratio.descriptorsPerSet * setsPerPool));
+    builder.addPoolSize(ratio.type, std::max(count, 1u));
+  }
+
+  return builder.build();
+}
+
+}  // namespace hep
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "descriptor_pool.hpp"
+#include "device.hpp"
+
+namespace hep {
+
+/**
+ * Hands out transient descriptor sets from a growable list of
+ * DescriptorPools per frame in flight
+ *
+ * Allocation goes to the frame's active pool, when that pool runs out the
+ * next one is used and a new pool is created only if the list is exhausted.
+ * beginFrame resets every pool of a frame in one call, so sets must not be
+ * kept past the frame they were allocated in.
+ *
+ * @note not thread safe
+ */
+class DescriptorAllocator {
+ public:
+  DescriptorAllocator(const DescriptorAllocator&) = delete;
+  DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+  /** Descriptors of type reserved in each pool per set it can hold */
+  struct PoolRatio {
+    vk::DescriptorType type;
+    float descriptorsPerSet;
+  };
+
+  class Builder {
+   public:
+    Builder(Device& device) : device{device} {}
+
+    Builder& addPoolRatio(vk::DescriptorType descriptorType,
+                          float descriptorsPerSet);
+    Builder& setFrameCount(u32 count);
+    Builder& setInitialSetsPerPool(u32 count);
+    std::unique_ptr<DescriptorAllocator> build() const;
+
+   private:
+    Device& device;
+    std::vector<PoolRatio> ratios{};
+    u32 frameCount = 1;
+    u32 initialSetsPerPool = 256;
+  };
+
+  /** Upper bound for the size of newly created pools */
+  static constexpr u32 MAX_SETS_PER_POOL = 4096;
+
+  DescriptorAllocator(Device& device,
+                      u32 frameCount,
+                      u32 initialSetsPerPool,
+                      const std::vector<PoolRatio>& ratios);
+
+  /**
+   * Resets all pools of frameIndex, the frame's fence must have signaled
+   */
+  void beginFrame(u32 frameIndex);
+
+  bool allocate(vk::DescriptorSetLayout layout, vk::DescriptorSet& set);
+
+  u32 getPoolCount() const;
+
+ private:
+  struct FramePools {
+    std::vector<std::unique_ptr<DescriptorPool>> pools;
+    size_t activePool = 0;
+    // Size of the frame's newest pool, doubled whenever all of them ran out
+    u32 setsPerPool = 0;
+  };
+
+  std::unique_ptr<DescriptorPool> createPool(u32 setsPerPool);
+
+  Device& device;
+  std::vector<PoolRatio> ratios;
+  std::vector<FramePools> frames;
+
+  u32 currentFrame = 0;
+};
+
+}  // namespace hep
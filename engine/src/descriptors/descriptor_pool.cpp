@@ -53,20 +53,21 @@ DescriptorPool::~DescriptorPool() {
 bool DescriptorPool::allocateDescriptorSet(
     const vk::DescriptorSetLayout descriptorSetLayout,
     vk::DescriptorSet& descriptor) const {
+  // DescriptorAllocator handles the case of a full pool by moving on to a
+  // new one, use it for sets that only live for a frame
+  return tryAllocateDescriptorSet(descriptorSetLayout, descriptor) ==
+         vk::Result::eSuccess;
+}
+
+vk::Result DescriptorPool::tryAllocateDescriptorSet(
+    const vk::DescriptorSetLayout descriptorSetLayout,
+    vk::DescriptorSet& descriptor) const {
   vk::DescriptorSetAllocateInfo allocInfo{};
   allocInfo.descriptorPool = descriptorPool;
   allocInfo.pSetLayouts = &descriptorSetLayout;
   allocInfo.descriptorSetCount = 1;
 
-  // Might want to create a "DescriptorPoolManager" class that handles this
-  // case, and builds a new pool whenever an old pool fills up. But this is
-  // beyond our current scope
-  vk::Result result =
-      this->device.get()->allocateDescriptorSets(&allocInfo, &descriptor);
-
-  if (result == vk::Result::eSuccess) { return true; }
-
-  return false;
+  return this->device.get()->allocateDescriptorSets(&allocInfo, &descriptor);
 }
 
 void DescriptorPool::freeDescriptors(
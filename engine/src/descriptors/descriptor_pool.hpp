@@ -37,6 +37,14 @@ class DescriptorPool {
   bool allocateDescriptorSet(const vk::DescriptorSetLayout descriptorSetLayout,
                              vk::DescriptorSet& descriptor) const;
 
+  /**
+   * Same as allocateDescriptorSet but hands back the result, so callers can
+   * tell a full pool (eErrorOutOfPoolMemory, eErrorFragmentedPool) apart
+   */
+  vk::Result tryAllocateDescriptorSet(
+      const vk::DescriptorSetLayout descriptorSetLayout,
+      vk::DescriptorSet& descriptor) const;
+
   void freeDescriptors(std::vector<vk::DescriptorSet>& descriptors) const;
 
   void resetPool();
@@ -0,0 +1,246 @@
+#include "descriptor_set_cache.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "deletion_queue.hpp"
+#include "util/logger.hpp"
+
+namespace hep {
+
+DescriptorSetCache::DescriptorSetCache(Device& device, u32 setsPerPool)
+    : device{device}, setsPerPool{std::max(setsPerPool, 1u)} {
+  this->resourceCallbackId = this->device.addResourceDestroyedCallback(
+      [this](u64 handle) { invalidate(handle); });
+}
+
+DescriptorSetCache::~DescriptorSetCache() {
+  this->device.removeResourceDestroyedCallback(this->resourceCallbackId);
+
+  // Sets released earlier are still queued for freeing, destroy the pools
+  // behind them so the queue never touches a dead pool
+  DeletionQueue& deletionQueue = this->device.getDeletionQueue();
+  for (auto& pool : this->pools) {
+    std::shared_ptr<DescriptorPool> retired = std::move(pool);
+    deletionQueue.push([retired]() {});
+  }
+}
+
+bool DescriptorSetCache::getOrCreate(
+    vk::DescriptorSetLayout layout,
+    const std::vector<vk::WriteDescriptorSet>& writes,
+    vk::DescriptorSet& set) {
+  HashKey key = makeKey(layout, writes);
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  auto found = this->entries.find(key);
+  if (found != this->entries.end()) {
+    this->stats.hits++;
+    set = found->second.set;
+    return true;
+  }
+
+  this->stats.misses++;
+
+  Entry entry{};
+  if (!allocate(layout, entry.set, entry.pool)) { return false; }
+
+  std::vector<vk::WriteDescriptorSet> setWrites = writes;
+  for (auto& write : setWrites) { write.dstSet = entry.set; }
+  this->device.get()->updateDescriptorSets(
+      static_cast<u32>(setWrites.size()), setWrites.data(), 0, nullptr);
+
+  entry.resources = collectResources(layout, writes);
+
+  auto [inserted, _] = this->entries.emplace(std::move(key), std::move(entry));
+  for (u64 resource : inserted->second.resources) {
+    this->resourceEntries[resource].push_back(&inserted->first);
+  }
+
+  set = inserted->second.set;
+  return true;
+}
+
+void DescriptorSetCache::invalidate(u64 handle) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  auto found = this->resourceEntries.find(handle);
+  if (found == this->resourceEntries.end()) { return; }
+
+  std::vector<const HashKey*> keys = std::move(found->second);
+  this->resourceEntries.erase(found);
+
+  for (const HashKey* key : keys) {
+    auto entry = this->entries.find(*key);
+    if (entry == this->entries.end()) { continue; }
+
+    // Unlink from the other resources the set referenced
+    for (u64 resource : entry->second.resources) {
+      auto other = this->resourceEntries.find(resource);
+      if (other == this->resourceEntries.end()) { continue; }
+
+      std::erase(other->second, key);
+      if (other->second.empty()) { this->resourceEntries.erase(other); }
+    }
+
+    release(entry->second);
+    this->entries.erase(entry);
+    this->stats.invalidations++;
+  }
+}
+
+void DescriptorSetCache::clear() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  for (const auto& [key, entry] : this->entries) { release(entry); }
+
+  this->entries.clear();
+  this->resourceEntries.clear();
+}
+
+DescriptorSetCache::Stats DescriptorSetCache::getStats() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  Stats current = this->stats;
+  current.entries = this->entries.size();
+  return current;
+}
+
+void DescriptorSetCache::resetStats() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->stats = Stats{};
+}
+
+HashKey DescriptorSetCache::makeKey(
+    vk::DescriptorSetLayout layout,
+    const std::vector<vk::WriteDescriptorSet>& writes) {
+  HashKey key{};
+  key.add(handleKey(layout));
+
+  auto addWrite = [&key](const vk::WriteDescriptorSet& write) {
+    key.add(write.dstBinding);
+    key.add(write.dstArrayElement);
+    key.add(static_cast<u64>(write.descriptorType));
+    key.add(write.descriptorCount);
+
+    for (u32 i = 0; i < write.descriptorCount; i++) {
+      if (write.pBufferInfo != nullptr) {
+        const vk::DescriptorBufferInfo& info = write.pBufferInfo[i];
+        key.add(handleKey(info.buffer));
+        key.add(info.offset);
+        key.add(info.range);
+      } else if (write.pImageInfo != nullptr) {
+        const vk::DescriptorImageInfo& info = write.pImageInfo[i];
+        key.add(handleKey(info.sampler));
+        key.add(handleKey(info.imageView));
+        key.add(static_cast<u64>(info.imageLayout));
+      } else if (write.pTexelBufferView != nullptr) {
+        key.add(handleKey(write.pTexelBufferView[i]));
+      }
+    }
+  };
+
+  // Writes may come in any order, sort by binding so equal sets match.
+  // Callers nearly always write in binding order already, only sort an
+  // index array otherwise so the common lookup stays allocation free.
+  auto byBinding = [](const vk::WriteDescriptorSet& a,
+                      const vk::WriteDescriptorSet& b) {
+    return a.dstBinding < b.dstBinding;
+  };
+  if (std::is_sorted(writes.begin(), writes.end(), byBinding)) {
+    for (const auto& write : writes) { addWrite(write); }
+    return key;
+  }
+
+  std::vector<size_t> order(writes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return byBinding(writes[a], writes[b]);
+  });
+  for (size_t index : order) { addWrite(writes[index]); }
+
+  return key;
+}
+
+std::vector<u64> DescriptorSetCache::collectResources(
+    vk::DescriptorSetLayout layout,
+    const std::vector<vk::WriteDescriptorSet>& writes) {
+  std::vector<u64> resources{handleKey(layout)};
+
+  auto addResource = [&resources](u64 handle) {
+    if (handle != 0) { resources.push_back(handle); }
+  };
+
+  for (const auto& write : writes) {
+    for (u32 i = 0; i < write.descriptorCount; i++) {
+      if (write.pBufferInfo != nullptr) {
+        addResource(handleKey(write.pBufferInfo[i].buffer));
+      } else if (write.pImageInfo != nullptr) {
+        addResource(handleKey(write.pImageInfo[i].sampler));
+        addResource(handleKey(write.pImageInfo[i].imageView));
+      } else if (write.pTexelBufferView != nullptr) {
+        addResource(handleKey(write.pTexelBufferView[i]));
+      }
+    }
+  }
+
+  std::sort(resources.begin(), resources.end());
+  resources.erase(std::unique(resources.begin(), resources.end()),
+                  resources.end());
+
+  return resources;
+}
+
+bool DescriptorSetCache::allocate(vk::DescriptorSetLayout layout,
+                                  vk::DescriptorSet& set,
+                                  vk::DescriptorPool& pool) {
+  // Invalidated sets are freed back into the pool they came from, so older
+  // pools regain room over time. Newest first, it is the likeliest to fit.
+  for (auto it = this->pools.rbegin(); it != this->pools.rend(); ++it) {
+    vk::Result result = (*it)->tryAllocateDescriptorSet(layout, set);
+
+    if (result == vk::Result::eSuccess) {
+      pool = (*it)->get();
+      return true;
+    }
+
+    if (result != vk::Result::eErrorOutOfPoolMemory &&
+        result != vk::Result::eErrorFragmentedPool) {
+      log::fatal("failed to allocate descriptor set. Error: ",
+                 vk::to_string(result));
+      throw std::runtime_error("failed to allocate descriptor set");
+    }
+  }
+
+  this->pools.push_back(createPool());
+
+  if (!this->pools.back()->allocateDescriptorSet(layout, set)) {
+    log::error("descriptor set layout does not fit into an empty pool");
+    return false;
+  }
+
+  pool = this->pools.back()->get();
+  return true;
+}
+
+std::unique_ptr<DescriptorPool> DescriptorSetCache::createPool() {
+  // Sets are freed individually on invalidation
+  return DescriptorPool::Builder(this->device)
+      .setMaxSets(this->setsPerPool)
+      .setPoolFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
+      .addPoolSize(vk::DescriptorType::eUniformBuffer, this->setsPerPool * 2)
+      .addPoolSize(vk::DescriptorType::eStorageBuffer, this->setsPerPool * 2)
+      .addPoolSize(vk::DescriptorType::eCombinedImageSampler,
+                   this->setsPerPool * 4)
+      .addPoolSize(vk::DescriptorType::eStorageImage, this->setsPerPool)
+      .build();
+}
+
+void DescriptorSetCache::release(const Entry& entry) {
+  // A frame in flight may still have the set bound
+  this->device.getDeletionQueue().freeDescriptorSet(entry.pool, entry.set);
+}
+
+}  // namespace hep
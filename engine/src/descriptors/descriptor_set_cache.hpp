@@ -0,0 +1,95 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "descriptor_pool.hpp"
+#include "device.hpp"
+#include "util/hash.hpp"
+
+namespace hep {
+
+/**
+ * Returns the same vk::DescriptorSet for identical layout + resource
+ * combinations instead of allocating and writing a new one every time
+ *
+ * The key is the layout handle plus every written buffer (handle, offset,
+ * range), image (sampler, view, layout) and texel buffer view, so a hit is
+ * guaranteed to hold the same descriptors. Entries referencing a buffer,
+ * image view, sampler or layout are dropped as soon as Device reports it
+ * destroyed, the set itself is freed through the DeletionQueue.
+ *
+ * @note thread safe, sets are shared so never overwrite one from the cache
+ */
+class DescriptorSetCache {
+ public:
+  DescriptorSetCache(const DescriptorSetCache&) = delete;
+  DescriptorSetCache& operator=(const DescriptorSetCache&) = delete;
+
+  struct Stats {
+    u64 hits = 0;
+    u64 misses = 0;
+    u64 invalidations = 0;
+    size_t entries = 0;
+  };
+
+  DescriptorSetCache(Device& device, u32 setsPerPool = 256);
+  ~DescriptorSetCache();
+
+  /**
+   * Looks up a set matching layout and writes, allocating and writing a new
+   * one on a miss. dstSet of writes is ignored.
+   *
+   * @return false if allocation failed
+   */
+  bool getOrCreate(vk::DescriptorSetLayout layout,
+                   const std::vector<vk::WriteDescriptorSet>& writes,
+                   vk::DescriptorSet& set);
+
+  /** Drops every entry that references handle (see handleKey) */
+  void invalidate(u64 handle);
+  void clear();
+
+  Stats getStats();
+  void resetStats();
+
+ private:
+  struct Entry {
+    vk::DescriptorSet set;
+    vk::DescriptorPool pool;
+    // Handles the set references, for removal from resourceEntries
+    std::vector<u64> resources;
+  };
+
+  // Built for every lookup, doesn't allocate for sets of up to
+  // HashKey::INLINE_WORDS fields written in binding order
+  static HashKey makeKey(vk::DescriptorSetLayout layout,
+                         const std::vector<vk::WriteDescriptorSet>& writes);
+  // Only needed on a miss, see Entry::resources
+  static std::vector<u64> collectResources(
+      vk::DescriptorSetLayout layout,
+      const std::vector<vk::WriteDescriptorSet>& writes);
+
+  bool allocate(vk::DescriptorSetLayout layout,
+                vk::DescriptorSet& set,
+                vk::DescriptorPool& pool);
+  std::unique_ptr<DescriptorPool> createPool();
+  void release(const Entry& entry);
+
+  Device& device;
+  u32 setsPerPool;
+  u32 resourceCallbackId;
+
+  std::mutex mutex;
+  std::vector<std::unique_ptr<DescriptorPool>> pools;
+  std::unordered_map<HashKey, Entry, HashKeyHasher> entries;
+  // Resource handle -> keys of the entries that reference it, pointers into
+  // entries stay valid until the node is erased
+  std::unordered_map<u64, std::vector<const HashKey*>> resourceEntries;
+
+  Stats stats{};
+};
+
+}  // namespace hep
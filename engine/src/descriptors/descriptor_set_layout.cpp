@@ -3,6 +3,8 @@
 #include <cassert>
 #include <stdexcept>
 
+#include "layout_cache.hpp"
+
 namespace hep {
 
 DescriptorSetLayout::Builder& DescriptorSetLayout::Builder::addBinding(
@@ -19,35 +21,38 @@ DescriptorSetLayout::Builder& DescriptorSetLayout::Builder::addBinding(
   return *this;
 }
 
+DescriptorSetLayout::Builder& DescriptorSetLayout::Builder::setPushDescriptor(
+    bool enable) {
+  this->pushDescriptor = enable;
+  return *this;
+}
+
 std::unique_ptr<DescriptorSetLayout> DescriptorSetLayout::Builder::build()
     const {
-  return std::make_unique<DescriptorSetLayout>(this->device, this->bindings);
+  vk::DescriptorSetLayoutCreateFlags flags{};
+  if (this->pushDescriptor && this->device.isPushDescriptorEnabled()) {
+    flags |= vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR;
+  }
+
+  return std::make_unique<DescriptorSetLayout>(this->device, this->bindings,
+                                               flags);
 }
 
 DescriptorSetLayout::DescriptorSetLayout(
     Device& device,
-    std::unordered_map<u32, vk::DescriptorSetLayoutBinding> bindings)
-    : device{device}, bindings{bindings} {
+    std::unordered_map<u32, vk::DescriptorSetLayoutBinding> bindings,
+    vk::DescriptorSetLayoutCreateFlags flags)
+    : device{device}, flags{flags}, bindings{bindings} {
   std::vector<vk::DescriptorSetLayoutBinding> setLayoutBindings{};
 
   for (auto binding : bindings) { setLayoutBindings.push_back(binding.second); }
 
-  vk::DescriptorSetLayoutCreateInfo layoutCreateInfo{};
-  layoutCreateInfo.bindingCount =
-      static_cast<uint32_t>(setLayoutBindings.size());
-  layoutCreateInfo.pBindings = setLayoutBindings.data();
-
-  vk::Result result = this->device.get()->createDescriptorSetLayout(
-      &layoutCreateInfo, nullptr, &this->layout);
-
-  if (result != vk::Result::eSuccess) {
-    log::fatal("failed to create descriptor pool");
-    throw std::runtime_error("failed to create descriptor set layout");
-  }
+  // Shared with every other layout built from the same bindings
+  this->layout = this->device.getLayoutCache().getDescriptorSetLayout(
+      setLayoutBindings, flags);
 }
 
-DescriptorSetLayout::~DescriptorSetLayout() {
-  this->device.get()->destroyDescriptorSetLayout(this->layout);
-}
+// The vk::DescriptorSetLayout belongs to the LayoutCache
+DescriptorSetLayout::~DescriptorSetLayout() {}
 
 }  // namespace hep
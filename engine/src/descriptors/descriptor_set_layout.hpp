@@ -22,25 +22,43 @@ class DescriptorSetLayout {
                         vk::ShaderStageFlags stageFlags,
                         u32 count = 1);
 
+    /**
+     * Builds a VK_KHR_push_descriptor layout when the device supports it,
+     * DescriptorWriter::push then writes straight into the command buffer.
+     * Silently stays a regular layout otherwise.
+     *
+     * @note keep the total descriptor count within maxPushDescriptors
+     */
+    Builder& setPushDescriptor(bool enable = true);
+
     std::unique_ptr<DescriptorSetLayout> build() const;
 
    private:
     Device& device;
     std::unordered_map<u32, vk::DescriptorSetLayoutBinding> bindings{};
+    bool pushDescriptor = false;
   };
 
   DescriptorSetLayout(
       Device& device,
-      std::unordered_map<u32, vk::DescriptorSetLayoutBinding> bindings);
+      std::unordered_map<u32, vk::DescriptorSetLayoutBinding> bindings,
+      vk::DescriptorSetLayoutCreateFlags flags = {});
   ~DescriptorSetLayout();
 
   vk::DescriptorSetLayout getDescriptorSetLayout() const {
     return this->layout;
   }
 
+  bool isPushDescriptor() const {
+    return static_cast<bool>(
+        this->flags &
+        vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR);
+  }
+
  private:
   Device& device;
   vk::DescriptorSetLayout layout;
+  vk::DescriptorSetLayoutCreateFlags flags;
   std::unordered_map<u32, vk::DescriptorSetLayoutBinding> bindings;
 
   friend class DescriptorWriter;
@@ -7,7 +7,15 @@ namespace hep {
 
 DescriptorWriter::DescriptorWriter(DescriptorSetLayout& setLayout,
                                    DescriptorPool& pool)
-    : setLayout{setLayout}, pool{pool} {}
+    : setLayout{setLayout}, pool{&pool} {}
+
+DescriptorWriter::DescriptorWriter(DescriptorSetLayout& setLayout,
+                                   DescriptorAllocator& allocator)
+    : setLayout{setLayout}, allocator{&allocator} {}
+
+DescriptorWriter::DescriptorWriter(DescriptorSetLayout& setLayout,
+                                   DescriptorSetCache& cache)
+    : setLayout{setLayout}, cache{&cache} {}
 
 DescriptorWriter& DescriptorWriter::writeBuffer(
     u32 binding,
@@ -52,19 +60,52 @@ DescriptorWriter& DescriptorWriter::writeImage(
 }
 
 bool DescriptorWriter::build(vk::DescriptorSet& set) {
-  bool success =
-      this->pool.allocateDescriptorSet(setLayout.getDescriptorSetLayout(), set);
+  assert(!this->setLayout.isPushDescriptor() &&
+         "push descriptor layouts can't be allocated, use push()");
+
+  vk::DescriptorSetLayout layout = this->setLayout.getDescriptorSetLayout();
+
+  // The cache writes the set itself on a miss
+  if (this->cache != nullptr) {
+    return this->cache->getOrCreate(layout, this->writes, set);
+  }
+
+  bool success = this->allocator != nullptr
+                     ? this->allocator->allocate(layout, set)
+                     : this->pool->allocateDescriptorSet(layout, set);
 
   if (!success) { return false; }
   overwrite(set);
   return true;
 }
 
+bool DescriptorWriter::push(vk::CommandBuffer commandBuffer,
+                            vk::PipelineLayout layout,
+                            u32 set,
+                            vk::PipelineBindPoint bindPoint) {
+  if (this->setLayout.isPushDescriptor()) {
+    this->setLayout.device.pushDescriptorSet(commandBuffer, bindPoint, layout,
+                                             set, this->writes);
+    return true;
+  }
+
+  assert((this->pool != nullptr || this->allocator != nullptr ||
+          this->cache != nullptr) &&
+         "push() fallback needs a pool, allocator or cache");
+
+  vk::DescriptorSet descriptorSet;
+  if (!build(descriptorSet)) { return false; }
+
+  commandBuffer.bindDescriptorSets(bindPoint, layout, set, descriptorSet,
+                                   nullptr);
+  return true;
+}
+
 void DescriptorWriter::overwrite(vk::DescriptorSet& set) {
   for (auto& write : writes) { write.dstSet = set; }
 
-  this->pool.device.get()->updateDescriptorSets(writes.size(), writes.data(), 0,
-                                                nullptr);
+  this->setLayout.device.get()->updateDescriptorSets(
+      writes.size(), writes.data(), 0, nullptr);
 }
 
 }  // namespace hep
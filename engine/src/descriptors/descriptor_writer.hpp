@@ -2,7 +2,9 @@
 
 #include <vector>
 
+#include "descriptor_allocator.hpp"
 #include "descriptor_pool.hpp"
+#include "descriptor_set_cache.hpp"
 #include "descriptor_set_layout.hpp"
 #include "device.hpp"
 
@@ -11,6 +13,11 @@ namespace hep {
 class DescriptorWriter {
  public:
   DescriptorWriter(DescriptorSetLayout& setLayout, DescriptorPool& pool);
+  /** build() allocates a transient set valid for the current frame */
+  DescriptorWriter(DescriptorSetLayout& setLayout,
+                   DescriptorAllocator& allocator);
+  /** build() reuses a cached set with the same resources when there is one */
+  DescriptorWriter(DescriptorSetLayout& setLayout, DescriptorSetCache& cache);
 
   DescriptorWriter& writeBuffer(u32 binding,
                                 vk::DescriptorBufferInfo* bufferInfo);
@@ -19,9 +26,23 @@ class DescriptorWriter {
   bool build(vk::DescriptorSet& set);
   void overwrite(vk::DescriptorSet& set);
 
+  /**
+   * Makes the writes visible to draws recorded after this call as set
+   * number set of layout. Push descriptor layouts are written straight into
+   * commandBuffer, other layouts fall back to build() and a bind.
+   *
+   * @return false if the fallback allocation failed
+   */
+  bool push(vk::CommandBuffer commandBuffer,
+            vk::PipelineLayout layout,
+            u32 set,
+            vk::PipelineBindPoint bindPoint = vk::PipelineBindPoint::eGraphics);
+
  private:
   DescriptorSetLayout& setLayout;
-  DescriptorPool& pool;
+  DescriptorPool* pool = nullptr;
+  DescriptorAllocator* allocator = nullptr;
+  DescriptorSetCache* cache = nullptr;
   std::vector<vk::WriteDescriptorSet> writes;
 };
 
@@ -2,8 +2,16 @@
 
 #include <string.h>
 
+#include <limits>
 #include <set>
 
+#include "deletion_queue.hpp"
+#include "geometry_arena.hpp"
+#include "layout_cache.hpp"
+#include "pipeline_cache.hpp"
+#include "transfer_context.hpp"
+#include "util/file_io.hpp"
+#include "util/hash.hpp"
 #include "util/logger.hpp"
 
 namespace hep {
@@ -54,13 +62,44 @@ void destroyDebugUtilsMessengerEXT(VkInstance instance,
 Device::Device(Window& window) : window{window} {
   createVulkanInstance();
   setupDebugMessenger();
-  this->window.createSurface(*instance, surface);
+
+  if (isHeadless()) {
+    this->enabledExtensions.clear();
+  } else {
+    this->window.createSurface(*instance, surface);
+  }
+
   pickPhysicalDevice();
   createLogicalDevice();
   createCommandPool();
+
+  this->allocator =
+      std::make_unique<Allocator>(this->physicalDevice, this->device.get());
+  this->transferContext = std::make_unique<TransferContext>(*this);
+  this->deletionQueue = std::make_unique<DeletionQueue>(*this);
+  this->geometryArena = std::make_unique<GeometryArena>(*this);
+  this->pipelineCache =
+      std::make_unique<PipelineCache>(this->device.get(), this->properties);
+  this->layoutCache = std::make_unique<LayoutCache>(*this);
 }
 
 Device::~Device() {
+  // Deferred deleters may free allocations and use the command pool
+  this->device->waitIdle();
+  this->deletionQueue.reset();
+
+  // Waits for outstanding uploads and releases their staging buffers, so it
+  // has to go before the allocator and command pools
+  this->transferContext.reset();
+
+  // Deferred frees and pending copies above still reference the arena
+  this->geometryArena.reset();
+
+  this->pipelineCache->save();
+  this->pipelineCache.reset();
+
+  this->layoutCache.reset();
+
   if (this->enableValidationLayers) {
     destroyDebugUtilsMessengerEXT(this->instance.get(), this->debugMessenger,
                                   nullptr);
@@ -70,8 +109,32 @@ Device::~Device() {
   this->device->destroyCommandPool(commandPool);
   log::trace("destroyed vk::CommandPool");
 
-  this->instance->destroySurfaceKHR(surface);
-  log::trace("destroyed vk::SurfaceKHR");
+  this->allocator->logStats();
+  this->allocator.reset();
+
+  if (this->surface) {
+    this->instance->destroySurfaceKHR(surface);
+    log::trace("destroyed vk::SurfaceKHR");
+  }
+}
+
+vk::PipelineCache Device::getPipelineCache() const {
+  return this->pipelineCache->get();
+}
+
+vk::PhysicalDeviceVulkan12Properties Device::getVulkan12Properties() {
+  using Vulkan12Properties = vk::PhysicalDeviceVulkan12Properties;
+
+  auto properties =
+      this->physicalDevice
+          .getProperties2<vk::PhysicalDeviceProperties2, Vulkan12Properties>();
+  return properties.get<Vulkan12Properties>();
+}
+
+u32 Device::getGraphicsQueueTimestampValidBits() {
+  u32 graphicsFamily = getQueueIndices().graphicsFamily.value();
+  return this->physicalDevice.getQueueFamilyProperties()[graphicsFamily]
+      .timestampValidBits;
 }
 
 u32 Device::findMemoryType(u32 typeFilter, vk::MemoryPropertyFlags properties) {
@@ -114,7 +177,7 @@ void Device::createBuffer(vk::DeviceSize size,
                           vk::BufferUsageFlags usage,
                           vk::MemoryPropertyFlags properties,
                           vk::Buffer& buffer,
-                          vk::DeviceMemory& bufferMemory) {
+                          Allocation& bufferAllocation) {
   vk::BufferCreateInfo bufferInfo = {};
   bufferInfo.size = size;
   bufferInfo.usage = usage;
@@ -127,22 +190,17 @@ void Device::createBuffer(vk::DeviceSize size,
     throw std::runtime_error("failed to create vertex buffer");
   }
 
-  vk::MemoryRequirements memoryRequirements =
-      this->device->getBufferMemoryRequirements(buffer);
+  bufferAllocation = this->allocator->allocateForBuffer(buffer, properties);
 
-  vk::MemoryAllocateInfo allocInfo = {};
-  allocInfo.allocationSize = memoryRequirements.size;
-  allocInfo.memoryTypeIndex =
-      findMemoryType(memoryRequirements.memoryTypeBits, properties);
-
-  try {
-    bufferMemory = this->device->allocateMemory(allocInfo);
-  } catch (const vk::SystemError& error) {
-    log::fatal("failed to allocate vertex buffer memory");
-    throw std::runtime_error("failed to allocate vertex buffer memory");
-  }
+  this->device->bindBufferMemory(buffer, bufferAllocation.memory,
+                                 bufferAllocation.offset);
+}
 
-  this->device->bindBufferMemory(buffer, bufferMemory, 0);
+void Device::destroyBuffer(vk::Buffer& buffer, Allocation& bufferAllocation) {
+  notifyResourceDestroyed(handleKey(buffer));
+  this->device->destroyBuffer(buffer);
+  this->allocator->free(bufferAllocation);
+  buffer = VK_NULL_HANDLE;
 }
 
 vk::CommandBuffer Device::beginSingleTimeCommands() {
@@ -185,29 +243,40 @@ void Device::endSingleTimeCommands(vk::CommandBuffer commandBuffer) {
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffer;
 
-  this->graphicsQueue.submit(submitInfo, nullptr);
-  this->graphicsQueue.waitIdle();
+  // Wait on this submission only rather than draining the whole queue
+  vk::Fence fence = this->device->createFence({});
+  this->graphicsQueue.submit(submitInfo, fence);
 
+  vk::Result result = this->device->waitForFences(
+      1, &fence, vk::True, std::numeric_limits<u64>::max());
+  if (result != vk::Result::eSuccess) {
+    log::error("failed to wait for single time commands: " +
+               vk::to_string(result));
+  }
+
+  this->device->destroyFence(fence);
   this->device->freeCommandBuffers(commandPool, commandBuffer);
 }
 
 void Device::copyBuffer(vk::Buffer sourceBuffer,
                         vk::Buffer destinationBuffer,
                         vk::DeviceSize size) {
-  vk::CommandBuffer commandBuffer = beginSingleTimeCommands();
-
   vk::BufferCopy copyRegion = {};
   copyRegion.size = size;
 
-  commandBuffer.copyBuffer(sourceBuffer, destinationBuffer, copyRegion);
+  UploadBatch batch{};
+  batch.copyBuffer(sourceBuffer, destinationBuffer, copyRegion,
+                   vk::PipelineStageFlagBits::eAllCommands,
+                   vk::AccessFlagBits::eMemoryRead |
+                       vk::AccessFlagBits::eMemoryWrite);
 
-  endSingleTimeCommands(commandBuffer);
+  this->transferContext->wait(this->transferContext->submit(batch));
 }
 
 void Device::createImageWithInfo(const vk::ImageCreateInfo& imageInfo,
                                  vk::MemoryPropertyFlags properties,
                                  vk::Image& image,
-                                 vk::DeviceMemory& imageMemory) {
+                                 Allocation& imageAllocation) {
   try {
     vk::Result result = this->device->createImage(&imageInfo, nullptr, &image);
     if (result != vk::Result::eSuccess) { throw vk::SystemError(result); }
@@ -216,28 +285,71 @@ void Device::createImageWithInfo(const vk::ImageCreateInfo& imageInfo,
     throw std::runtime_error("failed to create image");
   }
 
-  vk::MemoryRequirements memoryRequirements =
-      this->device->getImageMemoryRequirements(image);
-
-  vk::MemoryAllocateInfo allocateInfo{};
-  allocateInfo.allocationSize = memoryRequirements.size;
-  allocateInfo.memoryTypeIndex =
-      findMemoryType(memoryRequirements.memoryTypeBits, properties);
+  imageAllocation = this->allocator->allocateForImage(image, properties);
 
   try {
-    vk::Result result =
-        this->device->allocateMemory(&allocateInfo, nullptr, &imageMemory);
-    if (result != vk::Result::eSuccess) { throw vk::SystemError(result); }
+    this->device->bindImageMemory(image, imageAllocation.memory,
+                                  imageAllocation.offset);
   } catch (const vk::SystemError& error) {
-    log::fatal("failed to allocate image memory. Error: ", error.what());
-    throw std::runtime_error("failed to allocate image memory");
+    log::fatal("failed to bind image memory. Error: ", error.what());
+    throw std::runtime_error("failed to bind image memory");
+  }
+}
+
+void Device::destroyImage(vk::Image& image, Allocation& imageAllocation) {
+  this->device->destroyImage(image);
+  this->allocator->free(imageAllocation);
+  image = VK_NULL_HANDLE;
+}
+
+vk::UniqueShaderModule Device::createShaderModule(
+    const std::string& shaderFilename) {
+  std::vector<u32> code;
+  if (!readSpirvFile(shaderFilename, code)) {
+    log::error("failed to read SPIR-V: " + shaderFilename);
+    throw std::runtime_error("failed to read SPIR-V: " + shaderFilename);
   }
 
   try {
-    this->device->bindImageMemory(image, imageMemory, 0);
-  } catch (const vk::SystemError& error) {
-    log::fatal("failed to bind image memory. Error: ", error.what());
-    throw std::runtime_error("failed to bind image memory");
+    return this->device->createShaderModuleUnique(
+        {vk::ShaderModuleCreateFlags(), code.size() * sizeof(u32),
+         code.data()});
+  } catch (const vk::SystemError& err) {
+    log::fatal("failed to create shader module");
+    throw std::runtime_error("failed to create shader module");
+  }
+}
+
+void Device::pushDescriptorSet(
+    vk::CommandBuffer commandBuffer,
+    vk::PipelineBindPoint bindPoint,
+    vk::PipelineLayout layout,
+    u32 set,
+    const std::vector<vk::WriteDescriptorSet>& writes) {
+  assert(this->pushDescriptorEnabled && "push descriptors are not enabled");
+
+  this->vkCmdPushDescriptorSet(
+      static_cast<VkCommandBuffer>(commandBuffer),
+      static_cast<VkPipelineBindPoint>(bindPoint),
+      static_cast<VkPipelineLayout>(layout), set,
+      static_cast<u32>(writes.size()),
+      reinterpret_cast<const VkWriteDescriptorSet*>(writes.data()));
+}
+
+u32 Device::addResourceDestroyedCallback(ResourceDestroyedCallback callback) {
+  u32 id = this->nextResourceCallbackId++;
+  this->resourceDestroyedCallbacks.emplace_back(id, std::move(callback));
+  return id;
+}
+
+void Device::removeResourceDestroyedCallback(u32 id) {
+  std::erase_if(this->resourceDestroyedCallbacks,
+                [id](const auto& entry) { return entry.first == id; });
+}
+
+void Device::notifyResourceDestroyed(u64 handle) {
+  for (auto& [id, callback] : this->resourceDestroyedCallbacks) {
+    callback(handle);
   }
 }
 
@@ -293,12 +405,15 @@ bool Device::checkValidationLayerSupport() {
 }
 
 std::vector<const char*> Device::getRequiredExtensions() {
-  u32 glfw_extension_count = 0;
-  const char** glfw_extensions;
-  glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
-
-  std::vector<const char*> extensions(glfw_extensions,
-                                      glfw_extensions + glfw_extension_count);
+  std::vector<const char*> extensions;
+
+  // GLFW is never initialized when headless and has nothing to ask for
+  if (!isHeadless()) {
+    u32 glfw_extension_count = 0;
+    const char** glfw_extensions;
+    glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+    extensions.assign(glfw_extensions, glfw_extensions + glfw_extension_count);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -361,22 +476,46 @@ void Device::createVulkanInstance() {
 QueueFamilyIndices Device::findQueueFamilies(vk::PhysicalDevice device) {
   QueueFamilyIndices indices;
   auto queueFamilies = device.getQueueFamilyProperties();
+  std::optional<uint32_t> transferOnlyFamily;
+  std::optional<uint32_t> nonGraphicsFamily;
   int i = 0;
 
   for (const auto& queueFamily : queueFamilies) {
-    if (queueFamily.queueCount > 0 &&
-        queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
+    if (queueFamily.queueCount == 0) {
+      i++;
+      continue;
+    }
+
+    vk::QueueFlags flags = queueFamily.queueFlags;
+
+    if (!indices.graphicsFamily && flags & vk::QueueFlagBits::eGraphics) {
       indices.graphicsFamily = i;
     }
 
-    if (queueFamily.queueCount > 0 && device.getSurfaceSupportKHR(i, surface)) {
+    if (!indices.presentFamily && this->surface &&
+        device.getSurfaceSupportKHR(i, this->surface)) {
       indices.presentFamily = i;
     }
 
-    if (indices.isComplete()) { break; }
+    // Compute queues support transfers implicitly, transfer-only families
+    // usually map to the copy/DMA engine and are preferred
+    if (!(flags & vk::QueueFlagBits::eGraphics)) {
+      if (!(flags & vk::QueueFlagBits::eCompute) &&
+          flags & vk::QueueFlagBits::eTransfer) {
+        if (!transferOnlyFamily) { transferOnlyFamily = i; }
+      } else if (flags & vk::QueueFlagBits::eCompute) {
+        if (!nonGraphicsFamily) { nonGraphicsFamily = i; }
+      }
+    }
+
     i++;
   }
 
+  indices.transferFamily =
+      transferOnlyFamily ? transferOnlyFamily : nonGraphicsFamily;
+
+  if (isHeadless()) { indices.presentFamily = indices.graphicsFamily; }
+
   return indices;
 }
 
@@ -396,8 +535,8 @@ bool Device::isPhysicalDeviceSuitable(const vk::PhysicalDevice& device) {
 
   bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-  bool swapchainAdequate = false;
-  if (extensionsSupported) {
+  bool swapchainAdequate = isHeadless();
+  if (extensionsSupported && !isHeadless()) {
     SwapchainSupportDetails swapchainSupport = querySwapchainSupport(device);
     swapchainAdequate = !swapchainSupport.formats.empty() &&
                         !swapchainSupport.presentModes.empty();
@@ -439,6 +578,9 @@ void Device::createLogicalDevice() {
   std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
   std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(),
                                             indices.presentFamily.value()};
+  if (indices.transferFamily) {
+    uniqueQueueFamilies.insert(indices.transferFamily.value());
+  }
 
   float queuePriority = 1.0f;
 
@@ -447,11 +589,16 @@ void Device::createLogicalDevice() {
         {vk::DeviceQueueCreateFlags(), queueFamily, 1, &queuePriority});
   }
 
-  auto deviceFeatures = vk::PhysicalDeviceFeatures();
+  selectOptionalFeatures();
+
   auto createInfo = vk::DeviceCreateInfo(
       vk::DeviceCreateFlags(), static_cast<uint32_t>(queueCreateInfos.size()),
       queueCreateInfos.data());
-  createInfo.pEnabledFeatures = &deviceFeatures;
+  createInfo.pEnabledFeatures = &this->enabledFeatures;
+  if (this->properties.apiVersion >= VK_API_VERSION_1_3) {
+    this->enabledFeatures13.pNext = &this->enabledFeatures12;
+    createInfo.pNext = &this->enabledFeatures13;
+  }
 
   createInfo.enabledExtensionCount =
       static_cast<uint32_t>(this->enabledExtensions.size());
@@ -471,8 +618,27 @@ void Device::createLogicalDevice() {
     throw std::exception();
   }
 
+  if (this->pushDescriptorEnabled) {
+    this->vkCmdPushDescriptorSet =
+        reinterpret_cast<PFN_vkCmdPushDescriptorSetKHR>(
+            this->device->getProcAddr("vkCmdPushDescriptorSetKHR"));
+
+    if (this->vkCmdPushDescriptorSet == nullptr) {
+      log::warning("vkCmdPushDescriptorSetKHR not found, using pools");
+      this->pushDescriptorEnabled = false;
+    }
+  }
+
   this->graphicsQueue = device->getQueue(indices.graphicsFamily.value(), 0);
   this->presentQueue = device->getQueue(indices.presentFamily.value(), 0);
+
+  if (indices.transferFamily) {
+    this->transferQueue = device->getQueue(indices.transferFamily.value(), 0);
+    log::verbose("Using dedicated transfer queue family",
+                 indices.transferFamily.value());
+  } else {
+    this->transferQueue = this->graphicsQueue;
+  }
 }
 
 SwapchainSupportDetails Device::querySwapchainSupport(
@@ -485,6 +651,90 @@ SwapchainSupportDetails Device::querySwapchainSupport(
   return details;
 }
 
+void Device::selectOptionalExtensions() {
+  std::set<std::string> available;
+  for (const auto& extension :
+       this->physicalDevice.enumerateDeviceExtensionProperties()) {
+    available.insert(extension.extensionName);
+  }
+
+  this->pushDescriptorEnabled =
+      available.count(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME) > 0;
+  if (this->pushDescriptorEnabled) {
+    this->enabledExtensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+  }
+
+  log::info(this->pushDescriptorEnabled
+                ? "Using push descriptors"
+                : "Push descriptors unsupported, using descriptor pools");
+}
+
+void Device::selectOptionalFeatures() {
+  selectOptionalExtensions();
+
+  vk::PhysicalDeviceFeatures supportedFeatures =
+      this->physicalDevice.getFeatures();
+  this->enabledFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+  this->enabledFeatures.drawIndirectFirstInstance =
+      supportedFeatures.drawIndirectFirstInstance;
+
+  // Vulkan12/13Features may only be chained on 1.3 devices
+  if (this->properties.apiVersion < VK_API_VERSION_1_3) {
+    log::info(
+        "Device is older than Vulkan 1.3, using render pass path without "
+        "bindless descriptors");
+    return;
+  }
+
+  auto supported =
+      this->physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                        vk::PhysicalDeviceVulkan12Features,
+                                        vk::PhysicalDeviceVulkan13Features>();
+  const auto& supported12 = supported.get<vk::PhysicalDeviceVulkan12Features>();
+  const auto& supported13 = supported.get<vk::PhysicalDeviceVulkan13Features>();
+
+  this->enabledFeatures13.dynamicRendering = supported13.dynamicRendering;
+
+  log::info(this->enabledFeatures13.dynamicRendering
+                ? "Using dynamic rendering path"
+                : "Dynamic rendering unsupported, using render pass path");
+
+  // Everything BindlessTable relies on, enabled all together or not at all
+  bool bindless =
+      supported12.descriptorIndexing && supported12.runtimeDescriptorArray &&
+      supported12.descriptorBindingPartiallyBound &&
+      supported12.descriptorBindingUpdateUnusedWhilePending &&
+      supported12.descriptorBindingSampledImageUpdateAfterBind &&
+      supported12.descriptorBindingStorageBufferUpdateAfterBind &&
+      supported12.shaderSampledImageArrayNonUniformIndexing &&
+      supported12.shaderStorageBufferArrayNonUniformIndexing;
+
+  if (bindless) {
+    this->enabledFeatures12.descriptorIndexing = vk::True;
+    this->enabledFeatures12.runtimeDescriptorArray = vk::True;
+    this->enabledFeatures12.descriptorBindingPartiallyBound = vk::True;
+    this->enabledFeatures12.descriptorBindingUpdateUnusedWhilePending =
+        vk::True;
+    this->enabledFeatures12.descriptorBindingSampledImageUpdateAfterBind =
+        vk::True;
+    this->enabledFeatures12.descriptorBindingStorageBufferUpdateAfterBind =
+        vk::True;
+    this->enabledFeatures12.shaderSampledImageArrayNonUniformIndexing =
+        vk::True;
+    this->enabledFeatures12.shaderStorageBufferArrayNonUniformIndexing =
+        vk::True;
+  }
+
+  log::info(bindless ? "Using bindless descriptors"
+                     : "Descriptor indexing unsupported, no bindless table");
+
+  this->enabledFeatures12.drawIndirectCount = supported12.drawIndirectCount;
+
+  log::info(this->enabledFeatures12.drawIndirectCount
+                ? "Using drawIndexedIndirectCount"
+                : "drawIndirectCount unsupported, culled draws are zeroed");
+}
+
 void Device::createCommandPool() {
   QueueFamilyIndices queueFamilyIndices =
       findQueueFamilies(this->physicalDevice);
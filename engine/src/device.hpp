@@ -3,10 +3,14 @@
 #include <imgui_impl_vulkan.h>
 
 #include <cassert>
+#include <functional>
+#include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 #include <vulkan/vulkan.hpp>
 
+#include "memory/allocator.hpp"
 #include "types.hpp"
 #include "window.hpp"
 
@@ -14,9 +18,17 @@
 
 namespace hep {
 
+class DeletionQueue;
+class GeometryArena;
+class LayoutCache;
+class PipelineCache;
+class TransferContext;
+
 struct QueueFamilyIndices {
   std::optional<uint32_t> graphicsFamily;
   std::optional<uint32_t> presentFamily;
+  // Family without graphics support, only set when the device exposes one
+  std::optional<uint32_t> transferFamily;
 
   bool isComplete() {
     return graphicsFamily.has_value() && presentFamily.has_value();
@@ -46,10 +58,99 @@ class Device {
 
   void waitIdle() { this->device->waitIdle(); }
 
+  /**
+   * No surface and no swapchain support, present aliases the graphics queue
+   */
+  bool isHeadless() const { return this->window.isHeadless(); }
+
+  /**
+   * When true Swapchain and Frame skip vk::RenderPass/vk::Framebuffer
+   * objects and pipelines are created against attachment formats
+   */
+  bool isDynamicRenderingEnabled() const {
+    return this->enabledFeatures13.dynamicRendering;
+  }
+
+  /**
+   * True when the descriptor indexing features BindlessTable needs
+   * (update after bind, partially bound, non uniform indexing) are enabled
+   */
+  bool isBindlessEnabled() const {
+    return this->enabledFeatures12.descriptorIndexing;
+  }
+
+  /** drawIndexedIndirect may take a drawCount greater than 1 */
+  bool isMultiDrawIndirectEnabled() const {
+    return this->enabledFeatures.multiDrawIndirect;
+  }
+
+  /** Indirect commands may use a non zero firstInstance */
+  bool isDrawIndirectFirstInstanceEnabled() const {
+    return this->enabledFeatures.drawIndirectFirstInstance;
+  }
+
+  /** The draw count of indirect draws may come from a GPU buffer */
+  bool isDrawIndirectCountEnabled() const {
+    return this->enabledFeatures12.drawIndirectCount;
+  }
+
+  /** True when VK_KHR_push_descriptor was found and enabled */
+  bool isPushDescriptorEnabled() const { return this->pushDescriptorEnabled; }
+
+  /**
+   * Records vkCmdPushDescriptorSetKHR, only valid when
+   * isPushDescriptorEnabled(). dstSet of writes is ignored.
+   */
+  void pushDescriptorSet(vk::CommandBuffer commandBuffer,
+                         vk::PipelineBindPoint bindPoint,
+                         vk::PipelineLayout layout,
+                         u32 set,
+                         const std::vector<vk::WriteDescriptorSet>& writes);
+
   vk::CommandPool getCommandPool() const { return this->commandPool; }
   vk::SurfaceKHR getSurface() const { return surface; }
   vk::Queue getGraphicsQueue() const { return graphicsQueue; }
   vk::Queue getPresentQueue() const { return presentQueue; }
+  vk::Queue getTransferQueue() const { return transferQueue; }
+
+  bool hasDedicatedTransferQueue() const {
+    return this->transferQueue != this->graphicsQueue;
+  }
+
+  TransferContext& getTransferContext() { return *this->transferContext; }
+
+  /** Use instead of destroying resources a frame in flight may still use */
+  DeletionQueue& getDeletionQueue() { return *this->deletionQueue; }
+
+  /** Shared vertex and index buffers all meshes live in */
+  GeometryArena& getGeometryArena() { return *this->geometryArena; }
+
+  using ResourceDestroyedCallback = std::function<void(u64 handle)>;
+
+  /**
+   * callback receives the handleKey of every buffer, image view, sampler
+   * and descriptor set layout once it is destroyed or handed to the
+   * DeletionQueue, so caches can drop entries that reference it
+   *
+   * @note register and remove callbacks before recording threads start,
+   * notifications may come from any thread
+   *
+   * @return id for removeResourceDestroyedCallback
+   */
+  u32 addResourceDestroyedCallback(ResourceDestroyedCallback callback);
+  void removeResourceDestroyedCallback(u32 id);
+  void notifyResourceDestroyed(u64 handle);
+
+  vk::PipelineCache getPipelineCache() const;
+
+  /** Shared descriptor set and pipeline layouts, see LayoutCache */
+  LayoutCache& getLayoutCache() { return *this->layoutCache; }
+
+  /** Update after bind descriptor limits, only meaningful on 1.2+ devices */
+  vk::PhysicalDeviceVulkan12Properties getVulkan12Properties();
+
+  /** 0 when the graphics queue doesn't support timestamp queries */
+  u32 getGraphicsQueueTimestampValidBits();
 
   QueueFamilyIndices getQueueIndices() {
     return findQueueFamilies(this->physicalDevice);
@@ -69,12 +170,21 @@ class Device {
                     vk::BufferUsageFlags usage,
                     vk::MemoryPropertyFlags properties,
                     vk::Buffer& buffer,
-                    vk::DeviceMemory& bufferMemory);
+                    Allocation& bufferAllocation);
+
+  void destroyBuffer(vk::Buffer& buffer, Allocation& bufferAllocation);
 
   vk::CommandBuffer beginSingleTimeCommands();
 
+  /**
+   * Submits commandBuffer and blocks on a fence until it has executed
+   */
   void endSingleTimeCommands(vk::CommandBuffer commandBuffer);
 
+  /**
+   * Blocking copy, prefer recording into an UploadBatch and submitting it
+   * through the TransferContext
+   */
   void copyBuffer(vk::Buffer sourceBuffer,
                   vk::Buffer destinationBuffer,
                   vk::DeviceSize size);
@@ -82,7 +192,17 @@ class Device {
   void createImageWithInfo(const vk::ImageCreateInfo& imageInfo,
                            vk::MemoryPropertyFlags properties,
                            vk::Image& image,
-                           vk::DeviceMemory& imageMemory);
+                           Allocation& imageAllocation);
+
+  void destroyImage(vk::Image& image, Allocation& imageAllocation);
+
+  /**
+   * Loads a SPIR-V file, see readSpirvFile, shared by Pipeline and
+   * ComputePipeline. Throws if the file is missing or malformed.
+   */
+  vk::UniqueShaderModule createShaderModule(const std::string& shaderFilename);
+
+  Allocator& getAllocator() { return *this->allocator; }
 
   void populateImGuiInitInfo(ImGui_ImplVulkan_InitInfo& initInfo);
 
@@ -102,6 +222,8 @@ class Device {
 
   SwapchainSupportDetails querySwapchainSupport(vk::PhysicalDevice device);
 
+  void selectOptionalExtensions();
+  void selectOptionalFeatures();
   void createLogicalDevice();
   void createCommandPool();
 
@@ -116,9 +238,29 @@ class Device {
 
   vk::Queue graphicsQueue;
   vk::Queue presentQueue;
+  vk::Queue transferQueue;
 
   vk::CommandPool commandPool;
 
+  vk::PhysicalDeviceFeatures enabledFeatures{};
+  vk::PhysicalDeviceVulkan12Features enabledFeatures12{};
+  vk::PhysicalDeviceVulkan13Features enabledFeatures13{};
+
+  bool pushDescriptorEnabled = false;
+  // Extension commands aren't exported by the loader, fetched per device
+  PFN_vkCmdPushDescriptorSetKHR vkCmdPushDescriptorSet = nullptr;
+
+  std::unique_ptr<Allocator> allocator;
+  std::unique_ptr<PipelineCache> pipelineCache;
+  std::unique_ptr<LayoutCache> layoutCache;
+  std::unique_ptr<TransferContext> transferContext;
+  std::unique_ptr<DeletionQueue> deletionQueue;
+  std::unique_ptr<GeometryArena> geometryArena;
+
+  std::vector<std::pair<u32, ResourceDestroyedCallback>>
+      resourceDestroyedCallbacks;
+  u32 nextResourceCallbackId = 1;
+
 #ifdef NDEBUG
   const bool enableValidationLayers = false;
   const std::vector<const char*> enabledLayers;
@@ -127,7 +269,8 @@ class Device {
   const std::vector<const char*> enabledLayers = {
       "VK_LAYER_KHRONOS_validation"};
 #endif
-  const std::vector<const char*> enabledExtensions = {
+  // Cleared for headless devices, which never present
+  std::vector<const char*> enabledExtensions = {
       VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 };
 
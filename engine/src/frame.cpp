@@ -1,5 +1,9 @@
 #include "frame.hpp"
 
+#include "deletion_queue.hpp"
+#include "util/hash.hpp"
+#include "util/image_barrier.hpp"
+
 namespace hep {
 
 std::unique_ptr<Frame> Frame::Builder::build() const {
@@ -20,8 +24,11 @@ Frame::Frame(Device& device,
       renderPass{renderPass} {
   createImageResources(usage);
   createDepthResources(vk::ImageUsageFlagBits::eDepthStencilAttachment);
-  createRenderPass();
-  createFramebuffer();
+
+  if (!this->device.isDynamicRenderingEnabled()) {
+    createRenderPass();
+    createFramebuffer();
+  }
 }
 
 Frame::~Frame() {
@@ -33,15 +40,101 @@ Frame::~Frame() {
 
 void Frame::resize(vk::Extent2D extent) {
   this->extent = extent;
-  this->device.get()->waitIdle();
 
-  destroyFramebuffer();
-  destroyDepthResources();
-  destroyImageResources();
+  // Frames in flight may still render into or sample the old targets
+  DeletionQueue& deletionQueue = this->device.getDeletionQueue();
+  if (this->framebuffer) {
+    deletionQueue.destroyFramebuffer(this->framebuffer);
+  }
+  deletionQueue.destroyImageView(this->depthImageView);
+  deletionQueue.destroyImage(this->depthImage, this->depthImageAllocation);
+  deletionQueue.destroyImageView(this->imageView);
+  deletionQueue.destroyImage(this->image, this->imageAllocation);
 
   createImageResources(this->imageUsage);
   createDepthResources(vk::ImageUsageFlagBits::eDepthStencilAttachment);
-  createFramebuffer();
+  if (this->renderPass) { createFramebuffer(); }
+}
+
+void Frame::beginRendering(vk::CommandBuffer commandBuffer,
+                           const vk::ClearColorValue& clearColor) {
+  std::array<vk::ClearValue, 2> clearValues{};
+  clearValues[0].color = clearColor;
+  clearValues[1].depthStencil = vk::ClearDepthStencilValue{1.0f, 0};
+
+  if (this->renderPass) {
+    vk::RenderPassBeginInfo beginInfo{};
+    beginInfo.renderPass = this->renderPass;
+    beginInfo.framebuffer = this->framebuffer;
+    beginInfo.renderArea.offset = vk::Offset2D{0, 0};
+    beginInfo.renderArea.extent = this->extent;
+    beginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    beginInfo.pClearValues = clearValues.data();
+
+    commandBuffer.beginRenderPass(&beginInfo, vk::SubpassContents::eInline);
+    return;
+  }
+
+  // The transitions the render pass performed implicitly. The previous
+  // contents are cleared, only the last frame's sampling has to finish.
+  transitionImageLayout(commandBuffer, this->image,
+                        vk::ImageAspectFlagBits::eColor,
+                        vk::ImageLayout::eUndefined,
+                        vk::ImageLayout::eColorAttachmentOptimal,
+                        vk::PipelineStageFlagBits::eFragmentShader, {},
+                        vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                        vk::AccessFlagBits::eColorAttachmentWrite);
+  transitionImageLayout(
+      commandBuffer, this->depthImage, getDepthAspectMask(this->depthFormat),
+      vk::ImageLayout::eUndefined,
+      vk::ImageLayout::eDepthStencilAttachmentOptimal,
+      vk::PipelineStageFlagBits::eLateFragmentTests,
+      vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+      vk::PipelineStageFlagBits::eEarlyFragmentTests,
+      vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+
+  vk::RenderingAttachmentInfo colorAttachment{};
+  colorAttachment.imageView = this->imageView;
+  colorAttachment.imageLayout = vk::ImageLayout::eColorAttachmentOptimal;
+  colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+  colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+  colorAttachment.clearValue = clearValues[0];
+
+  vk::RenderingAttachmentInfo depthAttachment{};
+  depthAttachment.imageView = this->depthImageView;
+  depthAttachment.imageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+  depthAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+  depthAttachment.storeOp = vk::AttachmentStoreOp::eDontCare;
+  depthAttachment.clearValue = clearValues[1];
+
+  vk::RenderingInfo renderingInfo{};
+  renderingInfo.renderArea.offset = vk::Offset2D{0, 0};
+  renderingInfo.renderArea.extent = this->extent;
+  renderingInfo.layerCount = 1;
+  renderingInfo.colorAttachmentCount = 1;
+  renderingInfo.pColorAttachments = &colorAttachment;
+  renderingInfo.pDepthAttachment = &depthAttachment;
+
+  commandBuffer.beginRendering(renderingInfo);
+}
+
+void Frame::endRendering(vk::CommandBuffer commandBuffer) {
+  if (this->renderPass) {
+    commandBuffer.endRenderPass();
+    return;
+  }
+
+  commandBuffer.endRendering();
+
+  // Matches the render pass finalLayout, the frame is sampled afterwards
+  transitionImageLayout(commandBuffer, this->image,
+                        vk::ImageAspectFlagBits::eColor,
+                        vk::ImageLayout::eColorAttachmentOptimal,
+                        vk::ImageLayout::eShaderReadOnlyOptimal,
+                        vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                        vk::AccessFlagBits::eColorAttachmentWrite,
+                        vk::PipelineStageFlagBits::eFragmentShader,
+                        vk::AccessFlagBits::eShaderRead);
 }
 
 vk::Format Frame::findDepthFormat() {
@@ -69,7 +162,7 @@ void Frame::createImageResources(vk::ImageUsageFlags usage) {
 
   this->device.createImageWithInfo(imageInfo,
                                    vk::MemoryPropertyFlagBits::eDeviceLocal,
-                                   this->image, this->imageMemory);
+                                   this->image, this->imageAllocation);
 
   vk::ImageViewCreateInfo imageViewInfo{};
   imageViewInfo.image = this->image;
@@ -112,7 +205,8 @@ void Frame::createDepthResources(vk::ImageUsageFlags usage) {
 
   this->device.createImageWithInfo(imageInfo,
                                    vk::MemoryPropertyFlagBits::eDeviceLocal,
-                                   this->depthImage, this->depthImageMemory);
+                                   this->depthImage,
+                                   this->depthImageAllocation);
 
   vk::ImageViewCreateInfo imageViewInfo{};
   imageViewInfo.image = this->depthImage;
@@ -234,16 +328,16 @@ void Frame::destoryRenderPass() {
 }
 
 void Frame::destroyDepthResources() {
+  this->device.notifyResourceDestroyed(handleKey(this->depthImageView));
   this->device.get()->destroyImageView(this->depthImageView);
-  this->device.get()->destroyImage(this->depthImage);
-  this->device.get()->freeMemory(this->depthImageMemory);
+  this->device.destroyImage(this->depthImage, this->depthImageAllocation);
   // log::trace("destroyed frame depth resources");
 }
 
 void Frame::destroyImageResources() {
+  this->device.notifyResourceDestroyed(handleKey(this->imageView));
   this->device.get()->destroyImageView(this->imageView);
-  this->device.get()->destroyImage(this->image);
-  this->device.get()->freeMemory(this->imageMemory);
+  this->device.destroyImage(this->image, this->imageAllocation);
   // log::trace("destroyed frame image resources");
 }
 
@@ -57,11 +57,29 @@ class Frame {
   ~Frame();
 
   vk::Format getImageFormat() { return this->imageFormat; }
+  vk::Image getImage() { return this->image; }
+  vk::Image getDepthImage() { return this->depthImage; }
+  vk::ImageView getDepthImageView() { return this->depthImageView; }
+  vk::Extent2D getExtent() { return this->extent; }
   vk::ImageView getImageView() { return this->imageView; }
   vk::Format getDepthFormat() { return this->depthFormat; }
+  /** Null when the device uses dynamic rendering */
   vk::RenderPass getRenderPass() { return this->renderPass; }
   vk::Framebuffer getFramebuffer() { return this->framebuffer; }
 
+  /**
+   * Begins rendering into the frame with either the render pass or dynamic
+   * rendering, clearing color and depth. endRendering leaves the color
+   * image in eShaderReadOnlyOptimal.
+   */
+  void beginRendering(vk::CommandBuffer commandBuffer,
+                      const vk::ClearColorValue& clearColor);
+  void endRendering(vk::CommandBuffer commandBuffer);
+
+  /**
+   * Recreates the targets at extent, the old ones go through the Device's
+   * DeletionQueue so in-flight frames can finish with them
+   */
   void resize(vk::Extent2D extent);
 
  private:
@@ -82,12 +100,12 @@ class Frame {
 
   vk::ImageUsageFlags imageUsage;
   vk::Format imageFormat;
-  vk::DeviceMemory imageMemory;
+  Allocation imageAllocation;
   vk::Image image;
   vk::ImageView imageView;
 
   vk::Format depthFormat;
-  vk::DeviceMemory depthImageMemory;
+  Allocation depthImageAllocation;
   vk::Image depthImage;
   vk::ImageView depthImageView;
 
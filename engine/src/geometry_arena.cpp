@@ -0,0 +1,146 @@
+#include "geometry_arena.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+#include "deletion_queue.hpp"
+#include "transfer_context.hpp"
+#include "util/logger.hpp"
+
+namespace hep {
+
+// Keeps every index range usable as both u16 and u32
+static constexpr u64 INDEX_ALIGNMENT = sizeof(u32);
+
+static u64 indexAllocationSize(const MeshRange& range) {
+  return (range.getIndexByteSize() + INDEX_ALIGNMENT - 1) &
+         ~(INDEX_ALIGNMENT - 1);
+}
+
+GeometryArena::GeometryArena(Device& device,
+                             vk::DeviceSize vertexCapacity,
+                             u32 indexCapacity)
+    : device{device},
+      vertexRanges{vertexCapacity},
+      indexRanges{static_cast<u64>(indexCapacity) * sizeof(u32)} {
+  // Storage usage lets compute passes read the geometry directly
+  this->vertexBuffer =
+      std::make_unique<Buffer>(this->device, vertexCapacity, 1,
+                               vk::BufferUsageFlagBits::eVertexBuffer |
+                                   vk::BufferUsageFlagBits::eStorageBuffer |
+                                   vk::BufferUsageFlagBits::eTransferDst,
+                               vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+  this->indexBuffer =
+      std::make_unique<Buffer>(this->device, sizeof(u32), indexCapacity,
+                               vk::BufferUsageFlagBits::eIndexBuffer |
+                                   vk::BufferUsageFlagBits::eStorageBuffer |
+                                   vk::BufferUsageFlagBits::eTransferDst,
+                               vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+  log::verbose("Geometry arena:", vertexCapacity, "vertex bytes,",
+               indexCapacity, "indices");
+}
+
+MeshRange GeometryArena::allocate(u32 vertexStride,
+                                  u32 vertexCount,
+                                  u32 indexCount,
+                                  vk::IndexType indexType) {
+  assert(vertexStride > 0 && vertexCount > 0 && "mesh needs vertices");
+  assert((indexType == vk::IndexType::eUint16 ||
+          indexType == vk::IndexType::eUint32) &&
+         "unsupported index type");
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  MeshRange range{};
+  range.vertexStride = vertexStride;
+  range.vertexCount = vertexCount;
+  range.indexCount = indexCount;
+  range.indexType = indexType;
+
+  // Aligning to the stride keeps the byte offset a whole number of vertices
+  std::optional<u64> vertexOffset = this->vertexRanges.allocate(
+      static_cast<u64>(vertexStride) * vertexCount, vertexStride);
+  if (!vertexOffset) {
+    log::fatal("geometry arena is out of vertex space for", vertexCount,
+               "vertices");
+    throw std::runtime_error("geometry arena is out of vertex space");
+  }
+  range.firstVertex = static_cast<u32>(*vertexOffset / vertexStride);
+
+  if (indexCount > 0) {
+    std::optional<u64> indexOffset = this->indexRanges.allocate(
+        indexAllocationSize(range), INDEX_ALIGNMENT);
+    if (!indexOffset) {
+      this->vertexRanges.free(*vertexOffset,
+                              static_cast<u64>(vertexStride) * vertexCount);
+      log::fatal("geometry arena is out of index space for", indexCount,
+                 "indices");
+      throw std::runtime_error("geometry arena is out of index space");
+    }
+    range.firstIndex = static_cast<u32>(*indexOffset / range.getIndexSize());
+  }
+
+  return range;
+}
+
+void GeometryArena::free(const MeshRange& range) {
+  if (!range.isValid()) { return; }
+
+  // The arena outlives the DeletionQueue, see ~Device
+  this->device.getDeletionQueue().push([this, range]() { release(range); });
+}
+
+void GeometryArena::upload(UploadBatch& batch,
+                           const MeshRange& range,
+                           const void* vertices,
+                           const void* indices) {
+  TransferContext& transferContext = this->device.getTransferContext();
+
+  transferContext.stageBuffer(
+      batch, vertices,
+      static_cast<vk::DeviceSize>(range.vertexStride) * range.vertexCount,
+      this->vertexBuffer->getBuffer(), vk::PipelineStageFlagBits::eVertexInput,
+      vk::AccessFlagBits::eVertexAttributeRead, range.getVertexByteOffset());
+
+  if (range.indexCount == 0) { return; }
+
+  transferContext.stageBuffer(
+      batch, indices, range.getIndexByteSize(),
+      this->indexBuffer->getBuffer(), vk::PipelineStageFlagBits::eVertexInput,
+      vk::AccessFlagBits::eIndexRead, range.getIndexByteOffset());
+}
+
+void GeometryArena::bind(vk::CommandBuffer commandBuffer,
+                         vk::IndexType indexType) {
+  vk::Buffer buffers[] = {this->vertexBuffer->getBuffer()};
+  vk::DeviceSize offsets[] = {0};
+  commandBuffer.bindVertexBuffers(0, 1, buffers, offsets);
+  commandBuffer.bindIndexBuffer(this->indexBuffer->getBuffer(), 0, indexType);
+}
+
+vk::DeviceSize GeometryArena::getUsedVertexBytes() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->vertexRanges.getUsed();
+}
+
+u64 GeometryArena::getUsedIndexBytes() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->indexRanges.getUsed();
+}
+
+void GeometryArena::release(const MeshRange& range) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->vertexRanges.free(
+      range.getVertexByteOffset(),
+      static_cast<u64>(range.vertexStride) * range.vertexCount);
+
+  if (range.indexCount > 0) {
+    this->indexRanges.free(range.getIndexByteOffset(),
+                           indexAllocationSize(range));
+  }
+}
+
+}  // namespace hep
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vulkan/vulkan.hpp>
+
+#include "buffer.hpp"
+#include "device.hpp"
+#include "memory/range_allocator.hpp"
+#include "types.hpp"
+
+namespace hep {
+
+class UploadBatch;
+
+/**
+ * Location of one mesh inside the GeometryArena, indices are relative to
+ * firstVertex and meant for drawIndexed's vertexOffset. firstIndex counts
+ * elements of indexType from the start of the index buffer.
+ */
+struct MeshRange {
+  u32 vertexStride = 0;
+  u32 firstVertex = 0;
+  u32 vertexCount = 0;
+  u32 firstIndex = 0;
+  u32 indexCount = 0;
+  vk::IndexType indexType = vk::IndexType::eUint32;
+
+  bool isValid() const { return this->vertexCount > 0; }
+
+  u32 getIndexSize() const {
+    return this->indexType == vk::IndexType::eUint16 ? sizeof(u16)
+                                                     : sizeof(u32);
+  }
+
+  vk::DeviceSize getVertexByteOffset() const {
+    return static_cast<vk::DeviceSize>(this->firstVertex) * this->vertexStride;
+  }
+  vk::DeviceSize getIndexByteOffset() const {
+    return static_cast<vk::DeviceSize>(this->firstIndex) * getIndexSize();
+  }
+  vk::DeviceSize getIndexByteSize() const {
+    return static_cast<vk::DeviceSize>(this->indexCount) * getIndexSize();
+  }
+};
+
+/**
+ * Device wide vertex and index buffers that every mesh is sub-allocated
+ * from
+ *
+ * Vertex ranges are aligned to their own stride, so any mesh can be drawn
+ * from one vertex binding at offset 0 with firstVertex as the vertexOffset,
+ * as long as the pipeline's vertex format matches. Binding once per command
+ * buffer and issuing many draws into the same buffers is what multi draw
+ * indirect builds on.
+ *
+ * 16 and 32 bit indices share the index buffer, every index range starts
+ * on a 4 byte boundary so both views of the buffer stay aligned.
+ *
+ * Freed ranges are returned through the DeletionQueue, frames in flight may
+ * still read them.
+ *
+ * @note thread safe
+ */
+class GeometryArena {
+ public:
+  GeometryArena(const GeometryArena&) = delete;
+  GeometryArena& operator=(const GeometryArena&) = delete;
+
+  static constexpr vk::DeviceSize DEFAULT_VERTEX_CAPACITY =
+      64ull * 1024 * 1024;
+  // In 32 bit indices, twice as many 16 bit ones fit
+  static constexpr u32 DEFAULT_INDEX_CAPACITY = 8 * 1024 * 1024;
+
+  GeometryArena(Device& device,
+                vk::DeviceSize vertexCapacity = DEFAULT_VERTEX_CAPACITY,
+                u32 indexCapacity = DEFAULT_INDEX_CAPACITY);
+
+  /** indexCount may be 0 for non indexed meshes */
+  MeshRange allocate(u32 vertexStride,
+                     u32 vertexCount,
+                     u32 indexCount,
+                     vk::IndexType indexType = vk::IndexType::eUint32);
+  void free(const MeshRange& range);
+
+  /**
+   * Stages vertexCount * vertexStride bytes of vertices and indexCount
+   * indices of range.indexType into range through the TransferContext's
+   * staging ring
+   */
+  void upload(UploadBatch& batch,
+              const MeshRange& range,
+              const void* vertices,
+              const void* indices);
+
+  /**
+   * Binds the shared vertex buffer to binding 0 and the index buffer as
+   * indexType, meshes of the other type need a rebind
+   */
+  void bind(vk::CommandBuffer commandBuffer,
+            vk::IndexType indexType = vk::IndexType::eUint32);
+
+  vk::Buffer getVertexBuffer() const { return this->vertexBuffer->getBuffer(); }
+  vk::Buffer getIndexBuffer() const { return this->indexBuffer->getBuffer(); }
+
+  vk::DeviceSize getUsedVertexBytes();
+  u64 getUsedIndexBytes();
+
+ private:
+  void release(const MeshRange& range);
+
+  Device& device;
+
+  std::unique_ptr<Buffer> vertexBuffer;
+  std::unique_ptr<Buffer> indexBuffer;
+
+  std::mutex mutex;
+  // Both in bytes
+  RangeAllocator vertexRanges;
+  RangeAllocator indexRanges;
+};
+
+}  // namespace hep
@@ -0,0 +1,142 @@
+#include "gpu_profiler.hpp"
+
+#include "util/logger.hpp"
+
+namespace hep {
+
+GpuProfiler::Zone::Zone(GpuProfiler& profiler,
+                        vk::CommandBuffer commandBuffer,
+                        const std::string& name)
+    : profiler{profiler}, commandBuffer{commandBuffer} {
+  this->zoneIndex = this->profiler.beginZone(commandBuffer, name);
+}
+
+GpuProfiler::Zone::~Zone() {
+  this->profiler.endZone(this->commandBuffer, this->zoneIndex);
+}
+
+GpuProfiler::GpuProfiler(Device& device) : device{device} {
+  const vk::PhysicalDeviceLimits& limits = this->device.properties.limits;
+  u32 validBits = this->device.getGraphicsQueueTimestampValidBits();
+
+  this->supported = limits.timestampComputeAndGraphics || validBits > 0;
+  if (!this->supported) {
+    log::warning("timestamp queries not supported, GPU profiling disabled");
+    return;
+  }
+
+  this->timestampPeriod = static_cast<double>(limits.timestampPeriod);
+  if (validBits > 0 && validBits < 64) {
+    this->timestampMask = (1ull << validBits) - 1;
+  }
+
+  vk::QueryPoolCreateInfo createInfo{};
+  createInfo.queryType = vk::QueryType::eTimestamp;
+  createInfo.queryCount = MAX_ZONES_PER_FRAME * 2;
+
+  try {
+    for (auto& frame : this->frames) {
+      frame.queryPool = this->device.get()->createQueryPool(createInfo);
+    }
+  } catch (const vk::SystemError& error) {
+    log::fatal("failed to create timestamp vk::QueryPool");
+    throw std::runtime_error("failed to create timestamp vk::QueryPool");
+  }
+
+  log::trace("created GPU profiler query pools");
+}
+
+GpuProfiler::~GpuProfiler() {
+  for (auto& frame : this->frames) {
+    if (frame.queryPool) {
+      this->device.get()->destroyQueryPool(frame.queryPool);
+    }
+  }
+}
+
+void GpuProfiler::beginFrame(vk::CommandBuffer commandBuffer, u32 frameIndex) {
+  if (!this->supported) { return; }
+
+  FrameQueries& frame = this->frames.at(frameIndex);
+
+  if (frame.hasResults) { readResults(frame); }
+
+  frame.zones.clear();
+  frame.hasResults = false;
+  commandBuffer.resetQueryPool(frame.queryPool, 0, MAX_ZONES_PER_FRAME * 2);
+
+  this->currentFrame = &frame;
+  this->currentDepth = 0;
+}
+
+double GpuProfiler::getZoneMilliseconds(const std::string& name) const {
+  double total = 0.0;
+  for (const auto& result : this->results) {
+    if (result.name == name) { total += result.milliseconds; }
+  }
+  return total;
+}
+
+u32 GpuProfiler::beginZone(vk::CommandBuffer commandBuffer,
+                           const std::string& name) {
+  if (!this->supported || this->currentFrame == nullptr) { return ~0u; }
+
+  std::vector<ZoneRecord>& zones = this->currentFrame->zones;
+  if (zones.size() >= MAX_ZONES_PER_FRAME) {
+    log::warning("GPU profiler zone limit reached, dropping zone: " + name);
+    return ~0u;
+  }
+
+  u32 zoneIndex = static_cast<u32>(zones.size());
+  zones.push_back({name, this->currentDepth, false});
+  this->currentDepth++;
+
+  commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe,
+                               this->currentFrame->queryPool, zoneIndex * 2);
+  this->currentFrame->hasResults = true;
+
+  return zoneIndex;
+}
+
+void GpuProfiler::endZone(vk::CommandBuffer commandBuffer, u32 zoneIndex) {
+  if (zoneIndex == ~0u) { return; }
+
+  this->currentDepth--;
+  this->currentFrame->zones[zoneIndex].ended = true;
+
+  commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe,
+                               this->currentFrame->queryPool,
+                               zoneIndex * 2 + 1);
+}
+
+void GpuProfiler::readResults(FrameQueries& frame) {
+  u32 queryCount = static_cast<u32>(frame.zones.size()) * 2;
+  std::vector<u64> timestamps(queryCount);
+
+  // The frame's fence has signaled, so no wait flag is needed
+  vk::Result result = this->device.get()->getQueryPoolResults(
+      frame.queryPool, 0, queryCount, timestamps.size() * sizeof(u64),
+      timestamps.data(), sizeof(u64), vk::QueryResultFlagBits::e64);
+
+  if (result != vk::Result::eSuccess) {
+    if (result != vk::Result::eNotReady) {
+      log::error("failed to read GPU timestamps: " + vk::to_string(result));
+    }
+    return;
+  }
+
+  this->results.clear();
+  for (size_t i = 0; i < frame.zones.size(); i++) {
+    const ZoneRecord& zone = frame.zones[i];
+    if (!zone.ended) { continue; }
+
+    u64 begin = timestamps[i * 2] & this->timestampMask;
+    u64 end = timestamps[i * 2 + 1] & this->timestampMask;
+    u64 ticks = (end - begin) & this->timestampMask;
+
+    this->results.push_back(
+        {zone.name, zone.depth, ticks * this->timestampPeriod * 1e-6});
+  }
+}
+
+}  // namespace hep
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "device.hpp"
+#include "swapchain.hpp"
+#include "types.hpp"
+
+namespace hep {
+
+/**
+ * Measures GPU time of command buffer regions with timestamp queries
+ *
+ * Every frame in flight has its own vk::QueryPool. Results for a frame are
+ * read back the next time that frame slot begins, at which point the
+ * Swapchain has already waited on its fence, so reading never stalls.
+ * Results therefore lag MAX_FRAMES_IN_FLIGHT frames behind.
+ *
+ * Usage:
+ * {
+ *   GpuProfiler::Zone zone{profiler, commandBuffer, "shadows"};
+ *   ... record commands ...
+ * }
+ */
+class GpuProfiler {
+ public:
+  static constexpr u32 MAX_ZONES_PER_FRAME = 128;
+
+  struct ZoneResult {
+    std::string name;
+    /** Nesting level, 0 for top level zones */
+    u32 depth;
+    double milliseconds;
+  };
+
+  /**
+   * Writes a timestamp on construction and destruction, zones may nest but
+   * must begin and end in the same command buffer
+   */
+  class Zone {
+   public:
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+
+    Zone(GpuProfiler& profiler,
+         vk::CommandBuffer commandBuffer,
+         const std::string& name);
+    ~Zone();
+
+   private:
+    GpuProfiler& profiler;
+    vk::CommandBuffer commandBuffer;
+    u32 zoneIndex;
+  };
+
+  GpuProfiler(const GpuProfiler&) = delete;
+  GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+  GpuProfiler(Device& device);
+  ~GpuProfiler();
+
+  /**
+   * Collects the previous results of frameIndex and resets its queries,
+   * call right after commandBuffer begins and before any Zone
+   */
+  void beginFrame(vk::CommandBuffer commandBuffer, u32 frameIndex);
+
+  /** Zones of the most recently completed frame, in begin order */
+  const std::vector<ZoneResult>& getResults() const { return this->results; }
+
+  /** Sum of all zones called name in the last completed frame */
+  double getZoneMilliseconds(const std::string& name) const;
+
+  bool isSupported() const { return this->supported; }
+
+ private:
+  struct ZoneRecord {
+    std::string name;
+    u32 depth;
+    bool ended;
+  };
+
+  struct FrameQueries {
+    vk::QueryPool queryPool;
+    std::vector<ZoneRecord> zones;
+    bool hasResults = false;
+  };
+
+  u32 beginZone(vk::CommandBuffer commandBuffer, const std::string& name);
+  void endZone(vk::CommandBuffer commandBuffer, u32 zoneIndex);
+  void readResults(FrameQueries& frame);
+
+  Device& device;
+  bool supported = false;
+  double timestampPeriod = 1.0;
+  u64 timestampMask = ~0ull;
+
+  std::array<FrameQueries, Swapchain::MAX_FRAMES_IN_FLIGHT> frames;
+  FrameQueries* currentFrame = nullptr;
+  u32 currentDepth = 0;
+
+  std::vector<ZoneResult> results;
+};
+
+}  // namespace hep
@@ -0,0 +1,24 @@
+#include "gpu_profiler_panel.hpp"
+
+#include <imgui.h>
+
+namespace hep {
+
+void GpuProfilerPanel::onUpdate() {
+  ImGui::Begin("GPU profiler");
+
+  if (!this->profiler.isSupported()) {
+    ImGui::Text("timestamp queries not supported on this device");
+    ImGui::End();
+    return;
+  }
+
+  for (const auto& zone : this->profiler.getResults()) {
+    ImGui::Text("%*s%-24s %8.3f ms", static_cast<int>(zone.depth * 2), "",
+                zone.name.c_str(), zone.milliseconds);
+  }
+
+  ImGui::End();
+}
+
+}  // namespace hep
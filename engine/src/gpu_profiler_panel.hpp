@@ -0,0 +1,21 @@
+#pragma once
+
+#include "gpu_profiler.hpp"
+#include "panel.hpp"
+
+namespace hep {
+
+/**
+ * ImGui panel listing the GpuProfiler zones of the last completed frame
+ */
+class GpuProfilerPanel : public Panel {
+ public:
+  GpuProfilerPanel(GpuProfiler& profiler) : profiler{profiler} {}
+
+  void onUpdate() override;
+
+ private:
+  GpuProfiler& profiler;
+};
+
+}  // namespace hep
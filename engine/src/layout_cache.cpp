@@ -0,0 +1,156 @@
+#include "layout_cache.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+#include <stdexcept>
+
+#include "device.hpp"
+#include "util/logger.hpp"
+
+namespace hep {
+
+LayoutCache::LayoutCache(Device& device) : device{device} {}
+
+LayoutCache::~LayoutCache() {
+  for (auto& [key, layout] : this->pipelineLayouts) {
+    this->device.get()->destroyPipelineLayout(layout);
+  }
+
+  for (auto& [key, layout] : this->descriptorSetLayouts) {
+    this->device.notifyResourceDestroyed(handleKey(layout));
+    this->device.get()->destroyDescriptorSetLayout(layout);
+  }
+
+  log::trace("destroyed", this->pipelineLayouts.size(),
+             "vk::PipelineLayouts and", this->descriptorSetLayouts.size(),
+             "vk::DescriptorSetLayouts");
+}
+
+vk::DescriptorSetLayout LayoutCache::getDescriptorSetLayout(
+    std::vector<vk::DescriptorSetLayoutBinding> bindings,
+    vk::DescriptorSetLayoutCreateFlags flags,
+    std::vector<vk::DescriptorBindingFlags> bindingFlags) {
+  assert((bindingFlags.empty() || bindingFlags.size() == bindings.size()) &&
+         "need one vk::DescriptorBindingFlags per binding");
+
+  // Sort through an index so bindingFlags stays matched to its binding
+  std::vector<size_t> order(bindings.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&bindings](size_t a, size_t b) {
+    return bindings[a].binding < bindings[b].binding;
+  });
+
+  std::vector<vk::DescriptorSetLayoutBinding> sortedBindings;
+  std::vector<vk::DescriptorBindingFlags> sortedFlags;
+  for (size_t index : order) {
+    sortedBindings.push_back(bindings[index]);
+    if (!bindingFlags.empty()) { sortedFlags.push_back(bindingFlags[index]); }
+  }
+
+  HashKey key{};
+  key.add(static_cast<u64>(static_cast<u32>(flags)));
+  for (size_t i = 0; i < sortedBindings.size(); i++) {
+    const auto& binding = sortedBindings[i];
+
+    key.add(binding.binding);
+    key.add(sortedFlags.empty() ? 0u : static_cast<u32>(sortedFlags[i]));
+    key.add(static_cast<u64>(binding.descriptorType));
+    key.add(binding.descriptorCount);
+    key.add(static_cast<u64>(static_cast<u32>(binding.stageFlags)));
+
+    // Immutable samplers are baked into the layout
+    u32 samplerCount =
+        binding.pImmutableSamplers != nullptr ? binding.descriptorCount : 0;
+    key.add(samplerCount);
+    for (u32 sampler = 0; sampler < samplerCount; sampler++) {
+      key.add(handleKey(binding.pImmutableSamplers[sampler]));
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  auto found = this->descriptorSetLayouts.find(key);
+  if (found != this->descriptorSetLayouts.end()) { return found->second; }
+
+  vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+  bindingFlagsInfo.bindingCount = static_cast<u32>(sortedFlags.size());
+  bindingFlagsInfo.pBindingFlags = sortedFlags.data();
+
+  vk::DescriptorSetLayoutCreateInfo layoutInfo{};
+  layoutInfo.flags = flags;
+  layoutInfo.bindingCount = static_cast<u32>(sortedBindings.size());
+  layoutInfo.pBindings = sortedBindings.data();
+  if (!sortedFlags.empty()) { layoutInfo.pNext = &bindingFlagsInfo; }
+
+  vk::DescriptorSetLayout layout;
+  try {
+    layout = this->device.get()->createDescriptorSetLayout(layoutInfo);
+  } catch (const vk::SystemError& error) {
+    log::fatal("failed to create descriptor set layout. Error: ",
+               error.what());
+    throw std::runtime_error("failed to create descriptor set layout");
+  }
+
+  this->descriptorSetLayouts.emplace(std::move(key), layout);
+  return layout;
+}
+
+vk::PipelineLayout LayoutCache::getPipelineLayout(
+    const std::vector<vk::DescriptorSetLayout>& setLayouts,
+    std::vector<vk::PushConstantRange> pushConstantRanges) {
+  std::sort(pushConstantRanges.begin(), pushConstantRanges.end(),
+            [](const auto& a, const auto& b) {
+              if (a.offset != b.offset) { return a.offset < b.offset; }
+              return static_cast<u32>(a.stageFlags) <
+                     static_cast<u32>(b.stageFlags);
+            });
+
+  // Set order is significant, it decides the set index in the shaders
+  HashKey key{};
+  key.add(setLayouts.size());
+  for (vk::DescriptorSetLayout setLayout : setLayouts) {
+    key.add(handleKey(setLayout));
+  }
+  for (const auto& range : pushConstantRanges) {
+    key.add(static_cast<u64>(static_cast<u32>(range.stageFlags)));
+    key.add(range.offset);
+    key.add(range.size);
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  auto found = this->pipelineLayouts.find(key);
+  if (found != this->pipelineLayouts.end()) { return found->second; }
+
+  vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.setLayoutCount = static_cast<u32>(setLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount =
+      static_cast<u32>(pushConstantRanges.size());
+  pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+  vk::PipelineLayout layout;
+  try {
+    layout = this->device.get()->createPipelineLayout(pipelineLayoutInfo);
+    log::trace("created vk::PipelineLayout");
+  } catch (const vk::SystemError& error) {
+    log::fatal("failed to create vk::PipelineLayout. Error: ", error.what());
+    throw std::runtime_error("failed to create vk::PipelineLayout");
+  }
+
+  this->pipelineLayouts.emplace(std::move(key), layout);
+  return layout;
+}
+
+size_t LayoutCache::getDescriptorSetLayoutCount() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->descriptorSetLayouts.size();
+}
+
+size_t LayoutCache::getPipelineLayoutCount() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  return this->pipelineLayouts.size();
+}
+
+}  // namespace hep
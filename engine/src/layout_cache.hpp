@@ -0,0 +1,65 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "types.hpp"
+#include "util/hash.hpp"
+
+namespace hep {
+
+class Device;
+
+/**
+ * Device wide cache sharing one vk::DescriptorSetLayout per unique binding
+ * list and one vk::PipelineLayout per unique set layout + push constant
+ * combination
+ *
+ * Binding lists and push constant ranges are sorted before hashing, so the
+ * order they were declared in does not matter. Because equal inputs give
+ * the same handle, pipelines from different render systems end up with
+ * compatible layouts and bound descriptor sets survive switching between
+ * them.
+ *
+ * Returned layouts are owned by the cache and live as long as the Device,
+ * never destroy them.
+ *
+ * @note thread safe
+ */
+class LayoutCache {
+ public:
+  LayoutCache(const LayoutCache&) = delete;
+  LayoutCache& operator=(const LayoutCache&) = delete;
+
+  LayoutCache(Device& device);
+  ~LayoutCache();
+
+  /**
+   * @param bindingFlags empty, or one entry per binding in the same order,
+   * chained as vk::DescriptorSetLayoutBindingFlagsCreateInfo
+   */
+  vk::DescriptorSetLayout getDescriptorSetLayout(
+      std::vector<vk::DescriptorSetLayoutBinding> bindings,
+      vk::DescriptorSetLayoutCreateFlags flags = {},
+      std::vector<vk::DescriptorBindingFlags> bindingFlags = {});
+
+  vk::PipelineLayout getPipelineLayout(
+      const std::vector<vk::DescriptorSetLayout>& setLayouts,
+      std::vector<vk::PushConstantRange> pushConstantRanges);
+
+  size_t getDescriptorSetLayoutCount();
+  size_t getPipelineLayoutCount();
+
+ private:
+  Device& device;
+
+  std::mutex mutex;
+  std::unordered_map<HashKey, vk::DescriptorSetLayout, HashKeyHasher>
+      descriptorSetLayouts;
+  std::unordered_map<HashKey, vk::PipelineLayout, HashKeyHasher>
+      pipelineLayouts;
+};
+
+}  // namespace hep
@@ -0,0 +1,363 @@
+#include "allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "util/logger.hpp"
+
+namespace hep {
+
+struct MemoryBlock {
+  vk::DeviceMemory memory = VK_NULL_HANDLE;
+  vk::DeviceSize size = 0;
+  u32 memoryTypeIndex = 0;
+  void* mapped = nullptr;
+  u32 allocationCount = 0;
+
+  // null for dedicated blocks, which hold exactly one allocation
+  std::unique_ptr<RangeAllocator> ranges;
+};
+
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+  if (alignment <= 1) { return value; }
+  return ((value + alignment - 1) / alignment) * alignment;
+}
+
+Allocator::Allocator(vk::PhysicalDevice physicalDevice, vk::Device device)
+    : device{device} {
+  this->memoryProperties = physicalDevice.getMemoryProperties();
+  this->nonCoherentAtomSize =
+      physicalDevice.getProperties().limits.nonCoherentAtomSize;
+}
+
+Allocator::~Allocator() {
+  u32 leaked = 0;
+
+  for (auto& pool : this->pools) {
+    for (auto& block : pool.blocks) {
+      leaked += block->allocationCount;
+      destroyBlock(*block);
+    }
+  }
+
+  for (auto& block : this->dedicatedBlocks) {
+    leaked += block->allocationCount;
+    destroyBlock(*block);
+  }
+
+  if (leaked > 0) {
+    log::warning("Allocator destroyed with", leaked, "live allocations");
+  }
+  log::trace("destroyed Allocator");
+}
+
+Allocation Allocator::allocateForBuffer(vk::Buffer buffer,
+                                        vk::MemoryPropertyFlags properties) {
+  auto chain = this->device.getBufferMemoryRequirements2<
+      vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+      vk::BufferMemoryRequirementsInfo2{buffer});
+
+  const vk::MemoryRequirements& requirements =
+      chain.get<vk::MemoryRequirements2>().memoryRequirements;
+  const vk::MemoryDedicatedRequirements& dedicatedRequirements =
+      chain.get<vk::MemoryDedicatedRequirements>();
+
+  vk::MemoryDedicatedAllocateInfo dedicatedInfo{};
+  dedicatedInfo.buffer = buffer;
+
+  return allocate(requirements, properties, ResourceKind::BUFFER,
+                  dedicatedRequirements.prefersDedicatedAllocation ||
+                      dedicatedRequirements.requiresDedicatedAllocation,
+                  &dedicatedInfo);
+}
+
+Allocation Allocator::allocateForImage(vk::Image image,
+                                       vk::MemoryPropertyFlags properties) {
+  auto chain = this->device.getImageMemoryRequirements2<
+      vk::MemoryRequirements2, vk::MemoryDedicatedRequirements>(
+      vk::ImageMemoryRequirementsInfo2{image});
+
+  const vk::MemoryRequirements& requirements =
+      chain.get<vk::MemoryRequirements2>().memoryRequirements;
+  const vk::MemoryDedicatedRequirements& dedicatedRequirements =
+      chain.get<vk::MemoryDedicatedRequirements>();
+
+  vk::MemoryDedicatedAllocateInfo dedicatedInfo{};
+  dedicatedInfo.image = image;
+
+  return allocate(requirements, properties, ResourceKind::IMAGE,
+                  dedicatedRequirements.prefersDedicatedAllocation ||
+                      dedicatedRequirements.requiresDedicatedAllocation,
+                  &dedicatedInfo);
+}
+
+void Allocator::free(Allocation& allocation) {
+  if (!allocation.isValid()) { return; }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  MemoryBlock* block = allocation.block;
+  assert(block != nullptr && "Allocation was not created by this Allocator");
+
+  if (!block->ranges) {
+    auto it = std::find_if(
+        this->dedicatedBlocks.begin(), this->dedicatedBlocks.end(),
+        [block](const auto& dedicated) { return dedicated.get() == block; });
+    assert(it != this->dedicatedBlocks.end());
+
+    destroyBlock(*block);
+    this->dedicatedBlocks.erase(it);
+    allocation = Allocation{};
+    return;
+  }
+
+  block->ranges->free(allocation.offset, allocation.size);
+  block->allocationCount--;
+
+  // Keep at most one empty block per pool around so that create/destroy
+  // patterns don't thrash vkAllocateMemory
+  if (block->allocationCount == 0) {
+    for (auto& pool : this->pools) {
+      auto it = std::find_if(
+          pool.blocks.begin(), pool.blocks.end(),
+          [block](const auto& candidate) { return candidate.get() == block; });
+      if (it == pool.blocks.end()) { continue; }
+
+      size_t emptyBlocks = std::count_if(
+          pool.blocks.begin(), pool.blocks.end(),
+          [](const auto& candidate) { return candidate->allocationCount == 0; });
+
+      if (emptyBlocks > 1) {
+        destroyBlock(*block);
+        pool.blocks.erase(it);
+      }
+      break;
+    }
+  }
+
+  allocation = Allocation{};
+}
+
+std::vector<Allocator::HeapStats> Allocator::getHeapStats() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  std::vector<HeapStats> stats(this->memoryProperties.memoryHeapCount);
+  std::vector<vk::DeviceSize> freeBytes(stats.size(), 0);
+
+  for (u32 i = 0; i < stats.size(); i++) {
+    stats[i] = {};
+    stats[i].heapIndex = i;
+    stats[i].heapSize = this->memoryProperties.memoryHeaps[i].size;
+  }
+
+  auto heapOf = [this](const MemoryBlock& block) {
+    return this->memoryProperties.memoryTypes[block.memoryTypeIndex].heapIndex;
+  };
+
+  for (auto& pool : this->pools) {
+    for (auto& block : pool.blocks) {
+      HeapStats& heap = stats[heapOf(*block)];
+      heap.blockCount++;
+      heap.allocationCount += block->allocationCount;
+      heap.reservedBytes += block->size;
+      heap.usedBytes += block->ranges->getUsed();
+      heap.largestFreeRange =
+          std::max(heap.largestFreeRange, block->ranges->getLargestFreeRange());
+      freeBytes[heap.heapIndex] += block->ranges->getFree();
+    }
+  }
+
+  for (auto& block : this->dedicatedBlocks) {
+    HeapStats& heap = stats[heapOf(*block)];
+    heap.dedicatedCount++;
+    heap.allocationCount++;
+    heap.reservedBytes += block->size;
+    heap.usedBytes += block->size;
+  }
+
+  for (auto& heap : stats) {
+    vk::DeviceSize free = freeBytes[heap.heapIndex];
+    heap.fragmentation =
+        free == 0 ? 0.0f
+                  : 1.0f - static_cast<float>(heap.largestFreeRange) /
+                               static_cast<float>(free);
+  }
+
+  return stats;
+}
+
+void Allocator::logStats() {
+  for (const auto& heap : getHeapStats()) {
+    if (heap.reservedBytes == 0) { continue; }
+
+    log::info("Allocator heap", heap.heapIndex, ":", heap.blockCount,
+              "blocks,", heap.dedicatedCount, "dedicated,",
+              heap.allocationCount, "allocations,", heap.usedBytes, "/",
+              heap.reservedBytes, "bytes used, fragmentation",
+              heap.fragmentation);
+  }
+}
+
+Allocation Allocator::allocate(
+    const vk::MemoryRequirements& requirements,
+    vk::MemoryPropertyFlags properties,
+    ResourceKind kind,
+    bool dedicated,
+    const vk::MemoryDedicatedAllocateInfo* dedicatedInfo) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  u32 memoryTypeIndex =
+      findMemoryType(requirements.memoryTypeBits, properties);
+  vk::DeviceSize blockSize = getBlockSize(memoryTypeIndex);
+
+  if (dedicated || requirements.size > blockSize / 2) {
+    return allocateDedicated(requirements, memoryTypeIndex, dedicatedInfo);
+  }
+
+  vk::DeviceSize alignment =
+      getRequiredAlignment(memoryTypeIndex, requirements.alignment);
+  vk::DeviceSize size = alignUp(requirements.size, alignment);
+
+  Pool& pool = getPool(memoryTypeIndex, kind);
+
+  MemoryBlock* block = nullptr;
+  std::optional<u64> offset;
+
+  for (auto& candidate : pool.blocks) {
+    offset = candidate->ranges->allocate(size, alignment);
+    if (offset) {
+      block = candidate.get();
+      break;
+    }
+  }
+
+  if (!block) {
+    pool.blocks.push_back(createBlock(memoryTypeIndex, blockSize, nullptr));
+    block = pool.blocks.back().get();
+    offset = block->ranges->allocate(size, alignment);
+    assert(offset && "fresh memory block could not fit allocation");
+  }
+
+  block->allocationCount++;
+
+  Allocation allocation{};
+  allocation.memory = block->memory;
+  allocation.offset = *offset;
+  allocation.size = size;
+  allocation.memoryTypeIndex = memoryTypeIndex;
+  allocation.block = block;
+  if (block->mapped) {
+    allocation.mapped = static_cast<char*>(block->mapped) + *offset;
+  }
+
+  return allocation;
+}
+
+Allocation Allocator::allocateDedicated(
+    const vk::MemoryRequirements& requirements,
+    u32 memoryTypeIndex,
+    const vk::MemoryDedicatedAllocateInfo* dedicatedInfo) {
+  vk::DeviceSize size = alignUp(
+      requirements.size, getRequiredAlignment(memoryTypeIndex, 1));
+
+  this->dedicatedBlocks.push_back(
+      createBlock(memoryTypeIndex, size, dedicatedInfo));
+  MemoryBlock* block = this->dedicatedBlocks.back().get();
+  block->allocationCount = 1;
+
+  Allocation allocation{};
+  allocation.memory = block->memory;
+  allocation.offset = 0;
+  allocation.size = size;
+  allocation.mapped = block->mapped;
+  allocation.memoryTypeIndex = memoryTypeIndex;
+  allocation.block = block;
+
+  return allocation;
+}
+
+std::unique_ptr<MemoryBlock> Allocator::createBlock(u32 memoryTypeIndex,
+                                                    vk::DeviceSize size,
+                                                    const void* pNext) {
+  vk::MemoryAllocateInfo allocInfo{};
+  allocInfo.allocationSize = size;
+  allocInfo.memoryTypeIndex = memoryTypeIndex;
+  allocInfo.pNext = pNext;
+
+  auto block = std::make_unique<MemoryBlock>();
+  block->size = size;
+  block->memoryTypeIndex = memoryTypeIndex;
+
+  try {
+    block->memory = this->device.allocateMemory(allocInfo);
+  } catch (const vk::SystemError& error) {
+    log::fatal("failed to allocate device memory block. Error: ",
+               error.what());
+    throw std::runtime_error("failed to allocate device memory block");
+  }
+
+  vk::MemoryPropertyFlags flags =
+      this->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+
+  if (flags & vk::MemoryPropertyFlagBits::eHostVisible) {
+    block->mapped = this->device.mapMemory(block->memory, 0, VK_WHOLE_SIZE);
+  }
+
+  // Dedicated allocations are requested with a pNext chain, pooled ones are
+  // not and get carved up by a RangeAllocator
+  if (pNext == nullptr) {
+    block->ranges = std::make_unique<RangeAllocator>(size);
+  }
+
+  return block;
+}
+
+void Allocator::destroyBlock(MemoryBlock& block) {
+  if (block.mapped) { this->device.unmapMemory(block.memory); }
+  this->device.freeMemory(block.memory);
+  block.memory = VK_NULL_HANDLE;
+}
+
+u32 Allocator::findMemoryType(u32 typeFilter,
+                              vk::MemoryPropertyFlags properties) {
+  for (u32 i = 0; i < this->memoryProperties.memoryTypeCount; i++) {
+    if ((typeFilter & (1 << i)) &&
+        (this->memoryProperties.memoryTypes[i].propertyFlags & properties) ==
+            properties) {
+      return i;
+    }
+  }
+
+  log::fatal("failed to find suitable memory type");
+  throw std::runtime_error("failed to find suitable memory type");
+}
+
+vk::DeviceSize Allocator::getBlockSize(u32 memoryTypeIndex) const {
+  u32 heapIndex = this->memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+  vk::DeviceSize heapSize = this->memoryProperties.memoryHeaps[heapIndex].size;
+
+  // Small heaps (e.g. the 256MiB BAR heap) would be exhausted by a handful of
+  // default sized blocks
+  if (heapSize <= 1024ull * 1024 * 1024) {
+    return std::min(DEFAULT_BLOCK_SIZE, heapSize / 8);
+  }
+
+  return DEFAULT_BLOCK_SIZE;
+}
+
+vk::DeviceSize Allocator::getRequiredAlignment(u32 memoryTypeIndex,
+                                               vk::DeviceSize alignment) const {
+  vk::MemoryPropertyFlags flags =
+      this->memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+
+  // Flushing/invalidating sub-ranges of non coherent memory has to happen at
+  // nonCoherentAtomSize granularity, so never share an atom between ranges
+  if ((flags & vk::MemoryPropertyFlagBits::eHostVisible) &&
+      !(flags & vk::MemoryPropertyFlagBits::eHostCoherent)) {
+    return std::max(alignment, this->nonCoherentAtomSize);
+  }
+
+  return alignment;
+}
+
+}  // namespace hep
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "memory/range_allocator.hpp"
+#include "types.hpp"
+
+namespace hep {
+
+struct MemoryBlock;
+
+/**
+ * A range of vk::DeviceMemory handed out by the Allocator
+ *
+ * Resources must be bound at memory + offset. For host visible memory the
+ * whole block is persistently mapped and mapped already points at offset.
+ */
+struct Allocation {
+  vk::DeviceMemory memory = VK_NULL_HANDLE;
+  vk::DeviceSize offset = 0;
+  vk::DeviceSize size = 0;
+  void* mapped = nullptr;
+  u32 memoryTypeIndex = 0;
+
+  bool isValid() const { return this->memory != VK_NULL_HANDLE; }
+
+ private:
+  MemoryBlock* block = nullptr;
+
+  friend class Allocator;
+};
+
+/**
+ * Block based sub-allocator for device memory
+ *
+ * Each memory type gets pools of large vk::DeviceMemory blocks which are
+ * carved into aligned ranges by a best fit free-list (see RangeAllocator).
+ * Buffers and images are kept in separate pools so that
+ * bufferImageGranularity never has to be considered. Allocations that are
+ * large relative to the block size, or that the driver asks to be dedicated,
+ * get their own vk::DeviceMemory.
+ *
+ * @note thread safe
+ */
+class Allocator {
+ public:
+  static constexpr vk::DeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+
+  struct HeapStats {
+    u32 heapIndex;
+    vk::DeviceSize heapSize;
+    u32 blockCount;
+    u32 dedicatedCount;
+    u32 allocationCount;
+    vk::DeviceSize reservedBytes;
+    vk::DeviceSize usedBytes;
+    vk::DeviceSize largestFreeRange;
+    /** 0 when all free space is contiguous, approaches 1 as it scatters */
+    float fragmentation;
+  };
+
+  Allocator(const Allocator&) = delete;
+  Allocator& operator=(const Allocator&) = delete;
+
+  Allocator(vk::PhysicalDevice physicalDevice, vk::Device device);
+  ~Allocator();
+
+  Allocation allocateForBuffer(vk::Buffer buffer,
+                               vk::MemoryPropertyFlags properties);
+  Allocation allocateForImage(vk::Image image,
+                              vk::MemoryPropertyFlags properties);
+  void free(Allocation& allocation);
+
+  std::vector<HeapStats> getHeapStats();
+  void logStats();
+
+ private:
+  enum class ResourceKind { BUFFER = 0, IMAGE = 1 };
+
+  struct Pool {
+    std::vector<std::unique_ptr<MemoryBlock>> blocks;
+  };
+
+  Allocation allocate(const vk::MemoryRequirements& requirements,
+                      vk::MemoryPropertyFlags properties,
+                      ResourceKind kind,
+                      bool dedicated,
+                      const vk::MemoryDedicatedAllocateInfo* dedicatedInfo);
+  Allocation allocateDedicated(
+      const vk::MemoryRequirements& requirements,
+      u32 memoryTypeIndex,
+      const vk::MemoryDedicatedAllocateInfo* dedicatedInfo);
+
+  std::unique_ptr<MemoryBlock> createBlock(u32 memoryTypeIndex,
+                                           vk::DeviceSize size,
+                                           const void* pNext);
+  void destroyBlock(MemoryBlock& block);
+
+  u32 findMemoryType(u32 typeFilter, vk::MemoryPropertyFlags properties);
+  vk::DeviceSize getBlockSize(u32 memoryTypeIndex) const;
+  vk::DeviceSize getRequiredAlignment(u32 memoryTypeIndex,
+                                      vk::DeviceSize alignment) const;
+
+  Pool& getPool(u32 memoryTypeIndex, ResourceKind kind) {
+    return this->pools[memoryTypeIndex * 2 + static_cast<u32>(kind)];
+  }
+
+  vk::Device device;
+  vk::PhysicalDeviceMemoryProperties memoryProperties;
+  vk::DeviceSize nonCoherentAtomSize;
+
+  std::array<Pool, VK_MAX_MEMORY_TYPES * 2> pools;
+  std::vector<std::unique_ptr<MemoryBlock>> dedicatedBlocks;
+
+  std::mutex mutex;
+};
+
+}  // namespace hep
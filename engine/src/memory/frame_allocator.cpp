@@ -0,0 +1,81 @@
+#include "memory/frame_allocator.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include "util/logger.hpp"
+
+namespace hep {
+
+FrameAllocator::FrameAllocator(Device& device,
+                               u32 frameCount,
+                               vk::DeviceSize regionSize)
+    : device{device} {
+  assert(frameCount > 0 && "FrameAllocator needs at least one frame");
+
+  const vk::PhysicalDeviceLimits& limits = this->device.properties.limits;
+  this->minAlignment = std::max(limits.minUniformBufferOffsetAlignment,
+                                limits.minStorageBufferOffsetAlignment);
+
+  // Rounding the region size keeps every region start aligned as well
+  this->regionSize =
+      (regionSize + this->minAlignment - 1) & ~(this->minAlignment - 1);
+
+  this->buffer = std::make_unique<Buffer>(
+      this->device, this->regionSize, frameCount,
+      vk::BufferUsageFlagBits::eUniformBuffer |
+          vk::BufferUsageFlagBits::eStorageBuffer |
+          vk::BufferUsageFlagBits::eVertexBuffer,
+      vk::MemoryPropertyFlagBits::eHostVisible |
+          vk::MemoryPropertyFlagBits::eHostCoherent,
+      this->minAlignment);
+
+  if (this->buffer->map() != vk::Result::eSuccess) {
+    log::fatal("failed to map frame allocator buffer");
+    throw std::runtime_error("failed to map frame allocator buffer");
+  }
+  this->mapped = static_cast<u8*>(this->buffer->getMappedMemory());
+
+  beginFrame(0);
+}
+
+void FrameAllocator::beginFrame(u32 frameIndex) {
+  assert(frameIndex < this->buffer->getInstanceCount() &&
+         "frameIndex out of range");
+
+  this->regionBegin = this->buffer->getAlignmentSize() * frameIndex;
+  this->regionEnd = this->regionBegin + this->regionSize;
+  this->head.store(this->regionBegin, std::memory_order_relaxed);
+}
+
+FrameAllocation FrameAllocator::allocate(vk::DeviceSize size,
+                                         vk::DeviceSize alignment) {
+  assert((alignment & (alignment - 1)) == 0 &&
+         "alignment must be a power of two");
+
+  alignment = std::max(alignment, this->minAlignment);
+
+  vk::DeviceSize offset = this->head.load(std::memory_order_relaxed);
+  vk::DeviceSize alignedOffset;
+
+  do {
+    alignedOffset = (offset + alignment - 1) & ~(alignment - 1);
+
+    if (alignedOffset + size > this->regionEnd) {
+      log::fatal("frame allocator region of", this->regionSize,
+                 "bytes exhausted");
+      throw std::runtime_error("frame allocator region exhausted");
+    }
+  } while (!this->head.compare_exchange_weak(offset, alignedOffset + size,
+                                             std::memory_order_relaxed));
+
+  FrameAllocation allocation{};
+  allocation.data = this->mapped + alignedOffset;
+  allocation.buffer = this->buffer->getBuffer();
+  allocation.offset = alignedOffset;
+  allocation.size = size;
+  return allocation;
+}
+
+}  // namespace hep
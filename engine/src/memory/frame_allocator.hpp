@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "buffer.hpp"
+#include "device.hpp"
+#include "types.hpp"
+
+namespace hep {
+
+/**
+ * Short lived slice of a FrameAllocator region, valid until the frame that
+ * allocated it comes around again
+ */
+struct FrameAllocation {
+  void* data = nullptr;
+  vk::Buffer buffer = VK_NULL_HANDLE;
+  vk::DeviceSize offset = 0;
+  vk::DeviceSize size = 0;
+
+  /**
+   * For descriptors of type eUniformBufferDynamic/eStorageBufferDynamic
+   * written with FrameAllocator::dynamicDescriptorInfo
+   */
+  u32 dynamicOffset() const { return static_cast<u32>(this->offset); }
+
+  vk::DescriptorBufferInfo descriptorInfo() const {
+    return vk::DescriptorBufferInfo{this->buffer, this->offset, this->size};
+  }
+};
+
+/**
+ * Linear allocator for per frame uniform, storage and instance vertex data
+ *
+ * One persistently mapped, host coherent Buffer is split into a region per
+ * frame in flight. allocate() bumps an atomic offset within the current
+ * region and beginFrame() rewinds a region in O(1) once the frame's fence
+ * has signaled, nothing is ever freed individually.
+ *
+ * Every allocation is aligned to both minUniformBufferOffsetAlignment and
+ * minStorageBufferOffsetAlignment, so any of them can be bound as a dynamic
+ * offset into one descriptor.
+ *
+ * @note allocate() is thread safe, beginFrame() is not
+ */
+class FrameAllocator {
+ public:
+  FrameAllocator(const FrameAllocator&) = delete;
+  FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+  static constexpr vk::DeviceSize DEFAULT_REGION_SIZE = 4ull * 1024 * 1024;
+
+  FrameAllocator(Device& device,
+                 u32 frameCount,
+                 vk::DeviceSize regionSize = DEFAULT_REGION_SIZE);
+
+  /** Rewinds the region of frameIndex, its fence must have signaled */
+  void beginFrame(u32 frameIndex);
+
+  /**
+   * @param alignment extra alignment on top of the descriptor offset
+   * alignment, must be a power of two
+   */
+  FrameAllocation allocate(vk::DeviceSize size, vk::DeviceSize alignment = 1);
+
+  /** Copies value into a fresh allocation */
+  template <typename T>
+  FrameAllocation push(const T& value) {
+    FrameAllocation allocation = allocate(sizeof(T));
+    std::memcpy(allocation.data, &value, sizeof(T));
+    return allocation;
+  }
+
+  /**
+   * Descriptor to write once for dynamic uniform/storage bindings, draws
+   * then pass FrameAllocation::dynamicOffset for data of up to range bytes
+   */
+  vk::DescriptorBufferInfo dynamicDescriptorInfo(vk::DeviceSize range) const {
+    return vk::DescriptorBufferInfo{this->buffer->getBuffer(), 0, range};
+  }
+
+  vk::Buffer getBuffer() const { return this->buffer->getBuffer(); }
+  vk::DeviceSize getRegionSize() const { return this->regionSize; }
+
+  /** Bytes handed out from the current region so far */
+  vk::DeviceSize getUsedBytes() const {
+    return this->head.load(std::memory_order_relaxed) - this->regionBegin;
+  }
+
+ private:
+  Device& device;
+  std::unique_ptr<Buffer> buffer;
+  u8* mapped = nullptr;
+
+  vk::DeviceSize regionSize;
+  vk::DeviceSize minAlignment;
+
+  vk::DeviceSize regionBegin = 0;
+  vk::DeviceSize regionEnd = 0;
+  std::atomic<vk::DeviceSize> head{0};
+};
+
+}  // namespace hep
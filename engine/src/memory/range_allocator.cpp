@@ -0,0 +1,86 @@
+#include "range_allocator.hpp"
+
+#include <cassert>
+
+namespace hep {
+
+static u64 alignUp(u64 value, u64 alignment) {
+  if (alignment <= 1) { return value; }
+  return ((value + alignment - 1) / alignment) * alignment;
+}
+
+RangeAllocator::RangeAllocator(u64 capacity) : capacity{capacity} {
+  if (capacity > 0) { insertFreeRange(0, capacity); }
+}
+
+std::optional<u64> RangeAllocator::allocate(u64 size, u64 alignment) {
+  if (size == 0) { return std::nullopt; }
+
+  // Best fit: smallest free range that still fits once alignment padding is
+  // taken into account
+  for (auto it = this->freeBySize.lower_bound(size);
+       it != this->freeBySize.end(); it++) {
+    u64 rangeOffset = it->second;
+    u64 rangeSize = it->first;
+    u64 alignedOffset = alignUp(rangeOffset, alignment);
+    u64 padding = alignedOffset - rangeOffset;
+
+    if (padding + size > rangeSize) { continue; }
+
+    eraseFreeRange(this->freeByOffset.find(rangeOffset));
+
+    if (padding > 0) { insertFreeRange(rangeOffset, padding); }
+
+    u64 tail = rangeSize - padding - size;
+    if (tail > 0) { insertFreeRange(alignedOffset + size, tail); }
+
+    this->used += size;
+    return alignedOffset;
+  }
+
+  return std::nullopt;
+}
+
+void RangeAllocator::free(u64 offset, u64 size) {
+  assert(offset + size <= this->capacity && "freed range out of bounds");
+  assert(this->used >= size && "freed more than was allocated");
+
+  this->used -= size;
+
+  // Coalesce with the free range directly after
+  auto next = this->freeByOffset.find(offset + size);
+  if (next != this->freeByOffset.end()) {
+    size += next->second.size;
+    eraseFreeRange(next);
+  }
+
+  // Coalesce with the free range directly before
+  auto prev = this->freeByOffset.lower_bound(offset);
+  if (prev != this->freeByOffset.begin()) {
+    prev--;
+    if (prev->first + prev->second.size == offset) {
+      offset = prev->first;
+      size += prev->second.size;
+      eraseFreeRange(prev);
+    }
+  }
+
+  insertFreeRange(offset, size);
+}
+
+u64 RangeAllocator::getLargestFreeRange() const {
+  if (this->freeBySize.empty()) { return 0; }
+  return this->freeBySize.rbegin()->first;
+}
+
+void RangeAllocator::insertFreeRange(u64 offset, u64 size) {
+  auto sizeIt = this->freeBySize.emplace(size, offset);
+  this->freeByOffset.emplace(offset, FreeRange{size, sizeIt});
+}
+
+void RangeAllocator::eraseFreeRange(std::map<u64, FreeRange>::iterator it) {
+  this->freeBySize.erase(it->second.sizeIt);
+  this->freeByOffset.erase(it);
+}
+
+}  // namespace hep
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <map>
+#include <optional>
+
+#include "types.hpp"
+
+namespace hep {
+
+/**
+ * Free-list allocator over an abstract [0, capacity) range
+ *
+ * Free ranges are indexed both by offset (for coalescing on free) and by size
+ * (for best fit lookups), so allocate and free are O(log n) in the number of
+ * free ranges. Knows nothing about Vulkan, callers decide what a unit is
+ * (bytes of a vk::DeviceMemory block, vertices in a shared buffer, ...)
+ */
+class RangeAllocator {
+ public:
+  RangeAllocator(const RangeAllocator&) = delete;
+  RangeAllocator& operator=(const RangeAllocator&) = delete;
+
+  RangeAllocator(u64 capacity);
+  ~RangeAllocator() = default;
+
+  /**
+   * @returns offset of a range of at least size units, aligned to alignment,
+   * or std::nullopt if no free range is large enough
+   */
+  std::optional<u64> allocate(u64 size, u64 alignment = 1);
+
+  /**
+   * @note offset and size must match a previous call to allocate
+   */
+  void free(u64 offset, u64 size);
+
+  u64 getCapacity() const { return this->capacity; }
+  u64 getUsed() const { return this->used; }
+  u64 getFree() const { return this->capacity - this->used; }
+  u64 getLargestFreeRange() const;
+  size_t getFreeRangeCount() const { return this->freeByOffset.size(); }
+  bool isEmpty() const { return this->used == 0; }
+
+ private:
+  using FreeBySize = std::multimap<u64, u64>;
+
+  struct FreeRange {
+    u64 size;
+    FreeBySize::iterator sizeIt;
+  };
+
+  void insertFreeRange(u64 offset, u64 size);
+  void eraseFreeRange(std::map<u64, FreeRange>::iterator it);
+
+  u64 capacity;
+  u64 used = 0;
+
+  std::map<u64, FreeRange> freeByOffset;
+  FreeBySize freeBySize;
+};
+
+}  // namespace hep
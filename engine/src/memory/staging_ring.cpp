@@ -0,0 +1,87 @@
+#include "memory/staging_ring.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include "util/logger.hpp"
+
+namespace hep {
+
+StagingRing::StagingRing(Device& device, vk::DeviceSize capacity)
+    : device{device}, capacity{capacity} {
+  assert(capacity > 0 && "StagingRing needs a non zero capacity");
+
+  // copyBufferToImage wants at least 4 byte aligned source offsets
+  this->minAlignment = std::max<vk::DeviceSize>(
+      this->device.properties.limits.optimalBufferCopyOffsetAlignment, 4);
+
+  this->buffer = std::make_unique<Buffer>(
+      this->device, this->capacity, 1, vk::BufferUsageFlagBits::eTransferSrc,
+      vk::MemoryPropertyFlagBits::eHostVisible |
+          vk::MemoryPropertyFlagBits::eHostCoherent);
+
+  if (this->buffer->map() != vk::Result::eSuccess) {
+    log::fatal("failed to map staging ring buffer");
+    throw std::runtime_error("failed to map staging ring buffer");
+  }
+  this->mapped = static_cast<u8*>(this->buffer->getMappedMemory());
+
+  log::verbose("Staging ring:", this->capacity, "bytes");
+}
+
+bool StagingRing::tryAllocate(vk::DeviceSize size,
+                              vk::DeviceSize alignment,
+                              StagingAllocation& allocation) {
+  assert((alignment & (alignment - 1)) == 0 &&
+         "alignment must be a power of two");
+  assert(size > 0 && size <= this->capacity &&
+         "staging allocation must fit the ring");
+
+  alignment = std::max(alignment, this->minAlignment);
+
+  vk::DeviceSize begin = (this->head + alignment - 1) & ~(alignment - 1);
+
+  // Skip to the start of the next lap rather than splitting the allocation
+  vk::DeviceSize lapOffset = begin % this->capacity;
+  if (lapOffset + size > this->capacity) {
+    begin += this->capacity - lapOffset;
+    lapOffset = 0;
+  }
+
+  if (begin + size - this->tail > this->capacity) { return false; }
+
+  this->head = begin + size;
+  this->blocks.push_back({this->head});
+
+  allocation.data = this->mapped + lapOffset;
+  allocation.buffer = this->buffer->getBuffer();
+  allocation.offset = lapOffset;
+  allocation.size = size;
+  allocation.ringEnd = this->head;
+  return true;
+}
+
+void StagingRing::commit(u64 token,
+                         const std::vector<vk::DeviceSize>& ringEnds) {
+  for (vk::DeviceSize ringEnd : ringEnds) {
+    auto it = std::lower_bound(
+        this->blocks.begin(), this->blocks.end(), ringEnd,
+        [](const Block& block, vk::DeviceSize end) { return block.end < end; });
+    assert(it != this->blocks.end() && it->end == ringEnd &&
+           it->token == PENDING && "committing an unknown staging block");
+    it->token = token;
+  }
+}
+
+void StagingRing::reclaim(u64 completedToken) {
+  // A pending block stops the tail even if later ones are done, its batch
+  // hasn't been submitted yet
+  while (!this->blocks.empty() &&
+         this->blocks.front().token <= completedToken) {
+    this->tail = this->blocks.front().end;
+    this->blocks.pop_front();
+  }
+}
+
+}  // namespace hep
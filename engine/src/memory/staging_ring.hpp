@@ -0,0 +1,89 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "buffer.hpp"
+#include "device.hpp"
+#include "types.hpp"
+
+namespace hep {
+
+/** Contiguous slice of the StagingRing, written by the host */
+struct StagingAllocation {
+  void* data = nullptr;
+  vk::Buffer buffer = VK_NULL_HANDLE;
+  vk::DeviceSize offset = 0;
+  vk::DeviceSize size = 0;
+
+  /** Identifies the allocation when it is committed */
+  vk::DeviceSize ringEnd = 0;
+};
+
+/**
+ * Long lived, persistently mapped ring of host coherent staging memory
+ *
+ * Allocations are carved off the head of the ring and stay pending until
+ * commit() tags them with the UploadToken of the submission that reads
+ * them. reclaim() moves the tail past completed allocations in ring order,
+ * stopping at the first one still pending or in flight, so space comes back
+ * without any per upload allocation of device memory.
+ *
+ * An allocation never wraps around the end of the ring, the remainder is
+ * skipped instead. Head and tail are kept as ever increasing byte counts so
+ * a full and an empty ring can't be confused.
+ *
+ * @note not thread safe, owned and driven by the TransferContext
+ */
+class StagingRing {
+ public:
+  StagingRing(const StagingRing&) = delete;
+  StagingRing& operator=(const StagingRing&) = delete;
+
+  static constexpr vk::DeviceSize DEFAULT_CAPACITY = 32ull * 1024 * 1024;
+
+  StagingRing(Device& device, vk::DeviceSize capacity = DEFAULT_CAPACITY);
+
+  /**
+   * @param alignment must be a power of two, raised to the device's optimal
+   * copy offset alignment
+   * @return false when the ring doesn't have size contiguous bytes free
+   * until more submissions complete
+   */
+  bool tryAllocate(vk::DeviceSize size,
+                   vk::DeviceSize alignment,
+                   StagingAllocation& allocation);
+
+  /** Hands the allocations identified by ringEnds over to token */
+  void commit(u64 token, const std::vector<vk::DeviceSize>& ringEnds);
+
+  /** Frees the space of every allocation whose token has completed */
+  void reclaim(u64 completedToken);
+
+  vk::DeviceSize getCapacity() const { return this->capacity; }
+  vk::DeviceSize getUsedBytes() const { return this->head - this->tail; }
+
+ private:
+  static constexpr u64 PENDING = ~0ull;
+
+  struct Block {
+    vk::DeviceSize end;
+    u64 token = PENDING;
+  };
+
+  Device& device;
+  std::unique_ptr<Buffer> buffer;
+  u8* mapped = nullptr;
+
+  vk::DeviceSize capacity;
+  vk::DeviceSize minAlignment;
+
+  vk::DeviceSize head = 0;
+  vk::DeviceSize tail = 0;
+  // In allocation order, so ends are strictly increasing
+  std::deque<Block> blocks;
+};
+
+}  // namespace hep
@@ -0,0 +1,230 @@
+#include "mesh_cache.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+#include "util/file_io.hpp"
+#include "util/hash.hpp"
+#include "util/logger.hpp"
+#include "util/mapped_file.hpp"
+
+namespace hep {
+
+static constexpr u32 FILE_MAGIC = 0x48534d48;  // "HMSH"
+static constexpr u32 FILE_VERSION = 2;
+
+// Payload offsets are aligned so the mapping can be read as vertices and
+// indices directly
+static constexpr u64 PAYLOAD_ALIGNMENT = 16;
+
+struct MeshFileHeader {
+  u32 magic;
+  u32 version;
+  u64 sourceHash;
+
+  VertexLayout::Format position;
+  VertexLayout::Format color;
+  VertexLayout::Format normal;
+  VertexLayout::Format uv;
+  // 2 or 4, 0 for non indexed meshes
+  u32 indexSize;
+
+  u32 vertexCount;
+  u32 indexCount;
+  f32 boundingSphere[4];
+  // Model::Lod table right after the header, 0 for a single LOD
+  u32 lodCount;
+  u32 reserved;
+
+  u64 vertexOffset;
+  u64 indexOffset;
+  // fnv1a of every field above
+  u64 headerChecksum;
+};
+
+// The checksum covers raw bytes, padding would be uninitialized
+static_assert(sizeof(MeshFileHeader) == 80,
+              "MeshFileHeader must not contain padding");
+static_assert(sizeof(Model::Lod) == 12, "Model::Lod is stored as is");
+
+static u64 alignPayload(u64 offset) {
+  return (offset + PAYLOAD_ALIGNMENT - 1) & ~(PAYLOAD_ALIGNMENT - 1);
+}
+
+static u64 headerChecksum(const MeshFileHeader& header) {
+  return fnv1a(&header, offsetof(MeshFileHeader, headerChecksum));
+}
+
+template <typename Index>
+static u32 findMaxIndex(const u8* indices, u32 indexCount) {
+  u32 maxIndex = 0;
+  for (u32 i = 0; i < indexCount; i++) {
+    Index index;
+    std::memcpy(&index, indices + static_cast<size_t>(i) * sizeof(Index),
+                sizeof(Index));
+    maxIndex = std::max<u32>(maxIndex, index);
+  }
+  return maxIndex;
+}
+
+// Draws aren't bounds checked on the GPU, an index past the model's
+// vertices would fetch from whatever shares the GeometryArena
+static bool indicesInRange(const u8* indices,
+                           u32 indexCount,
+                           u32 indexSize,
+                           u32 vertexCount) {
+  if (indexCount == 0) { return true; }
+  u32 maxIndex = indexSize == sizeof(u16)
+                     ? findMaxIndex<u16>(indices, indexCount)
+                     : findMaxIndex<u32>(indices, indexCount);
+  return maxIndex < vertexCount;
+}
+
+bool writeMeshCache(const std::filesystem::path& path,
+                    const Model::Builder& builder,
+                    u64 sourceHash) {
+  std::vector<u8> vertices = builder.packVertices();
+  vk::IndexType indexType = builder.getIndexType();
+
+  MeshFileHeader header{};
+  header.magic = FILE_MAGIC;
+  header.version = FILE_VERSION;
+  header.sourceHash = sourceHash;
+  header.position = builder.layout.position;
+  header.color = builder.layout.color;
+  header.normal = builder.layout.normal;
+  header.uv = builder.layout.uv;
+  if (!builder.indicies.empty()) {
+    header.indexSize =
+        indexType == vk::IndexType::eUint16 ? sizeof(u16) : sizeof(u32);
+  }
+  header.vertexCount = static_cast<u32>(builder.vertices.size());
+  header.indexCount = static_cast<u32>(builder.indicies.size());
+
+  glm::vec4 boundingSphere = builder.computeBoundingSphere();
+  std::memcpy(header.boundingSphere, &boundingSphere,
+              sizeof(header.boundingSphere));
+
+  header.lodCount = static_cast<u32>(builder.lods.size());
+  u64 lodBytes = static_cast<u64>(header.lodCount) * sizeof(Model::Lod);
+
+  u64 indexBytes = static_cast<u64>(header.indexCount) * header.indexSize;
+  header.vertexOffset = alignPayload(sizeof(MeshFileHeader) + lodBytes);
+  header.indexOffset = alignPayload(header.vertexOffset + vertices.size());
+  header.headerChecksum = headerChecksum(header);
+
+  std::vector<u8> file(header.indexOffset + indexBytes, 0);
+  std::memcpy(file.data(), &header, sizeof(MeshFileHeader));
+  if (lodBytes > 0) {
+    std::memcpy(file.data() + sizeof(MeshFileHeader), builder.lods.data(),
+                lodBytes);
+  }
+  std::memcpy(file.data() + header.vertexOffset, vertices.data(),
+              vertices.size());
+
+  u8* indices = file.data() + header.indexOffset;
+  if (header.indexSize == sizeof(u16)) {
+    for (u32 i = 0; i < header.indexCount; i++) {
+      u16 index = static_cast<u16>(builder.indicies[i]);
+      std::memcpy(indices + i * sizeof(u16), &index, sizeof(u16));
+    }
+  } else if (indexBytes > 0) {
+    std::memcpy(indices, builder.indicies.data(), indexBytes);
+  }
+
+  if (!writeBinaryFileAtomic(path, file.data(), file.size())) { return false; }
+
+  log::trace("saved mesh cache to " + path.string() + " (" +
+             std::to_string(file.size()) + " bytes)");
+  return true;
+}
+
+std::unique_ptr<Model> loadMeshCache(Device& device,
+                                     const std::filesystem::path& path,
+                                     u64 sourceHash) {
+  MappedFile file;
+  if (!file.open(path)) { return nullptr; }
+
+  if (file.getSize() < sizeof(MeshFileHeader)) {
+    log::warning("mesh cache truncated, ignoring:", path.string());
+    return nullptr;
+  }
+
+  MeshFileHeader header{};
+  std::memcpy(&header, file.getData(), sizeof(MeshFileHeader));
+
+  if (header.magic != FILE_MAGIC || header.version != FILE_VERSION ||
+      header.headerChecksum != headerChecksum(header)) {
+    log::warning("mesh cache has unknown format, ignoring:", path.string());
+    return nullptr;
+  }
+
+  if (header.sourceHash != sourceHash) {
+    log::info("mesh cache is stale, ignoring:", path.string());
+    return nullptr;
+  }
+
+  Model::PackedMesh packed{};
+  packed.layout.position = header.position;
+  packed.layout.color = header.color;
+  packed.layout.normal = header.normal;
+  packed.layout.uv = header.uv;
+  packed.vertexCount = header.vertexCount;
+  packed.indexCount = header.indexCount;
+  packed.indexType = header.indexSize == sizeof(u16) ? vk::IndexType::eUint16
+                                                     : vk::IndexType::eUint32;
+  std::memcpy(&packed.boundingSphere, header.boundingSphere,
+              sizeof(header.boundingSphere));
+
+  bool indexSizeValid =
+      header.indexCount == 0 ? header.indexSize == 0
+                             : header.indexSize == sizeof(u16) ||
+                                   header.indexSize == sizeof(u32);
+  u64 vertexBytes =
+      static_cast<u64>(header.vertexCount) * packed.layout.getStride();
+  u64 indexBytes = static_cast<u64>(header.indexCount) * header.indexSize;
+  u64 lodBytes = static_cast<u64>(header.lodCount) * sizeof(Model::Lod);
+  u64 fileSize = file.getSize();
+
+  // Offsets come from the file, compared against what is left after them
+  // so huge values can't wrap around
+  if (!packed.layout.isValid() || !indexSizeValid ||
+      header.vertexCount < 3 || header.lodCount > Model::MAX_LODS ||
+      sizeof(MeshFileHeader) + lodBytes > header.vertexOffset ||
+      header.vertexOffset > fileSize ||
+      vertexBytes > fileSize - header.vertexOffset ||
+      header.indexOffset > fileSize ||
+      indexBytes > fileSize - header.indexOffset) {
+    log::warning("mesh cache is malformed, ignoring:", path.string());
+    return nullptr;
+  }
+
+  packed.lods.resize(header.lodCount);
+  if (lodBytes > 0) {
+    std::memcpy(packed.lods.data(), file.getData() + sizeof(MeshFileHeader),
+                lodBytes);
+  }
+  for (const Model::Lod& lod : packed.lods) {
+    if (static_cast<u64>(lod.firstIndex) + lod.indexCount >
+        header.indexCount) {
+      log::warning("mesh cache is malformed, ignoring:", path.string());
+      return nullptr;
+    }
+  }
+
+  packed.vertices = file.getData() + header.vertexOffset;
+  packed.indices = file.getData() + header.indexOffset;
+
+  if (!indicesInRange(file.getData() + header.indexOffset, header.indexCount,
+                      header.indexSize, header.vertexCount)) {
+    log::warning("mesh cache indexes past its vertices, ignoring:",
+                 path.string());
+    return nullptr;
+  }
+
+  // Staging copies out of the mapping, it can be closed right after
+  return std::make_unique<Model>(device, packed);
+}
+
+}  // namespace hep
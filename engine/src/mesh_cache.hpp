@@ -0,0 +1,39 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+
+#include "device.hpp"
+#include "model.hpp"
+
+namespace hep {
+
+/**
+ * Binary mesh files holding vertices and indices already encoded for the
+ * GPU (Builder::layout, Builder::getIndexType), plus the LOD table
+ *
+ * Loading maps the file and stages both payloads straight from the
+ * mapping, there is no parsing and no intermediate copy, so loading a
+ * cached mesh costs about as much as reading it from disk.
+ *
+ * sourceHash identifies what the cache was built from, typically fnv1a of
+ * the source file plus any import options. A cache written from another
+ * source, by another format version or truncated is treated as a miss.
+ * Files are replaced atomically, the payloads themselves aren't
+ * checksummed. Cache files aren't trusted though, every offset and size
+ * is bounds checked and indices are range checked against the vertex
+ * count before anything is staged, which reads the index payload once
+ * more.
+ */
+
+/** @return false if the file could not be written */
+bool writeMeshCache(const std::filesystem::path& path,
+                    const Model::Builder& builder,
+                    u64 sourceHash);
+
+/** @return nullptr if path is missing, stale or malformed */
+std::unique_ptr<Model> loadMeshCache(Device& device,
+                                     const std::filesystem::path& path,
+                                     u64 sourceHash);
+
+}  // namespace hep
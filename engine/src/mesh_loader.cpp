@@ -0,0 +1,924 @@
+#include "mesh_loader.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+
+#include "util/file_io.hpp"
+#include "util/json.hpp"
+#include "util/logger.hpp"
+
+namespace hep {
+
+static constexpr u32 INVALID_INDEX = ~0u;
+
+/**
+ * Open addressing table of u32 ids into an array owned by the caller,
+ * keys are never stored, equal() compares the candidate with an id.
+ * Sized once for the worst case of every key being unique so it never
+ * rehashes.
+ */
+class DedupTable {
+ public:
+  explicit DedupTable(size_t maxKeys)
+      : slots(std::bit_ceil(std::max<size_t>(maxKeys * 2, 16)),
+              INVALID_INDEX) {
+    this->mask = this->slots.size() - 1;
+  }
+
+  /** @return the id of an equal key, or candidate after inserting it */
+  template <typename Equal>
+  u32 findOrInsert(u64 hash, u32 candidate, Equal equal) {
+    size_t slot = static_cast<size_t>(hash) & this->mask;
+    while (true) {
+      u32 id = this->slots[slot];
+      if (id == INVALID_INDEX) {
+        this->slots[slot] = candidate;
+        return candidate;
+      }
+      if (equal(id)) { return id; }
+      slot = (slot + 1) & this->mask;
+    }
+  }
+
+ private:
+  std::vector<u32> slots;
+  size_t mask = 0;
+};
+
+static u64 mixHash(u64 value) {
+  // splitmix64 finalizer, spreads sequential indices over the whole table
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9ull;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111ebull;
+  value ^= value >> 31;
+  return value;
+}
+
+MeshLoader::MeshLoader(u32 threadCount) : threadPool{threadCount} {}
+
+void MeshLoader::load(const std::filesystem::path& path,
+                      Model::Builder& builder) {
+  std::string extension = path.extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  if (extension == ".obj") {
+    loadObj(path, builder);
+  } else if (extension == ".glb") {
+    loadGlb(path, builder);
+  } else {
+    log::fatal("unsupported mesh format:", path.string());
+    throw std::runtime_error("unsupported mesh format");
+  }
+}
+
+void MeshLoader::loadObj(const std::filesystem::path& path,
+                         Model::Builder& builder) {
+  std::vector<u8> data;
+  if (!readBinaryFile(path, data)) {
+    log::fatal("failed to open mesh:", path.string());
+    throw std::runtime_error("failed to open mesh");
+  }
+
+  try {
+    parseObj(data, builder);
+  } catch (const std::exception& error) {
+    log::fatal("failed to load mesh:", path.string(), "Error:", error.what());
+    throw std::runtime_error("failed to load mesh");
+  }
+}
+
+void MeshLoader::loadGlb(const std::filesystem::path& path,
+                         Model::Builder& builder) {
+  std::vector<u8> data;
+  if (!readBinaryFile(path, data)) {
+    log::fatal("failed to open mesh:", path.string());
+    throw std::runtime_error("failed to open mesh");
+  }
+
+  try {
+    parseGlb(data, builder);
+  } catch (const std::exception& error) {
+    log::fatal("failed to load mesh:", path.string(), "Error:", error.what());
+    throw std::runtime_error("failed to load mesh");
+  }
+}
+
+void MeshLoader::parallelFor(
+    size_t count,
+    size_t minRange,
+    const std::function<void(size_t begin, size_t end)>& task) {
+  if (count == 0) { return; }
+
+  size_t maxRanges =
+      static_cast<size_t>(this->threadPool.getThreadCount()) * TASKS_PER_THREAD;
+  size_t rangeCount =
+      std::clamp<size_t>(count / std::max<size_t>(minRange, 1), 1, maxRanges);
+  size_t rangeSize = (count + rangeCount - 1) / rangeCount;
+
+  for (size_t begin = 0; begin < count; begin += rangeSize) {
+    size_t end = std::min(begin + rangeSize, count);
+    this->threadPool.enqueue(
+        [&task, begin, end](u32 /*threadIndex*/) { task(begin, end); });
+  }
+
+  this->threadPool.wait();
+}
+
+// OBJ
+
+namespace {
+
+// Face corner as written in the file. Negative OBJ references are relative
+// to the elements read so far and are only resolved to absolute indices
+// once every chunk's counts are known.
+struct ObjCorner {
+  static constexpr s32 MISSING = -1;
+
+  // Absolute and 0 based, or relative to the chunk's first element when
+  // the matching bit of relativeMask is set
+  s32 index[3];
+  u32 relativeMask;
+};
+
+struct ObjChunk {
+  const char* begin;
+  const char* end;
+
+  std::vector<glm::vec3> positions;
+  // One per position, white when the file has none
+  std::vector<glm::vec3> colors;
+  std::vector<glm::vec2> uvs;
+  std::vector<glm::vec3> normals;
+  // 3 per triangle
+  std::vector<ObjCorner> corners;
+
+  // Offsets of this chunk's elements in the merged arrays
+  size_t firstPosition = 0;
+  size_t firstUv = 0;
+  size_t firstNormal = 0;
+  size_t firstCorner = 0;
+};
+
+// Resolved corner, the identity of a vertex
+struct ObjVertexKey {
+  u32 position;
+  u32 uv;
+  u32 normal;
+
+  bool operator==(const ObjVertexKey& other) const = default;
+};
+
+bool isBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+const char* skipBlanks(const char* p, const char* end) {
+  while (p < end && isBlank(*p)) { p++; }
+  return p;
+}
+
+const char* skipLine(const char* p, const char* end) {
+  while (p < end && *p != '\n') { p++; }
+  return p < end ? p + 1 : end;
+}
+
+/**
+ * Decimal float without locale lookups or allocations, the hot path of
+ * OBJ parsing. Up to 19 significant digits are kept, which is far more
+ * than f32 can hold.
+ *
+ * @return one past the number, or nullptr if there is none
+ */
+const char* parseFloat(const char* p, const char* end, f32& value) {
+  static constexpr f64 POWERS_OF_TEN[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+
+  u64 mantissa = 0;
+  s32 exponent = 0;
+  u32 digits = 0;
+  bool anyDigit = false;
+
+  while (p < end && *p >= '0' && *p <= '9') {
+    if (digits < 19) {
+      mantissa = mantissa * 10 + static_cast<u64>(*p - '0');
+      if (mantissa != 0) { digits++; }
+    } else {
+      exponent++;
+    }
+    anyDigit = true;
+    p++;
+  }
+
+  if (p < end && *p == '.') {
+    p++;
+    while (p < end && *p >= '0' && *p <= '9') {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + static_cast<u64>(*p - '0');
+        if (mantissa != 0) { digits++; }
+        exponent--;
+      }
+      anyDigit = true;
+      p++;
+    }
+  }
+
+  if (!anyDigit) { return nullptr; }
+
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    const char* exponentStart = p++;
+    bool negativeExponent = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+      negativeExponent = *p == '-';
+      p++;
+    }
+
+    if (p < end && *p >= '0' && *p <= '9') {
+      s32 written = 0;
+      while (p < end && *p >= '0' && *p <= '9') {
+        written = std::min(written * 10 + (*p - '0'), 10000);
+        p++;
+      }
+      exponent += negativeExponent ? -written : written;
+    } else {
+      // Not an exponent after all, e.g. "1e"
+      p = exponentStart;
+    }
+  }
+
+  f64 result = static_cast<f64>(mantissa);
+  if (exponent < 0 && exponent >= -22) {
+    result /= POWERS_OF_TEN[-exponent];
+  } else if (exponent > 0 && exponent <= 22) {
+    result *= POWERS_OF_TEN[exponent];
+  } else if (exponent != 0) {
+    result *= std::pow(10.0, exponent);
+  }
+
+  value = static_cast<f32>(negative ? -result : result);
+  return p;
+}
+
+const char* parseInt(const char* p, const char* end, s64& value) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+')) {
+    negative = *p == '-';
+    p++;
+  }
+
+  if (p >= end || *p < '0' || *p > '9') { return nullptr; }
+
+  s64 result = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    result = std::min<s64>(result * 10 + (*p - '0'), s64{1} << 40);
+    p++;
+  }
+
+  value = negative ? -result : result;
+  return p;
+}
+
+/**
+ * Converts an OBJ reference (1 based, or negative relative to the count
+ * read so far) into an ObjCorner index
+ */
+bool storeReference(s64 reference,
+                    size_t localCount,
+                    u32 attribute,
+                    ObjCorner& corner) {
+  if (reference > 0 && reference <= INT32_MAX) {
+    corner.index[attribute] = static_cast<s32>(reference - 1);
+    return true;
+  }
+  if (reference < 0 && reference >= INT32_MIN) {
+    s64 relative = static_cast<s64>(localCount) + reference;
+    if (relative < INT32_MIN) { return false; }
+
+    corner.index[attribute] = static_cast<s32>(relative);
+    corner.relativeMask |= 1u << attribute;
+    return true;
+  }
+  return false;
+}
+
+void parseObjChunk(ObjChunk& chunk, const char* fileBegin) {
+  // Polygons are buffered until the end of the line, then fanned
+  std::vector<ObjCorner> polygon;
+
+  auto fail = [&](const char* what, const char* at) {
+    throw std::runtime_error(std::string(what) + " at byte " +
+                             std::to_string(at - fileBegin));
+  };
+
+  const char* p = chunk.begin;
+  const char* end = chunk.end;
+
+  while (p < end) {
+    const char* line = skipBlanks(p, end);
+    const char* next = skipLine(line, end);
+    const char* lineEnd = next;
+    if (lineEnd > line && lineEnd[-1] == '\n') { lineEnd--; }
+
+    if (lineEnd - line < 2) {
+      p = next;
+      continue;
+    }
+
+    if (line[0] == 'v' && isBlank(line[1])) {
+      // x y z [w] or x y z r g b
+      f32 values[6] = {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+      u32 count = 0;
+      const char* q = line + 1;
+      while (count < 6) {
+        q = skipBlanks(q, lineEnd);
+        if (q == lineEnd) { break; }
+        q = parseFloat(q, lineEnd, values[count]);
+        if (q == nullptr) { fail("malformed vertex", line); }
+        count++;
+      }
+      if (count < 2) { fail("vertex with less than 2 coordinates", line); }
+
+      chunk.positions.emplace_back(values[0], values[1], values[2]);
+      chunk.colors.push_back(count >= 6
+                                 ? glm::vec3(values[3], values[4], values[5])
+                                 : glm::vec3(1.0f));
+    } else if (line[0] == 'v' && line[1] == 't' &&
+               (lineEnd - line == 2 || isBlank(line[2]))) {
+      f32 values[2] = {0.0f, 0.0f};
+      const char* q = line + 2;
+      for (u32 i = 0; i < 2; i++) {
+        q = skipBlanks(q, lineEnd);
+        // v is optional
+        if (q == lineEnd && i == 1) { break; }
+        q = parseFloat(q, lineEnd, values[i]);
+        if (q == nullptr) { fail("malformed texture coordinate", line); }
+      }
+      chunk.uvs.emplace_back(values[0], values[1]);
+    } else if (line[0] == 'v' && line[1] == 'n' &&
+               (lineEnd - line == 2 || isBlank(line[2]))) {
+      f32 values[3] = {0.0f, 0.0f, 0.0f};
+      const char* q = line + 2;
+      for (u32 i = 0; i < 3; i++) {
+        q = parseFloat(skipBlanks(q, lineEnd), lineEnd, values[i]);
+        if (q == nullptr) { fail("malformed normal", line); }
+      }
+      chunk.normals.emplace_back(values[0], values[1], values[2]);
+    } else if (line[0] == 'f' && isBlank(line[1])) {
+      polygon.clear();
+
+      const char* q = line + 1;
+      while (true) {
+        q = skipBlanks(q, lineEnd);
+        if (q == lineEnd) { break; }
+
+        ObjCorner corner{{ObjCorner::MISSING, ObjCorner::MISSING,
+                          ObjCorner::MISSING},
+                         0};
+        s64 reference = 0;
+
+        q = parseInt(q, lineEnd, reference);
+        if (q == nullptr || !storeReference(reference,
+                                            chunk.positions.size(), 0,
+                                            corner)) {
+          fail("malformed face", line);
+        }
+
+        if (q < lineEnd && *q == '/') {
+          q++;
+          if (q < lineEnd && *q != '/') {
+            q = parseInt(q, lineEnd, reference);
+            if (q == nullptr ||
+                !storeReference(reference, chunk.uvs.size(), 1, corner)) {
+              fail("malformed face", line);
+            }
+          }
+          if (q < lineEnd && *q == '/') {
+            q = parseInt(q + 1, lineEnd, reference);
+            if (q == nullptr ||
+                !storeReference(reference, chunk.normals.size(), 2, corner)) {
+              fail("malformed face", line);
+            }
+          }
+        }
+
+        if (q < lineEnd && !isBlank(*q)) { fail("malformed face", line); }
+        polygon.push_back(corner);
+      }
+
+      if (polygon.size() < 3) { fail("face with less than 3 corners", line); }
+
+      for (size_t i = 1; i + 1 < polygon.size(); i++) {
+        chunk.corners.push_back(polygon[0]);
+        chunk.corners.push_back(polygon[i]);
+        chunk.corners.push_back(polygon[i + 1]);
+      }
+    }
+
+    p = next;
+  }
+}
+
+}  // namespace
+
+void MeshLoader::parseObj(const std::vector<u8>& data,
+                          Model::Builder& builder) {
+  const char* fileBegin = reinterpret_cast<const char*>(data.data());
+  const char* fileEnd = fileBegin + data.size();
+
+  // Line aligned chunks, each parsed independently
+  size_t chunkCount = std::clamp<size_t>(
+      data.size() / MIN_CHUNK_BYTES, 1,
+      static_cast<size_t>(this->threadPool.getThreadCount()) *
+          TASKS_PER_THREAD);
+  size_t chunkBytes = data.size() / chunkCount;
+
+  std::vector<ObjChunk> chunks;
+  chunks.reserve(chunkCount);
+
+  const char* chunkBegin = fileBegin;
+  for (size_t i = 0; i < chunkCount && chunkBegin < fileEnd; i++) {
+    const char* chunkEnd = fileEnd;
+    if (i + 1 < chunkCount) {
+      chunkEnd = skipLine(std::min(chunkBegin + chunkBytes, fileEnd), fileEnd);
+    }
+
+    ObjChunk& chunk = chunks.emplace_back();
+    chunk.begin = chunkBegin;
+    chunk.end = chunkEnd;
+    chunkBegin = chunkEnd;
+  }
+
+  parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      parseObjChunk(chunks[i], fileBegin);
+    }
+  });
+
+  size_t positionCount = 0;
+  size_t uvCount = 0;
+  size_t normalCount = 0;
+  size_t cornerCount = 0;
+  for (ObjChunk& chunk : chunks) {
+    chunk.firstPosition = positionCount;
+    chunk.firstUv = uvCount;
+    chunk.firstNormal = normalCount;
+    chunk.firstCorner = cornerCount;
+
+    positionCount += chunk.positions.size();
+    uvCount += chunk.uvs.size();
+    normalCount += chunk.normals.size();
+    cornerCount += chunk.corners.size();
+  }
+
+  if (cornerCount == 0) { throw std::runtime_error("no faces"); }
+  if (cornerCount >= INVALID_INDEX || positionCount >= INVALID_INDEX) {
+    throw std::runtime_error("too many vertices for 32 bit indices");
+  }
+
+  // Merge the chunks and resolve every reference to an absolute index
+  std::vector<glm::vec3> positions(positionCount);
+  std::vector<glm::vec3> colors(positionCount);
+  std::vector<glm::vec2> uvs(uvCount);
+  std::vector<glm::vec3> normals(normalCount);
+  std::vector<ObjVertexKey> keys(cornerCount);
+
+  parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      ObjChunk& chunk = chunks[i];
+
+      std::copy(chunk.positions.begin(), chunk.positions.end(),
+                positions.begin() + chunk.firstPosition);
+      std::copy(chunk.colors.begin(), chunk.colors.end(),
+                colors.begin() + chunk.firstPosition);
+      std::copy(chunk.uvs.begin(), chunk.uvs.end(),
+                uvs.begin() + chunk.firstUv);
+      std::copy(chunk.normals.begin(), chunk.normals.end(),
+                normals.begin() + chunk.firstNormal);
+
+      const size_t firsts[3] = {chunk.firstPosition, chunk.firstUv,
+                                chunk.firstNormal};
+      const size_t counts[3] = {positionCount, uvCount, normalCount};
+
+      for (size_t c = 0; c < chunk.corners.size(); c++) {
+        const ObjCorner& corner = chunk.corners[c];
+        u32 resolved[3];
+
+        for (u32 attribute = 0; attribute < 3; attribute++) {
+          s64 index = corner.index[attribute];
+          bool relative = corner.relativeMask & (1u << attribute);
+
+          if (!relative && index == ObjCorner::MISSING) {
+            resolved[attribute] = INVALID_INDEX;
+            continue;
+          }
+
+          if (relative) { index += static_cast<s64>(firsts[attribute]); }
+          if (index < 0 || static_cast<size_t>(index) >= counts[attribute]) {
+            throw std::runtime_error("face references a missing element");
+          }
+          resolved[attribute] = static_cast<u32>(index);
+        }
+
+        keys[chunk.firstCorner + c] = {resolved[0], resolved[1], resolved[2]};
+      }
+
+      // Scratch isn't needed anymore, keep peak memory down
+      chunk.positions = {};
+      chunk.colors = {};
+      chunk.uvs = {};
+      chunk.normals = {};
+      chunk.corners = {};
+    }
+  });
+
+  // Deduplicate, compacting the unique keys to the front of keys. A key
+  // is never written past the one being read so this is safe in place.
+  // LODs of whatever the builder held before would index past the new mesh.
+  builder.lods.clear();
+  builder.indicies.resize(cornerCount);
+
+  DedupTable table{cornerCount};
+  u32 vertexCount = 0;
+  for (size_t i = 0; i < cornerCount; i++) {
+    ObjVertexKey key = keys[i];
+
+    u64 hash = mixHash((static_cast<u64>(key.position) << 32) ^
+                       (static_cast<u64>(key.uv) << 16) ^ key.normal);
+    u32 id = table.findOrInsert(hash, vertexCount,
+                                [&](u32 other) { return keys[other] == key; });
+
+    if (id == vertexCount) { keys[vertexCount++] = key; }
+    builder.indicies[i] = id;
+  }
+
+  builder.vertices.resize(vertexCount);
+
+  parallelFor(vertexCount, MIN_RANGE_ELEMENTS, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      const ObjVertexKey& key = keys[i];
+      Model::Vertex& vertex = builder.vertices[i];
+
+      vertex.position = glm::vec2(positions[key.position]);
+      vertex.color = colors[key.position];
+      vertex.uv = key.uv != INVALID_INDEX ? uvs[key.uv] : glm::vec2(0.0f);
+      vertex.normal =
+          key.normal != INVALID_INDEX ? normals[key.normal] : glm::vec3(0.0f);
+    }
+  });
+}
+
+// glTF
+
+namespace {
+
+constexpr u32 GLB_MAGIC = 0x46546c67;  // "glTF"
+constexpr u32 GLB_CHUNK_JSON = 0x4e4f534a;
+constexpr u32 GLB_CHUNK_BIN = 0x004e4942;
+
+constexpr u32 GLTF_BYTE = 5120;
+constexpr u32 GLTF_UNSIGNED_BYTE = 5121;
+constexpr u32 GLTF_SHORT = 5122;
+constexpr u32 GLTF_UNSIGNED_SHORT = 5123;
+constexpr u32 GLTF_UNSIGNED_INT = 5125;
+constexpr u32 GLTF_FLOAT = 5126;
+
+constexpr u32 GLTF_TRIANGLES = 4;
+
+// Validated window into the BIN chunk
+struct GltfAccessor {
+  const u8* data = nullptr;
+  u32 count = 0;
+  u32 stride = 0;
+  u32 componentType = 0;
+  u32 components = 0;
+  bool normalized = false;
+
+  bool isValid() const { return this->data != nullptr; }
+};
+
+u32 componentSize(u32 componentType) {
+  switch (componentType) {
+    case GLTF_BYTE:
+    case GLTF_UNSIGNED_BYTE:
+      return 1;
+    case GLTF_SHORT:
+    case GLTF_UNSIGNED_SHORT:
+      return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+u32 componentCount(const std::string& type) {
+  if (type == "SCALAR") { return 1; }
+  if (type == "VEC2") { return 2; }
+  if (type == "VEC3") { return 3; }
+  if (type == "VEC4") { return 4; }
+  return 0;
+}
+
+GltfAccessor getAccessor(const JsonValue& document,
+                         std::span<const u8> bin,
+                         const JsonValue& accessorIndex) {
+  if (accessorIndex.isNull()) { return {}; }
+
+  const JsonValue& accessor = document["accessors"][accessorIndex.asU32(~0u)];
+  const JsonValue& bufferView =
+      document["bufferViews"][accessor["bufferView"].asU32(~0u)];
+  if (!accessor.isObject() || !bufferView.isObject()) {
+    throw std::runtime_error("invalid accessor, sparse accessors without a "
+                             "buffer view aren't supported");
+  }
+  if (bufferView["buffer"].asU32() != 0 || bin.empty()) {
+    throw std::runtime_error("only the embedded BIN buffer is supported");
+  }
+
+  GltfAccessor view{};
+  view.count = accessor["count"].asU32();
+  view.componentType = accessor["componentType"].asU32();
+  view.components = componentCount(accessor["type"].asString());
+  view.normalized = accessor["normalized"].asBool();
+
+  u32 elementSize = componentSize(view.componentType) * view.components;
+  if (elementSize == 0) { throw std::runtime_error("invalid accessor type"); }
+
+  view.stride = bufferView["byteStride"].asU32(elementSize);
+
+  u64 viewOffset = bufferView["byteOffset"].asU32();
+  u64 viewLength = bufferView["byteLength"].asU32();
+  u64 accessorOffset = accessor["byteOffset"].asU32();
+
+  u64 accessedBytes =
+      view.count == 0
+          ? 0
+          : accessorOffset + static_cast<u64>(view.count - 1) * view.stride +
+                elementSize;
+  if (view.stride < elementSize || viewOffset + viewLength > bin.size() ||
+      accessedBytes > viewLength) {
+    throw std::runtime_error("accessor out of bounds");
+  }
+
+  view.data = bin.data() + viewOffset + accessorOffset;
+  return view;
+}
+
+template <typename T>
+T readUnaligned(const u8* data) {
+  T value;
+  std::memcpy(&value, data, sizeof(T));
+  return value;
+}
+
+/** Component as a float, normalized integers are mapped per the spec */
+f32 readComponent(const GltfAccessor& accessor, u32 element, u32 component) {
+  const u8* data = accessor.data + static_cast<size_t>(element) *
+                                       accessor.stride +
+                   component * componentSize(accessor.componentType);
+
+  switch (accessor.componentType) {
+    case GLTF_FLOAT:
+      return readUnaligned<f32>(data);
+    case GLTF_BYTE: {
+      f32 value = readUnaligned<s8>(data);
+      return accessor.normalized ? std::max(value / 127.0f, -1.0f) : value;
+    }
+    case GLTF_UNSIGNED_BYTE: {
+      f32 value = readUnaligned<u8>(data);
+      return accessor.normalized ? value / 255.0f : value;
+    }
+    case GLTF_SHORT: {
+      f32 value = readUnaligned<s16>(data);
+      return accessor.normalized ? std::max(value / 32767.0f, -1.0f) : value;
+    }
+    case GLTF_UNSIGNED_SHORT: {
+      f32 value = readUnaligned<u16>(data);
+      return accessor.normalized ? value / 65535.0f : value;
+    }
+    case GLTF_UNSIGNED_INT:
+      return static_cast<f32>(readUnaligned<u32>(data));
+    default:
+      return 0.0f;
+  }
+}
+
+u32 readIndex(const GltfAccessor& accessor, u32 element) {
+  const u8* data =
+      accessor.data + static_cast<size_t>(element) * accessor.stride;
+
+  switch (accessor.componentType) {
+    case GLTF_UNSIGNED_BYTE:
+      return readUnaligned<u8>(data);
+    case GLTF_UNSIGNED_SHORT:
+      return readUnaligned<u16>(data);
+    default:
+      return readUnaligned<u32>(data);
+  }
+}
+
+struct GltfPrimitive {
+  GltfAccessor positions;
+  GltfAccessor colors;
+  GltfAccessor normals;
+  GltfAccessor uvs;
+  GltfAccessor indices;
+
+  size_t firstVertex = 0;
+  size_t firstIndex = 0;
+  u32 indexCount = 0;
+};
+
+}  // namespace
+
+void MeshLoader::parseGlb(const std::vector<u8>& data,
+                          Model::Builder& builder) {
+  if (data.size() < 20 || readUnaligned<u32>(data.data()) != GLB_MAGIC ||
+      readUnaligned<u32>(data.data() + 4) != 2) {
+    throw std::runtime_error("not a glTF 2.0 binary file");
+  }
+
+  // The JSON chunk comes first, the BIN chunk is optional
+  u32 jsonLength = readUnaligned<u32>(data.data() + 12);
+  if (readUnaligned<u32>(data.data() + 16) != GLB_CHUNK_JSON ||
+      20ull + jsonLength > data.size()) {
+    throw std::runtime_error("missing JSON chunk");
+  }
+
+  std::string_view jsonText(reinterpret_cast<const char*>(data.data() + 20),
+                            jsonLength);
+  JsonValue document;
+  if (!JsonValue::parse(jsonText, document)) {
+    throw std::runtime_error("malformed JSON chunk");
+  }
+
+  std::span<const u8> bin{};
+  size_t binHeader = 20ull + ((jsonLength + 3ull) & ~3ull);
+  if (binHeader + 8 <= data.size()) {
+    u32 binLength = readUnaligned<u32>(data.data() + binHeader);
+    if (readUnaligned<u32>(data.data() + binHeader + 4) == GLB_CHUNK_BIN &&
+        binHeader + 8 + binLength <= data.size()) {
+      bin = {data.data() + binHeader + 8, binLength};
+    }
+  }
+
+  // Validate every primitive and size the builder before touching data
+  std::vector<GltfPrimitive> primitives;
+  size_t vertexCount = 0;
+  size_t indexCount = 0;
+
+  const JsonValue& meshes = document["meshes"];
+  for (size_t m = 0; m < meshes.size(); m++) {
+    const JsonValue& meshPrimitives = meshes[m]["primitives"];
+    for (size_t p = 0; p < meshPrimitives.size(); p++) {
+      const JsonValue& primitive = meshPrimitives[p];
+      if (primitive["mode"].asU32(GLTF_TRIANGLES) != GLTF_TRIANGLES) {
+        log::warning("skipping glTF primitive that isn't a triangle list");
+        continue;
+      }
+
+      const JsonValue& attributes = primitive["attributes"];
+      GltfPrimitive& entry = primitives.emplace_back();
+      entry.positions = getAccessor(document, bin, attributes["POSITION"]);
+      entry.colors = getAccessor(document, bin, attributes["COLOR_0"]);
+      entry.normals = getAccessor(document, bin, attributes["NORMAL"]);
+      entry.uvs = getAccessor(document, bin, attributes["TEXCOORD_0"]);
+      entry.indices = getAccessor(document, bin, primitive["indices"]);
+
+      u32 count = entry.positions.count;
+      if (!entry.positions.isValid() || entry.positions.components < 2) {
+        throw std::runtime_error("primitive without positions");
+      }
+      for (const GltfAccessor* accessor :
+           {&entry.colors, &entry.normals, &entry.uvs}) {
+        if (accessor->isValid() && accessor->count != count) {
+          throw std::runtime_error("attribute count mismatch");
+        }
+      }
+      // readComponent trusts these, fewer would read past each element
+      // and past the BIN chunk for the last one
+      if ((entry.colors.isValid() && entry.colors.components < 3) ||
+          (entry.normals.isValid() && entry.normals.components != 3) ||
+          (entry.uvs.isValid() && entry.uvs.components != 2)) {
+        throw std::runtime_error("attribute has the wrong component count");
+      }
+      if (entry.indices.isValid()) {
+        u32 type = entry.indices.componentType;
+        bool unsignedType = type == GLTF_UNSIGNED_BYTE ||
+                            type == GLTF_UNSIGNED_SHORT ||
+                            type == GLTF_UNSIGNED_INT;
+        if (entry.indices.components != 1 || !unsignedType) {
+          throw std::runtime_error("invalid index accessor");
+        }
+      }
+
+      entry.indexCount = entry.indices.isValid() ? entry.indices.count : count;
+      entry.indexCount -= entry.indexCount % 3;
+      entry.firstVertex = vertexCount;
+      entry.firstIndex = indexCount;
+
+      vertexCount += count;
+      indexCount += entry.indexCount;
+    }
+  }
+
+  if (indexCount == 0) { throw std::runtime_error("no triangles"); }
+  if (vertexCount >= INVALID_INDEX || indexCount >= INVALID_INDEX) {
+    throw std::runtime_error("too many vertices for 32 bit indices");
+  }
+
+  builder.lods.clear();
+  builder.vertices.resize(vertexCount);
+  builder.indicies.resize(indexCount);
+
+  // Every primitive is split in ranges so one huge primitive still spreads
+  // over the whole pool
+  for (const GltfPrimitive& primitive : primitives) {
+    parallelFor(
+        primitive.positions.count, MIN_RANGE_ELEMENTS,
+        [&](size_t begin, size_t end) {
+          for (size_t i = begin; i < end; i++) {
+            u32 element = static_cast<u32>(i);
+            Model::Vertex& vertex =
+                builder.vertices[primitive.firstVertex + i];
+
+            vertex.position = {readComponent(primitive.positions, element, 0),
+                               readComponent(primitive.positions, element, 1)};
+            vertex.color = glm::vec3(1.0f);
+            if (primitive.colors.isValid()) {
+              for (u32 c = 0; c < 3; c++) {
+                vertex.color[c] = readComponent(primitive.colors, element, c);
+              }
+            }
+            if (primitive.normals.isValid()) {
+              for (u32 c = 0; c < 3; c++) {
+                vertex.normal[c] = readComponent(primitive.normals, element, c);
+              }
+            }
+            if (primitive.uvs.isValid()) {
+              vertex.uv = {readComponent(primitive.uvs, element, 0),
+                           readComponent(primitive.uvs, element, 1)};
+            }
+          }
+        });
+
+    parallelFor(primitive.indexCount, MIN_RANGE_ELEMENTS,
+                [&](size_t begin, size_t end) {
+                  u32 count = primitive.positions.count;
+                  for (size_t i = begin; i < end; i++) {
+                    u32 index = primitive.indices.isValid()
+                                    ? readIndex(primitive.indices,
+                                                static_cast<u32>(i))
+                                    : static_cast<u32>(i);
+                    if (index >= count) {
+                      throw std::runtime_error("index out of range");
+                    }
+                    builder.indicies[primitive.firstIndex + i] =
+                        static_cast<u32>(primitive.firstVertex + index);
+                  }
+                });
+  }
+
+  // Exporters split vertices per primitive and often duplicate them,
+  // merge equal ones by value. Compacts in place like the OBJ path.
+  std::vector<u32> remap(vertexCount);
+  DedupTable table{vertexCount};
+  Model::Vertex::Hasher hasher{};
+
+  u32 uniqueCount = 0;
+  for (size_t i = 0; i < vertexCount; i++) {
+    const Model::Vertex vertex = builder.vertices[i];
+    u32 id = table.findOrInsert(
+        hasher(vertex), uniqueCount,
+        [&](u32 other) { return builder.vertices[other] == vertex; });
+
+    if (id == uniqueCount) { builder.vertices[uniqueCount++] = vertex; }
+    remap[i] = id;
+  }
+
+  builder.vertices.resize(uniqueCount);
+
+  parallelFor(indexCount, MIN_RANGE_ELEMENTS, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      builder.indicies[i] = remap[builder.indicies[i]];
+    }
+  });
+}
+
+}  // namespace hep
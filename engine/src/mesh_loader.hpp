@@ -0,0 +1,63 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+
+#include "model.hpp"
+#include "util/thread_pool.hpp"
+
+namespace hep {
+
+/**
+ * Imports meshes from disk into a Model::Builder
+ *
+ * Supports Wavefront OBJ and binary glTF 2.0 (.glb). Files are parsed in
+ * chunks on the loader's own ThreadPool, duplicated vertices are merged
+ * through an open addressing table sized once for the whole mesh. The
+ * builder's vectors are sized exactly before being filled, only the
+ * per-chunk scratch arrays grow while parsing.
+ *
+ * Model::Vertex is 2D, positions keep x and y. OBJ faces are triangulated
+ * as fans, glTF primitives other than triangle lists are skipped and node
+ * transforms are ignored.
+ *
+ * @note not thread safe, a loader must be driven from a single thread
+ */
+class MeshLoader {
+ public:
+  MeshLoader(const MeshLoader&) = delete;
+  MeshLoader& operator=(const MeshLoader&) = delete;
+
+  explicit MeshLoader(u32 threadCount = ThreadPool::defaultThreadCount());
+
+  /**
+   * Picks the format from the file extension. Replaces the builder's
+   * vertices and indices and clears its lods, its layout is kept.
+   */
+  void load(const std::filesystem::path& path, Model::Builder& builder);
+
+  void loadObj(const std::filesystem::path& path, Model::Builder& builder);
+  void loadGlb(const std::filesystem::path& path, Model::Builder& builder);
+
+  // Chunks smaller than this aren't worth a task
+  static constexpr size_t MIN_CHUNK_BYTES = 256 * 1024;
+  static constexpr size_t MIN_RANGE_ELEMENTS = 64 * 1024;
+  // More tasks than threads so uneven chunks still balance out
+  static constexpr u32 TASKS_PER_THREAD = 4;
+
+ private:
+  void parseObj(const std::vector<u8>& data, Model::Builder& builder);
+  void parseGlb(const std::vector<u8>& data, Model::Builder& builder);
+
+  /**
+   * Runs task over [0, count) split in contiguous ranges of at least
+   * minRange elements and waits for all of them
+   */
+  void parallelFor(size_t count,
+                   size_t minRange,
+                   const std::function<void(size_t begin, size_t end)>& task);
+
+  ThreadPool threadPool;
+};
+
+}  // namespace hep
@@ -0,0 +1,599 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+namespace hep {
+
+namespace mesh_optimizer {
+
+static constexpr u32 INVALID_VERTEX = ~0u;
+
+f32 computeAcmr(const std::vector<u32>& indices,
+                u32 vertexCount,
+                u32 cacheSize) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) { return 0.0f; }
+
+  // A vertex is cached while fewer than cacheSize misses happened since it
+  // was loaded, timestamps avoid simulating the FIFO itself
+  std::vector<u32> cacheTime(vertexCount, 0);
+  u32 time = cacheSize + 1;
+  u64 misses = 0;
+
+  for (u32 index : indices) {
+    if (time - cacheTime[index] > cacheSize) {
+      cacheTime[index] = time++;
+      misses++;
+    }
+  }
+
+  return static_cast<f32>(misses) / static_cast<f32>(triangleCount);
+}
+
+void reorderVertexCache(std::vector<u32>& indices,
+                        u32 vertexCount,
+                        std::vector<u32>& clusters) {
+  clusters.clear();
+
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) { return; }
+
+  // Triangles around each vertex, and how many of them are still to emit
+  std::vector<u32> liveTriangles(vertexCount, 0);
+  for (u32 index : indices) { liveTriangles[index]++; }
+
+  std::vector<u32> adjacencyOffsets(vertexCount + 1, 0);
+  std::inclusive_scan(liveTriangles.begin(), liveTriangles.end(),
+                      adjacencyOffsets.begin() + 1);
+
+  std::vector<u32> adjacency(indices.size());
+  std::vector<u32> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+  for (size_t i = 0; i < indices.size(); i++) {
+    adjacency[cursor[indices[i]]++] = static_cast<u32>(i / 3);
+  }
+
+  std::vector<u32> cacheTime(vertexCount, 0);
+  std::vector<u8> emitted(triangleCount, 0);
+  std::vector<u32> deadEnds;
+  deadEnds.reserve(indices.size());
+  std::vector<u32> candidates;
+
+  std::vector<u32> output;
+  output.reserve(indices.size());
+
+  u32 time = VERTEX_CACHE_SIZE + 1;
+  u32 scan = 0;
+  u32 fanning = indices[0];
+  bool newCluster = true;
+
+  while (true) {
+    if (newCluster) {
+      clusters.push_back(static_cast<u32>(output.size() / 3));
+      newCluster = false;
+    }
+
+    // Emit every remaining triangle around the fanning vertex
+    candidates.clear();
+    for (u32 a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1];
+         a++) {
+      u32 triangle = adjacency[a];
+      if (emitted[triangle]) { continue; }
+
+      for (u32 corner = 0; corner < 3; corner++) {
+        u32 vertex = indices[triangle * 3 + corner];
+        output.push_back(vertex);
+        deadEnds.push_back(vertex);
+        candidates.push_back(vertex);
+        liveTriangles[vertex]--;
+
+        if (time - cacheTime[vertex] > VERTEX_CACHE_SIZE) {
+          cacheTime[vertex] = time++;
+        }
+      }
+      emitted[triangle] = 1;
+    }
+
+    // Prefer the oldest candidate that will still be cached once all its
+    // triangles are emitted, each of them can push 2 new vertices
+    u32 next = INVALID_VERTEX;
+    s64 bestPriority = -1;
+    for (u32 vertex : candidates) {
+      if (liveTriangles[vertex] == 0) { continue; }
+
+      s64 age = time - cacheTime[vertex];
+      s64 priority = 0;
+      if (age + 2 * static_cast<s64>(liveTriangles[vertex]) <=
+          VERTEX_CACHE_SIZE) {
+        priority = age;
+      }
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        next = vertex;
+      }
+    }
+
+    if (next == INVALID_VERTEX) {
+      // Dead end, fall back to recently used vertices, then to input order
+      newCluster = true;
+
+      while (!deadEnds.empty()) {
+        u32 vertex = deadEnds.back();
+        deadEnds.pop_back();
+        if (liveTriangles[vertex] > 0) {
+          next = vertex;
+          break;
+        }
+      }
+
+      while (next == INVALID_VERTEX && scan < vertexCount) {
+        if (liveTriangles[scan] > 0) { next = scan; }
+        scan++;
+      }
+
+      if (next == INVALID_VERTEX) { break; }
+    }
+
+    fanning = next;
+  }
+
+  indices.swap(output);
+}
+
+void reorderOverdraw(std::vector<u32>& indices,
+                     const std::vector<Model::Vertex>& vertices,
+                     const std::vector<u32>& clusters) {
+  if (clusters.size() < 2) { return; }
+
+  u32 triangleCount = static_cast<u32>(indices.size() / 3);
+  u32 vertexCount = static_cast<u32>(vertices.size());
+
+  auto clusterEnd = [&](size_t cluster) {
+    return cluster + 1 < clusters.size() ? clusters[cluster + 1]
+                                         : triangleCount;
+  };
+
+  auto triangleCenter = [&](u32 triangle) {
+    const u32* corners = &indices[triangle * 3];
+    return (glm::vec3(vertices[corners[0]].position, 0.0f) +
+            glm::vec3(vertices[corners[1]].position, 0.0f) +
+            glm::vec3(vertices[corners[2]].position, 0.0f)) /
+           3.0f;
+  };
+
+  glm::vec3 meshCenter{0.0f};
+  for (u32 triangle = 0; triangle < triangleCount; triangle++) {
+    meshCenter += triangleCenter(triangle);
+  }
+  meshCenter /= static_cast<f32>(triangleCount);
+
+  // Positive when the cluster faces away from the center
+  std::vector<f32> sortKeys(clusters.size(), 0.0f);
+  bool anyNormal = false;
+
+  for (size_t cluster = 0; cluster < clusters.size(); cluster++) {
+    glm::vec3 center{0.0f};
+    glm::vec3 normal{0.0f};
+
+    for (u32 triangle = clusters[cluster]; triangle < clusterEnd(cluster);
+         triangle++) {
+      center += triangleCenter(triangle);
+      for (u32 corner = 0; corner < 3; corner++) {
+        normal += vertices[indices[triangle * 3 + corner]].normal;
+      }
+    }
+
+    f32 length = glm::length(normal);
+    if (length <= 1e-6f) { continue; }
+
+    center /= static_cast<f32>(clusterEnd(cluster) - clusters[cluster]);
+    sortKeys[cluster] = glm::dot(center - meshCenter, normal / length);
+    anyNormal = true;
+  }
+
+  if (!anyNormal) { return; }
+
+  std::vector<u32> order(clusters.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](u32 a, u32 b) {
+    return sortKeys[a] > sortKeys[b];
+  });
+
+  std::vector<u32> sorted;
+  sorted.reserve(indices.size());
+  for (u32 cluster : order) {
+    sorted.insert(sorted.end(), indices.begin() + clusters[cluster] * 3,
+                  indices.begin() + clusterEnd(cluster) * 3);
+  }
+
+  f32 acmrBefore = computeAcmr(indices, vertexCount);
+  f32 acmrAfter = computeAcmr(sorted, vertexCount);
+  if (acmrAfter > acmrBefore * OVERDRAW_ACMR_THRESHOLD) { return; }
+
+  indices.swap(sorted);
+}
+
+void reorderVertexFetch(std::vector<u32>& indices,
+                        std::vector<Model::Vertex>& vertices) {
+  std::vector<u32> remap(vertices.size(), INVALID_VERTEX);
+  u32 vertexCount = 0;
+
+  for (u32& index : indices) {
+    if (remap[index] == INVALID_VERTEX) { remap[index] = vertexCount++; }
+    index = remap[index];
+  }
+
+  std::vector<Model::Vertex> reordered(vertexCount);
+  for (size_t vertex = 0; vertex < vertices.size(); vertex++) {
+    if (remap[vertex] != INVALID_VERTEX) {
+      reordered[remap[vertex]] = vertices[vertex];
+    }
+  }
+
+  vertices.swap(reordered);
+}
+
+namespace {
+
+// Quadrics live in position + color space, positions are normalized to
+// the bounding sphere so errors come out relative to its radius
+constexpr u32 QUADRIC_DIMENSION = 5;
+// A full color swing costs as much as moving this fraction of the radius
+constexpr f64 COLOR_WEIGHT = 0.5;
+// Keeps outlines in place, per unit of boundary edge length
+constexpr f64 BOUNDARY_WEIGHT = 10.0;
+
+using Point = std::array<f64, QUADRIC_DIMENSION>;
+
+f64 dot(const Point& a, const Point& b) {
+  f64 result = 0.0;
+  for (u32 i = 0; i < QUADRIC_DIMENSION; i++) { result += a[i] * b[i]; }
+  return result;
+}
+
+/**
+ * Weighted sum of squared distances to a set of planes, v^T A v + 2 b.v + c
+ * with the symmetric A packed as its upper triangle, row by row
+ */
+struct Quadric {
+  static constexpr u32 PACKED_SIZE =
+      QUADRIC_DIMENSION * (QUADRIC_DIMENSION + 1) / 2;
+
+  f64 a[PACKED_SIZE]{};
+  f64 b[QUADRIC_DIMENSION]{};
+  f64 c = 0.0;
+  f64 weight = 0.0;
+
+  void add(const Quadric& other) {
+    for (u32 i = 0; i < PACKED_SIZE; i++) { this->a[i] += other.a[i]; }
+    for (u32 i = 0; i < QUADRIC_DIMENSION; i++) { this->b[i] += other.b[i]; }
+    this->c += other.c;
+    this->weight += other.weight;
+  }
+
+  /** Mean squared distance of point to the accumulated planes */
+  f64 evaluate(const Point& point) const {
+    f64 result = this->c;
+
+    u32 k = 0;
+    for (u32 i = 0; i < QUADRIC_DIMENSION; i++) {
+      for (u32 j = i; j < QUADRIC_DIMENSION; j++) {
+        f64 term = this->a[k++] * point[i] * point[j];
+        result += i == j ? term : 2.0 * term;
+      }
+      result += 2.0 * this->b[i] * point[i];
+    }
+
+    return this->weight > 0.0 ? std::max(result, 0.0) / this->weight : 0.0;
+  }
+};
+
+/** Plane spanned by a triangle, weighted by its area (Hoppe 1999) */
+Quadric triangleQuadric(const Point& p0, const Point& p1, const Point& p2) {
+  Point e1{};
+  Point e2{};
+  for (u32 i = 0; i < QUADRIC_DIMENSION; i++) {
+    e1[i] = p1[i] - p0[i];
+    e2[i] = p2[i] - p0[i];
+  }
+
+  f64 area = 0.5 * std::abs(e1[0] * e2[1] - e1[1] * e2[0]);
+
+  // Orthonormal basis of the plane
+  f64 length1 = std::sqrt(dot(e1, e1));
+  if (length1 <= 1e-12) { return {}; }
+  for (f64& value : e1) { value /= length1; }
+
+  f64 projection = dot(e1, e2);
+  for (u32 i = 0; i < QUADRIC_DIMENSION; i++) { e2[i] -= projection * e1[i]; }
+  f64 length2 = std::sqrt(dot(e2, e2));
+  if (length2 <= 1e-12) { return {}; }
+  for (f64& value : e2) { value /= length2; }
+
+  f64 d1 = dot(p0, e1);
+  f64 d2 = dot(p0, e2);
+
+  Quadric quadric{};
+  u32 k = 0;
+  for (u32 i = 0; i < QUADRIC_DIMENSION; i++) {
+    for (u32 j = i; j < QUADRIC_DIMENSION; j++) {
+      f64 identity = i == j ? 1.0 : 0.0;
+      quadric.a[k++] = area * (identity - e1[i] * e1[j] - e2[i] * e2[j]);
+    }
+    quadric.b[i] = area * (d1 * e1[i] + d2 * e2[i] - p0[i]);
+  }
+  quadric.c = area * (dot(p0, p0) - d1 * d1 - d2 * d2);
+  quadric.weight = area;
+
+  return quadric;
+}
+
+/** Line through a boundary edge, in the position plane only */
+Quadric boundaryQuadric(const Point& p0, const Point& p1) {
+  f64 dx = p1[0] - p0[0];
+  f64 dy = p1[1] - p0[1];
+  f64 length = std::sqrt(dx * dx + dy * dy);
+  if (length <= 1e-12) { return {}; }
+
+  f64 nx = -dy / length;
+  f64 ny = dx / length;
+  f64 d = nx * p0[0] + ny * p0[1];
+  f64 weight = BOUNDARY_WEIGHT * length;
+
+  // Packed indices of (0, 0), (0, 1) and (1, 1)
+  Quadric quadric{};
+  quadric.a[0] = weight * nx * nx;
+  quadric.a[1] = weight * nx * ny;
+  quadric.a[QUADRIC_DIMENSION] = weight * ny * ny;
+  quadric.b[0] = -weight * d * nx;
+  quadric.b[1] = -weight * d * ny;
+  quadric.c = weight * d * d;
+  quadric.weight = weight;
+
+  return quadric;
+}
+
+struct Edge {
+  u32 a;
+  u32 b;
+  // Triangles sharing the edge, 1 on boundaries
+  u32 triangleCount;
+};
+
+std::vector<Edge> collectEdges(const std::vector<u32>& indices) {
+  std::vector<u64> keys;
+  keys.reserve(indices.size());
+
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    for (u32 corner = 0; corner < 3; corner++) {
+      u32 a = indices[i + corner];
+      u32 b = indices[i + (corner + 1) % 3];
+      keys.push_back(static_cast<u64>(std::min(a, b)) << 32 | std::max(a, b));
+    }
+  }
+  std::sort(keys.begin(), keys.end());
+
+  std::vector<Edge> edges;
+  for (size_t i = 0; i < keys.size();) {
+    size_t run = i;
+    while (run < keys.size() && keys[run] == keys[i]) { run++; }
+
+    edges.push_back({static_cast<u32>(keys[i] >> 32),
+                     static_cast<u32>(keys[i] & 0xffffffffu),
+                     static_cast<u32>(run - i)});
+    i = run;
+  }
+
+  return edges;
+}
+
+f64 signedArea(const Point& p0, const Point& p1, const Point& p2) {
+  return (p1[0] - p0[0]) * (p2[1] - p0[1]) - (p1[1] - p0[1]) * (p2[0] - p0[0]);
+}
+
+struct Collapse {
+  f64 cost;
+  u32 from;
+  u32 to;
+  u32 triangleCount;
+};
+
+}  // namespace
+
+std::vector<u32> simplify(const std::vector<u32>& indices,
+                          const std::vector<Model::Vertex>& vertices,
+                          size_t targetIndexCount,
+                          f32 targetError,
+                          f32& error) {
+  error = 0.0f;
+
+  std::vector<u32> result = indices;
+  u32 vertexCount = static_cast<u32>(vertices.size());
+  if (result.size() <= targetIndexCount || vertexCount == 0) { return result; }
+
+  // Same sphere as Builder::computeBoundingSphere
+  glm::vec2 min = vertices[0].position;
+  glm::vec2 max = min;
+  for (const Model::Vertex& vertex : vertices) {
+    min = glm::min(min, vertex.position);
+    max = glm::max(max, vertex.position);
+  }
+  glm::vec2 center = (min + max) * 0.5f;
+  f32 radius = 0.0f;
+  for (const Model::Vertex& vertex : vertices) {
+    radius = std::max(radius, glm::length(vertex.position - center));
+  }
+  if (radius <= 0.0f) { return result; }
+
+  std::vector<Point> points(vertexCount);
+  for (u32 i = 0; i < vertexCount; i++) {
+    glm::vec2 position = (vertices[i].position - center) / radius;
+    const glm::vec3& color = vertices[i].color;
+    points[i] = {position.x, position.y, color.r * COLOR_WEIGHT,
+                 color.g * COLOR_WEIGHT, color.b * COLOR_WEIGHT};
+  }
+
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t i = 0; i < result.size(); i += 3) {
+    Quadric quadric = triangleQuadric(
+        points[result[i]], points[result[i + 1]], points[result[i + 2]]);
+    for (u32 corner = 0; corner < 3; corner++) {
+      quadrics[result[i + corner]].add(quadric);
+    }
+  }
+  for (const Edge& edge : collectEdges(result)) {
+    if (edge.triangleCount != 1) { continue; }
+
+    Quadric quadric = boundaryQuadric(points[edge.a], points[edge.b]);
+    quadrics[edge.a].add(quadric);
+    quadrics[edge.b].add(quadric);
+  }
+
+  f64 maxCost = static_cast<f64>(targetError) * targetError;
+  f64 worstCost = 0.0;
+
+  std::vector<u32> remap(vertexCount);
+  std::iota(remap.begin(), remap.end(), 0);
+  std::vector<u8> boundary(vertexCount);
+  std::vector<u8> locked(vertexCount);
+  std::vector<u32> adjacencyOffsets(vertexCount + 1);
+  std::vector<u32> adjacency;
+  std::vector<Collapse> collapses;
+
+  // Every pass collapses a set of edges whose neighbourhoods don't overlap,
+  // cheapest first, then rebuilds the connectivity
+  while (result.size() > targetIndexCount) {
+    std::vector<Edge> edges = collectEdges(result);
+
+    std::fill(boundary.begin(), boundary.end(), 0);
+    std::fill(locked.begin(), locked.end(), 0);
+    for (const Edge& edge : edges) {
+      if (edge.triangleCount == 1) {
+        boundary[edge.a] = boundary[edge.b] = 1;
+      } else if (edge.triangleCount > 2) {
+        // Non manifold, leave it alone
+        locked[edge.a] = locked[edge.b] = 1;
+      }
+    }
+
+    std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+    for (u32 index : result) { adjacencyOffsets[index + 1]++; }
+    std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(),
+                     adjacencyOffsets.begin());
+    adjacency.resize(result.size());
+    std::vector<u32> cursor(adjacencyOffsets.begin(),
+                            adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < result.size(); i++) {
+      adjacency[cursor[result[i]]++] = static_cast<u32>(i / 3);
+    }
+
+    collapses.clear();
+    for (const Edge& edge : edges) {
+      Collapse best{-1.0, 0, 0, edge.triangleCount};
+
+      for (u32 direction = 0; direction < 2; direction++) {
+        u32 from = direction == 0 ? edge.a : edge.b;
+        u32 to = direction == 0 ? edge.b : edge.a;
+
+        // Boundary vertices may only slide along the boundary
+        if (locked[from] || (boundary[from] && edge.triangleCount != 1)) {
+          continue;
+        }
+
+        Quadric quadric = quadrics[from];
+        quadric.add(quadrics[to]);
+        f64 cost = quadric.evaluate(points[to]);
+
+        if (best.cost < 0.0 || cost < best.cost) {
+          best.cost = cost;
+          best.from = from;
+          best.to = to;
+        }
+      }
+
+      if (best.cost >= 0.0 && best.cost <= maxCost) {
+        collapses.push_back(best);
+      }
+    }
+
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Collapse& a, const Collapse& b) {
+                return a.cost < b.cost;
+              });
+
+    size_t triangleCount = result.size() / 3;
+    size_t targetTriangles = targetIndexCount / 3;
+    u32 collapsed = 0;
+
+    for (const Collapse& collapse : collapses) {
+      if (triangleCount <= targetTriangles) { break; }
+      if (locked[collapse.from] || locked[collapse.to]) { continue; }
+
+      // Moving from onto to must not flip or flatten any remaining triangle
+      bool valid = true;
+      for (u32 a = adjacencyOffsets[collapse.from];
+           a < adjacencyOffsets[collapse.from + 1] && valid; a++) {
+        const u32* corners = &result[adjacency[a] * 3];
+        if (corners[0] == collapse.to || corners[1] == collapse.to ||
+            corners[2] == collapse.to) {
+          continue;
+        }
+
+        Point moved[3];
+        for (u32 corner = 0; corner < 3; corner++) {
+          u32 index = corners[corner] == collapse.from ? collapse.to
+                                                       : corners[corner];
+          moved[corner] = points[index];
+        }
+
+        f64 before = signedArea(points[corners[0]], points[corners[1]],
+                                points[corners[2]]);
+        f64 after = signedArea(moved[0], moved[1], moved[2]);
+        valid = before * after > 0.0;
+      }
+      if (!valid) { continue; }
+
+      remap[collapse.from] = collapse.to;
+      quadrics[collapse.to].add(quadrics[collapse.from]);
+      worstCost = std::max(worstCost, collapse.cost);
+
+      // Lock the whole neighbourhood, later collapses in this pass then
+      // never see a triangle this one changed
+      for (u32 a = adjacencyOffsets[collapse.from];
+           a < adjacencyOffsets[collapse.from + 1]; a++) {
+        for (u32 corner = 0; corner < 3; corner++) {
+          locked[result[adjacency[a] * 3 + corner]] = 1;
+        }
+      }
+      locked[collapse.to] = 1;
+
+      triangleCount -= collapse.triangleCount;
+      collapsed++;
+    }
+
+    if (collapsed == 0) { break; }
+
+    // Apply the collapses and drop the triangles they flattened
+    size_t write = 0;
+    for (size_t i = 0; i < result.size(); i += 3) {
+      u32 a = remap[result[i]];
+      u32 b = remap[result[i + 1]];
+      u32 c = remap[result[i + 2]];
+      if (a == b || b == c || a == c) { continue; }
+
+      result[write++] = a;
+      result[write++] = b;
+      result[write++] = c;
+    }
+    result.resize(write);
+  }
+
+  error = static_cast<f32>(std::sqrt(worstCost));
+  return result;
+}
+
+}  // namespace mesh_optimizer
+
+}  // namespace hep
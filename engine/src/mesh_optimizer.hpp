@@ -0,0 +1,84 @@
+#pragma once
+
+#include <vector>
+
+#include "model.hpp"
+
+namespace hep {
+
+/**
+ * Offline passes for indexed triangle lists, run through
+ * Model::Builder::optimize and Model::Builder::generateLods
+ *
+ * The reorder passes only permute triangles and vertices, the rendered
+ * mesh is unchanged. Run in order: vertex cache, overdraw, vertex fetch.
+ */
+namespace mesh_optimizer {
+
+/** FIFO post-transform cache size assumed by the passes and statistics */
+constexpr u32 VERTEX_CACHE_SIZE = 16;
+
+/** Overdraw ordering is dropped if it costs more ACMR than this factor */
+constexpr f32 OVERDRAW_ACMR_THRESHOLD = 1.05f;
+
+/**
+ * Average cache miss ratio, transformed vertices per triangle on a FIFO
+ * cache. 0.5 is the ideal for large regular grids, 3 means no reuse.
+ */
+f32 computeAcmr(const std::vector<u32>& indices,
+                u32 vertexCount,
+                u32 cacheSize = VERTEX_CACHE_SIZE);
+
+/**
+ * Reorders triangles for post-transform cache hits with Tipsify (Sander,
+ * Nehab and Barczak 2007)
+ *
+ * @param clusters receives the first triangle of every run that starts
+ * from a cold cache, the units reorderOverdraw may move around
+ */
+void reorderVertexCache(std::vector<u32>& indices,
+                        u32 vertexCount,
+                        std::vector<u32>& clusters);
+
+/**
+ * Sorts clusters so those facing away from the mesh center, which tend to
+ * occlude the rest, come first. Keeps the input order when that would push
+ * ACMR past OVERDRAW_ACMR_THRESHOLD times the current one.
+ *
+ * Cluster normals come from Vertex::normal, flat meshes without normals
+ * have nothing to sort on and keep their order.
+ */
+void reorderOverdraw(std::vector<u32>& indices,
+                     const std::vector<Model::Vertex>& vertices,
+                     const std::vector<u32>& clusters);
+
+/**
+ * Renumbers vertices in first use order so vertex fetches walk memory
+ * forward, unreferenced vertices are dropped
+ */
+void reorderVertexFetch(std::vector<u32>& indices,
+                        std::vector<Model::Vertex>& vertices);
+
+/**
+ * Quadric error metric simplification (Garland and Heckbert 1998) over
+ * position and color, restricted to collapsing a vertex into one of its
+ * neighbours so the result still indexes the original vertices
+ *
+ * Errors are relative to the bounding sphere radius (see
+ * Builder::computeBoundingSphere). Boundary edges only collapse along
+ * themselves and collapses that would flip a triangle are rejected, so
+ * outlines are kept. Attribute seams count as boundaries.
+ *
+ * @param error receives the largest error introduced
+ * @return at most targetIndexCount indices, more if targetError is
+ * reached first
+ */
+std::vector<u32> simplify(const std::vector<u32>& indices,
+                          const std::vector<Model::Vertex>& vertices,
+                          size_t targetIndexCount,
+                          f32 targetError,
+                          f32& error);
+
+}  // namespace mesh_optimizer
+
+}  // namespace hep
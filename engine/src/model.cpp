@@ -1,123 +1,309 @@
 #include "model.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <stdexcept>
 
+#include "mesh_optimizer.hpp"
 #include "util/logger.hpp"
 
 namespace hep {
 
+// Vertex::Hasher reads the raw bytes, padding would make equal vertices
+// hash differently
+static_assert(sizeof(Model::Vertex) == 10 * sizeof(float),
+              "Model::Vertex must not contain padding");
+
 std::vector<vk::VertexInputBindingDescription>
 Model::Vertex::getBindingDescriptions() {
+  return VertexLayout::standard().getBindingDescriptions(VERTEX_BINDING);
+}
+
+std::vector<vk::VertexInputAttributeDescription>
+Model::Vertex::getAttributeDescriptions() {
+  return VertexLayout::standard().getAttributeDescriptions(VERTEX_BINDING);
+}
+
+Model::Builder::OptimizationStats Model::Builder::optimize() {
+  assert(this->lods.empty() && "optimize must run before generateLods");
+
+  OptimizationStats stats{};
+  if (this->indicies.empty()) { return stats; }
+
+  u32 vertexCount = static_cast<u32>(this->vertices.size());
+  for (u32 index : this->indicies) {
+    if (index >= vertexCount) {
+      log::fatal("mesh index", index, "is out of range, vertex count is",
+                 vertexCount);
+      throw std::runtime_error("mesh index out of range");
+    }
+  }
+
+  stats.acmrBefore = mesh_optimizer::computeAcmr(this->indicies, vertexCount);
+
+  std::vector<u32> clusters;
+  mesh_optimizer::reorderVertexCache(this->indicies, vertexCount, clusters);
+  mesh_optimizer::reorderOverdraw(this->indicies, this->vertices, clusters);
+  mesh_optimizer::reorderVertexFetch(this->indicies, this->vertices);
+
+  u32 optimizedCount = static_cast<u32>(this->vertices.size());
+  stats.acmrAfter =
+      mesh_optimizer::computeAcmr(this->indicies, optimizedCount);
+
+  stats.bytesSaved = static_cast<u64>(vertexCount - optimizedCount) *
+                     this->layout.getStride();
+  if (getIndexType() == vk::IndexType::eUint16) {
+    stats.bytesSaved += this->indicies.size() * (sizeof(u32) - sizeof(u16));
+  }
+
+  log::verbose("Mesh optimized:", this->indicies.size() / 3,
+               "triangles, ACMR", stats.acmrBefore, "->", stats.acmrAfter,
+               ",", stats.bytesSaved, "bytes saved");
+
+  return stats;
+}
+
+u32 Model::Builder::generateLods(u32 lodCount, f32 reduction, f32 maxError) {
+  assert(this->lods.empty() && "LODs were already generated");
+  assert(lodCount >= 1 && lodCount <= MAX_LODS && "invalid LOD count");
+  assert(reduction > 0.0f && reduction < 1.0f && "invalid LOD reduction");
+
+  u32 baseCount = static_cast<u32>(this->indicies.size());
+  this->lods.push_back({0, baseCount, 0.0f});
+  if (baseCount == 0) { return 1; }
+
+  // Every level is simplified from the original, errors don't compound
+  std::vector<u32> base = this->indicies;
+  u32 vertexCount = static_cast<u32>(this->vertices.size());
+  this->indicies.reserve(static_cast<size_t>(baseCount / (1.0f - reduction)));
+
+  std::vector<u32> clusters;
+  size_t target = baseCount;
+  for (u32 level = 1; level < lodCount; level++) {
+    target = static_cast<size_t>(static_cast<f32>(target) * reduction);
+    target -= target % 3;
+    if (target < 3) { break; }
+
+    f32 error = 0.0f;
+    std::vector<u32> lodIndices =
+        mesh_optimizer::simplify(base, this->vertices, target, maxError, error);
+
+    // maxError stopped it short of the target, not worth another level
+    const Lod previous = this->lods.back();
+    if (lodIndices.size() > previous.indexCount * (1.0f + reduction) * 0.5f) {
+      break;
+    }
+
+    mesh_optimizer::reorderVertexCache(lodIndices, vertexCount, clusters);
+
+    // selectLod relies on errors growing with the level
+    this->lods.push_back({static_cast<u32>(this->indicies.size()),
+                          static_cast<u32>(lodIndices.size()),
+                          std::max(error, previous.error)});
+    this->indicies.insert(this->indicies.end(), lodIndices.begin(),
+                          lodIndices.end());
+  }
+
+  log::verbose("Generated", this->lods.size(), "LODs,",
+               this->lods.front().indexCount / 3, "->",
+               this->lods.back().indexCount / 3, "triangles, error",
+               this->lods.back().error);
+
+  return static_cast<u32>(this->lods.size());
+}
+
+vk::IndexType Model::Builder::getIndexType() const {
+  // Index values are relative to the mesh's own vertices
+  bool fits16 = this->vertices.size() <= static_cast<size_t>(~u16{0}) + 1;
+  return this->allowIndex16 && fits16 ? vk::IndexType::eUint16
+                                      : vk::IndexType::eUint32;
+}
+
+glm::vec4 Model::Builder::computeBoundingSphere() const {
+  if (this->vertices.empty()) { return glm::vec4{0.0f}; }
+
+  // Centered on the bounding box, loose but cheap
+  glm::vec2 min = this->vertices[0].position;
+  glm::vec2 max = min;
+  for (const Vertex& vertex : this->vertices) {
+    min = glm::min(min, vertex.position);
+    max = glm::max(max, vertex.position);
+  }
+
+  glm::vec2 center = (min + max) * 0.5f;
+  float radius = 0.0f;
+  for (const Vertex& vertex : this->vertices) {
+    radius = std::max(radius, glm::length(vertex.position - center));
+  }
+  return glm::vec4(center, 0.0f, radius);
+}
+
+std::vector<u8> Model::Builder::packVertices() const {
+  u32 stride = this->layout.getStride();
+  std::vector<u8> packed(this->vertices.size() * stride);
+
+  u8* dst = packed.data();
+  for (const Vertex& vertex : this->vertices) {
+    this->layout.write(dst, vertex.position, vertex.color, vertex.normal,
+                       vertex.uv);
+    dst += stride;
+  }
+
+  return packed;
+}
+
+std::vector<vk::VertexInputBindingDescription>
+Model::InstanceData::getBindingDescriptions() {
   std::vector<vk::VertexInputBindingDescription> bindingDescriptions(1);
-  bindingDescriptions[0].binding = 0;
-  bindingDescriptions[0].stride = sizeof(Vertex);
-  bindingDescriptions[0].inputRate = vk::VertexInputRate::eVertex;
+  bindingDescriptions[0].binding = INSTANCE_BINDING;
+  bindingDescriptions[0].stride = sizeof(InstanceData);
+  bindingDescriptions[0].inputRate = vk::VertexInputRate::eInstance;
 
   return bindingDescriptions;
 }
 
 std::vector<vk::VertexInputAttributeDescription>
-Model::Vertex::getAttributeDescriptions() {
+Model::InstanceData::getAttributeDescriptions() {
   std::vector<vk::VertexInputAttributeDescription> attributeDescriptions{};
 
-  attributeDescriptions.push_back(
-      {0, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, position)});
-  attributeDescriptions.push_back(
-      {1, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, color)});
-  // attributeDescriptions.push_back(
-  //     {2, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, normal)});
-  // attributeDescriptions.push_back(
-  //     {3, 0, vk::Format::eR32G32Sfloat, offsetof(Vertex, uv)});
+  // A mat4 attribute takes one location per column
+  for (u32 column = 0; column < 4; column++) {
+    attributeDescriptions.push_back(
+        {FIRST_LOCATION + column, INSTANCE_BINDING,
+         vk::Format::eR32G32B32A32Sfloat,
+         static_cast<u32>(offsetof(InstanceData, transform) +
+                          column * sizeof(glm::vec4))});
+  }
+  attributeDescriptions.push_back({FIRST_LOCATION + 4, INSTANCE_BINDING,
+                                   vk::Format::eR32G32B32A32Sfloat,
+                                   offsetof(InstanceData, color)});
 
   return attributeDescriptions;
 }
 
 Model::Model(Device& device, const Builder& builder) : device{device} {
-  createVertexBuffers(builder.vertices);
-  createIndexBuffers(builder.indicies);
-}
+  assert(builder.vertices.size() >= 3 && "vertex count must be at least 3");
 
-Model::~Model() {}
+  std::vector<u8> vertices = builder.packVertices();
 
-void Model::bind(vk::CommandBuffer commandBuffer) {
-  vk::Buffer buffers[] = {this->vertexBuffer->getBuffer()};
-  vk::DeviceSize offset[] = {0};
-  commandBuffer.bindVertexBuffers(0, 1, buffers, offset);
+  PackedMesh packed{};
+  packed.layout = builder.layout;
+  packed.vertices = vertices.data();
+  packed.vertexCount = static_cast<u32>(builder.vertices.size());
+  packed.indices = builder.indicies.data();
+  packed.indexCount = static_cast<u32>(builder.indicies.size());
+  packed.indexType = builder.getIndexType();
+  packed.boundingSphere = builder.computeBoundingSphere();
+  packed.lods = builder.lods;
 
-  if (this->hasIndexBuffer) {
-    commandBuffer.bindIndexBuffer(this->indexBuffer->getBuffer(), 0,
-                                  vk::IndexType::eUint32);
+  std::vector<u16> indices16;
+  if (packed.indexType == vk::IndexType::eUint16) {
+    indices16.assign(builder.indicies.begin(), builder.indicies.end());
+    packed.indices = indices16.data();
   }
+
+  create(packed);
 }
 
-void Model::draw(vk::CommandBuffer commandBuffer) {
-  if (this->hasIndexBuffer) {
-    commandBuffer.drawIndexed(this->indexCount, 1, 0, 0, 0);
-  } else {
-    commandBuffer.draw(this->vertexCount, 1, 0, 0);
-  }
+Model::Model(Device& device, const PackedMesh& packed) : device{device} {
+  create(packed);
 }
 
-void Model::createVertexBuffers(const std::vector<Vertex>& vertices) {
-  this->vertexCount = static_cast<u32>(vertices.size());
-  assert(this->vertexCount >= 3 && "vertex count must be at least 3");
+void Model::create(const PackedMesh& packed) {
+  assert(packed.vertexCount >= 3 && "vertex count must be at least 3");
 
-  vk::DeviceSize bufferSize = sizeof(vertices[0]) * this->vertexCount;
+  this->layout = packed.layout;
+  this->boundingSphere = packed.boundingSphere;
+
+  this->lods = packed.lods;
+  if (this->lods.empty()) { this->lods.push_back({0, packed.indexCount, 0}); }
+  for (const Lod& lod : this->lods) {
+    assert(lod.firstIndex + lod.indexCount <= packed.indexCount &&
+           "LOD out of the model's indices");
+  }
 
-  u32 vertexSize = sizeof(vertices[0]);
+  GeometryArena& arena = this->device.getGeometryArena();
+  this->mesh = arena.allocate(this->layout.getStride(), packed.vertexCount,
+                              packed.indexCount, packed.indexType);
 
-  Buffer stagingBuffer{
-      this->device,
-      vertexSize,
-      vertexCount,
-      vk::BufferUsageFlagBits::eTransferSrc,
-      vk::MemoryPropertyFlagBits::eHostVisible |
-          vk::MemoryPropertyFlagBits::eHostCoherent,
-  };
+  // Both copies share one command buffer and one submission, the staging
+  // ring holds its own copy so the source can go once staged
+  UploadBatch batch{};
+  arena.upload(batch, this->mesh, packed.vertices, packed.indices);
+  this->uploadToken = this->device.getTransferContext().submit(batch);
+}
 
-  stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void*)vertices.data());
+Model::~Model() {
+  // The range can't be reused while a copy into it is still in flight
+  this->device.getTransferContext().wait(this->uploadToken);
+  this->device.getGeometryArena().free(this->mesh);
+}
 
-  vertexBuffer =
-      std::make_unique<Buffer>(this->device, vertexSize, vertexCount,
-                               vk::BufferUsageFlagBits::eTransferDst |
-                                   vk::BufferUsageFlagBits::eVertexBuffer,
-                               vk::MemoryPropertyFlagBits::eDeviceLocal);
+void Model::bind(vk::CommandBuffer commandBuffer) {
+  this->device.getGeometryArena().bind(commandBuffer, this->mesh.indexType);
+}
 
-  this->device.copyBuffer(stagingBuffer.getBuffer(),
-                          this->vertexBuffer->getBuffer(), bufferSize);
+void Model::draw(vk::CommandBuffer commandBuffer) {
+  drawInstanced(commandBuffer, 1);
 }
 
-void Model::createIndexBuffers(const std::vector<u32>& indicies) {
-  this->indexCount = static_cast<u32>(indicies.size());
-  this->hasIndexBuffer = this->indexCount > 0;
+void Model::bindInstances(vk::CommandBuffer commandBuffer,
+                          vk::Buffer buffer,
+                          vk::DeviceSize offset) {
+  commandBuffer.bindVertexBuffers(INSTANCE_BINDING, buffer, offset);
+}
 
-  if (!this->hasIndexBuffer) { return; }
+void Model::drawInstanced(vk::CommandBuffer commandBuffer,
+                          u32 instanceCount,
+                          u32 firstInstance) {
+  drawLod(commandBuffer, 0, instanceCount, firstInstance);
+}
 
-  vk::DeviceSize bufferSize = sizeof(indicies[0]) * this->indexCount;
+void Model::drawLod(vk::CommandBuffer commandBuffer,
+                    u32 lod,
+                    u32 instanceCount,
+                    u32 firstInstance) {
+  assert(lod < this->lods.size() && "LOD out of range");
 
-  u32 indexSize = sizeof(indicies[0]);
+  if (this->mesh.indexCount > 0) {
+    const Lod& range = this->lods[lod];
+    commandBuffer.drawIndexed(range.indexCount, instanceCount,
+                              this->mesh.firstIndex + range.firstIndex,
+                              static_cast<s32>(this->mesh.firstVertex),
+                              firstInstance);
+  } else {
+    commandBuffer.draw(this->mesh.vertexCount, instanceCount,
+                       this->mesh.firstVertex, firstInstance);
+  }
+}
 
-  Buffer stagingBuffer{
-      this->device,
-      indexSize,
-      indexCount,
-      vk::BufferUsageFlagBits::eTransferSrc,
-      vk::MemoryPropertyFlagBits::eHostVisible |
-          vk::MemoryPropertyFlagBits::eHostCoherent,
-  };
+f32 Model::getProjectedRadius(const glm::mat4& transform,
+                              f32 viewportHeight) const {
+  glm::vec4 center = transform * glm::vec4(glm::vec3(this->boundingSphere),
+                                           1.0f);
 
-  stagingBuffer.map();
-  stagingBuffer.writeToBuffer((void*)indicies.data());
+  // Vertices only span x and y, the largest of those axes bounds the scale
+  f32 scale = std::max(glm::length(glm::vec3(transform[0])),
+                       glm::length(glm::vec3(transform[1])));
+  f32 w = std::max(std::abs(center.w), 1e-6f);
 
-  indexBuffer =
-      std::make_unique<Buffer>(this->device, indexSize, indexCount,
-                               vk::BufferUsageFlagBits::eTransferDst |
-                                   vk::BufferUsageFlagBits::eIndexBuffer,
-                               vk::MemoryPropertyFlagBits::eDeviceLocal);
+  // NDC spans 2 units over the viewport
+  return this->boundingSphere.w * scale / w * viewportHeight * 0.5f;
+}
 
-  this->device.copyBuffer(stagingBuffer.getBuffer(),
-                          this->indexBuffer->getBuffer(), bufferSize);
+u32 Model::selectLod(f32 radiusPixels,
+                     u32 previousLod,
+                     f32 maxPixelError) const {
+  u32 selected = 0;
+  for (u32 lod = 1; lod < this->lods.size(); lod++) {
+    f32 budget = lod > previousLod ? maxPixelError * (1.0f - LOD_HYSTERESIS)
+                                   : maxPixelError;
+    // Errors never decrease with the level
+    if (this->lods[lod].error * radiusPixels > budget) { break; }
+    selected = lod;
+  }
+  return selected;
 }
 
 }  // namespace hep
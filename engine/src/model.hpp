@@ -3,8 +3,11 @@
 #include <memory>
 #include <vector>
 
-#include "buffer.hpp"
 #include "device.hpp"
+#include "geometry_arena.hpp"
+#include "transfer_context.hpp"
+#include "util/hash.hpp"
+#include "vertex_layout.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -14,57 +17,236 @@ namespace hep {
 
 class Model {
  public:
+  static constexpr u32 VERTEX_BINDING = 0;
+  static constexpr u32 INSTANCE_BINDING = 1;
+
+  /**
+   * Full precision vertex as seen by the host, Builder::layout decides how
+   * it is encoded on the GPU
+   */
   struct Vertex {
     glm::vec2 position{};
     glm::vec3 color{};
-    // glm::vec3 normal{};
-    // glm::vec2 uv{};
+    glm::vec3 normal{};
+    glm::vec2 uv{};
+
+    /** Descriptions of VertexLayout::standard() */
+    static std::vector<vk::VertexInputBindingDescription>
+    getBindingDescriptions();
+    static std::vector<vk::VertexInputAttributeDescription>
+    getAttributeDescriptions();
+
+    bool operator==(const Vertex& other) const {
+      return this->position == other.position && this->color == other.color &&
+             this->normal == other.normal && this->uv == other.uv;
+    }
+
+    /** Hashes the raw floats, for deduplication in hash maps */
+    struct Hasher {
+      size_t operator()(const Vertex& vertex) const {
+        return static_cast<size_t>(fnv1a(&vertex, sizeof(Vertex)));
+      }
+    };
+  };
+
+  /**
+   * Per instance attributes read from INSTANCE_BINDING, starting at
+   * location 4 right after the VertexLayout attributes.
+   * Pipelines opt in by combining both sets of descriptions through
+   * Pipeline::setVertexInput.
+   */
+  struct InstanceData {
+    glm::mat4 transform{1.0f};
+    glm::vec4 color{1.0f};
+
+    static constexpr u32 FIRST_LOCATION = 4;
 
     static std::vector<vk::VertexInputBindingDescription>
     getBindingDescriptions();
     static std::vector<vk::VertexInputAttributeDescription>
     getAttributeDescriptions();
+  };
 
-    // bool operator==(const Vertex& other) const {
-    //   return position == other.position && color == other.color &&
-    //          normal == other.normal && uv == other.uv;
-    // }
+  static constexpr u32 MAX_LODS = 8;
+  // A coarser LOD is only picked once its error is this far under budget,
+  // so instances near a threshold don't flicker between levels
+  static constexpr f32 LOD_HYSTERESIS = 0.25f;
+
+  /** Range of the model's indices drawing one level of detail */
+  struct Lod {
+    u32 firstIndex = 0;
+    u32 indexCount = 0;
+    // Simplification error relative to the bounding sphere radius
+    f32 error = 0.0f;
   };
 
   /**
    * Helper struct
    *
-   * Temporarily stores vertices and indicies of a model before it
-   * can be moved into the model's vertex buffer and index buffer respectively
+   * Temporarily stores vertices and indicies of a model before they
+   * are uploaded into the model's range of the GeometryArena
    *
    * TODO: move this documentation elsewhere (doc/ ?)
    */
   struct Builder {
     std::vector<Vertex> vertices{};
     std::vector<u32> indicies{};
+
+    /**
+     * Ranges of indicies, finest first. Empty means a single LOD made of
+     * every index.
+     */
+    std::vector<Lod> lods{};
+
+    /**
+     * Pipelines drawing the model need the same layout, see
+     * Pipeline::setVertexInput
+     */
+    VertexLayout layout = VertexLayout::standard();
+
+    /**
+     * Uploads indices as u16 when every vertex fits, see getIndexType.
+     *
+     * @note must be off for models drawn through IndirectRenderSystem,
+     * which shares one 32 bit index binding between all draws and rejects
+     * u16 meshes in addDraw
+     */
+    bool allowIndex16 = true;
+
+    struct OptimizationStats {
+      f32 acmrBefore = 0.0f;
+      f32 acmrAfter = 0.0f;
+      // Unreferenced vertices dropped and 16 bit indices, in GPU bytes
+      u64 bytesSaved = 0;
+    };
+
+    /**
+     * Reorders triangles for the post-transform vertex cache, then for
+     * overdraw, then vertices for fetch locality, see mesh_optimizer.hpp.
+     * Meant for build time, it is linear but not free on large meshes.
+     * Logs the statistics it returns.
+     *
+     * @note run before generateLods, it reorders vertices
+     */
+    OptimizationStats optimize();
+
+    /**
+     * Appends up to lodCount - 1 simplified copies of indicies to it, each
+     * with reduction times the triangles of the previous one, and fills
+     * lods. Every LOD shares the vertices. Stops early once a level would
+     * exceed maxError, relative to the bounding sphere radius.
+     *
+     * @return number of LODs, including the original
+     */
+    u32 generateLods(u32 lodCount = 4,
+                     f32 reduction = 0.5f,
+                     f32 maxError = 0.05f);
+
+    vk::IndexType getIndexType() const;
+
+    /** Model space center in xyz and radius in w */
+    glm::vec4 computeBoundingSphere() const;
+
+    /** Converts vertices into layout, getStride() bytes per vertex */
+    std::vector<u8> packVertices() const;
+  };
+
+  /**
+   * Geometry already in its GPU encoding, such as a mapped mesh cache file.
+   * The pointers only need to stay valid during the constructor, the
+   * payloads are copied straight into the staging ring.
+   */
+  struct PackedMesh {
+    VertexLayout layout{};
+    const void* vertices = nullptr;
+    u32 vertexCount = 0;
+    // indexCount elements of indexType
+    const void* indices = nullptr;
+    u32 indexCount = 0;
+    vk::IndexType indexType = vk::IndexType::eUint32;
+    glm::vec4 boundingSphere{0.0f};
+    // Empty for a single LOD, see Builder::lods
+    std::vector<Lod> lods{};
   };
 
   Model(const Model&) = delete;
   Model& operator=(const Model&) = delete;
 
+  /**
+   * Geometry is sub-allocated from the Device's GeometryArena. Uploads are
+   * recorded on the transfer queue and not waited on, the GPU orders them
+   * before any draw submitted afterwards
+   */
   Model(Device& device, const Builder& builder);
+  Model(Device& device, const PackedMesh& packed);
   ~Model();
 
+  /**
+   * Binds the shared arena buffers, models with the same index type drawn
+   * back to back only need this once
+   */
   void bind(vk::CommandBuffer commandBuffer);
   void draw(vk::CommandBuffer commandBuffer);
 
+  /**
+   * Binds offset into buffer as the InstanceData stream, typically an
+   * allocation from the FrameAllocator
+   */
+  void bindInstances(vk::CommandBuffer commandBuffer,
+                     vk::Buffer buffer,
+                     vk::DeviceSize offset = 0);
+
+  /** Draws instanceCount copies in one call, see bindInstances */
+  void drawInstanced(vk::CommandBuffer commandBuffer,
+                     u32 instanceCount,
+                     u32 firstInstance = 0);
+
+  void drawLod(vk::CommandBuffer commandBuffer,
+               u32 lod,
+               u32 instanceCount = 1,
+               u32 firstInstance = 0);
+
+  u32 getLodCount() const { return static_cast<u32>(this->lods.size()); }
+  const Lod& getLod(u32 lod) const { return this->lods[lod]; }
+
+  /**
+   * Radius of the bounding sphere on screen once transformed, in pixels
+   * of a viewport viewportHeight pixels tall
+   */
+  f32 getProjectedRadius(const glm::mat4& transform,
+                         f32 viewportHeight) const;
+
+  /**
+   * Coarsest LOD whose error stays under maxPixelError pixels at
+   * radiusPixels, see getProjectedRadius. Switching to a coarser level
+   * than previousLod needs LOD_HYSTERESIS of margin.
+   */
+  u32 selectLod(f32 radiusPixels,
+                u32 previousLod,
+                f32 maxPixelError = 1.0f) const;
+
+  const MeshRange& getMeshRange() const { return this->mesh; }
+  const VertexLayout& getVertexLayout() const { return this->layout; }
+
+  /** Model space center in xyz and radius in w, used for culling */
+  glm::vec4 getBoundingSphere() const { return this->boundingSphere; }
+
+  UploadToken getUploadToken() const { return this->uploadToken; }
+  bool isUploaded() {
+    return this->device.getTransferContext().isComplete(this->uploadToken);
+  }
+
  private:
-  void createVertexBuffers(const std::vector<Vertex>& vertices);
-  void createIndexBuffers(const std::vector<u32>& indicies);
+  void create(const PackedMesh& packed);
 
   Device& device;
 
-  std::unique_ptr<Buffer> vertexBuffer;
-  u32 vertexCount;
+  MeshRange mesh{};
+  VertexLayout layout{};
+  glm::vec4 boundingSphere{0.0f};
+  std::vector<Lod> lods{};
 
-  bool hasIndexBuffer = false;
-  std::unique_ptr<Buffer> indexBuffer;
-  u32 indexCount;
+  UploadToken uploadToken = 0;
 };
 
 }  // namespace hep
@@ -1,7 +1,5 @@
 #include "pipeline.hpp"
 
-#include <fstream>
-
 #include "model.hpp"
 #include "util/logger.hpp"
 
@@ -27,6 +25,38 @@ void Pipeline::create(const std::string& vertexShaderFilename,
         "failed to create graphics pipeline: no vk::RenderPass provided");
   }
 
+  createGraphicsPipeline(vertexShaderFilename, fragmentShaderFilename,
+                         pipelineLayout, renderPass, nullptr);
+}
+
+void Pipeline::create(const std::string& vertexShaderFilename,
+                      const std::string& fragmentShaderFilename,
+                      vk::PipelineLayout pipelineLayout,
+                      vk::Format colorFormat,
+                      vk::Format depthFormat) {
+  if (!this->device.isDynamicRenderingEnabled()) {
+    log::fatal("failed to create graphics pipeline: dynamic rendering is "
+               "not enabled");
+    throw std::runtime_error(
+        "failed to create graphics pipeline: dynamic rendering is not "
+        "enabled");
+  }
+
+  vk::PipelineRenderingCreateInfo renderingInfo{};
+  renderingInfo.colorAttachmentCount = 1;
+  renderingInfo.pColorAttachmentFormats = &colorFormat;
+  renderingInfo.depthAttachmentFormat = depthFormat;
+
+  createGraphicsPipeline(vertexShaderFilename, fragmentShaderFilename,
+                         pipelineLayout, VK_NULL_HANDLE, &renderingInfo);
+}
+
+void Pipeline::createGraphicsPipeline(
+    const std::string& vertexShaderFilename,
+    const std::string& fragmentShaderFilename,
+    vk::PipelineLayout pipelineLayout,
+    vk::RenderPass renderPass,
+    const vk::PipelineRenderingCreateInfo* renderingInfo) {
   if (pipelineLayout == VK_NULL_HANDLE) {
     log::fatal(
         "failed to create graphics pipeline: no vk::PipelineLayout provided");
@@ -40,11 +70,11 @@ void Pipeline::create(const std::string& vertexShaderFilename,
   }
 
   vk::UniqueShaderModule vertexShaderModule =
-      createShaderModule(vertexShaderFilename);
+      this->device.createShaderModule(vertexShaderFilename);
   log::trace("created vertex shader module");
 
   vk::UniqueShaderModule fragmentShaderModule =
-      createShaderModule(fragmentShaderFilename);
+      this->device.createShaderModule(fragmentShaderFilename);
   log::trace("created fragment shader module");
 
   vk::PipelineShaderStageCreateInfo shaderStages[] = {
@@ -53,8 +83,8 @@ void Pipeline::create(const std::string& vertexShaderFilename,
       {vk::PipelineShaderStageCreateFlags(), vk::ShaderStageFlagBits::eFragment,
        fragmentShaderModule.get(), "main"}};
 
-  auto bindingDescriptions = Model::Vertex::getBindingDescriptions();
-  auto attributeDescriptions = Model::Vertex::getAttributeDescriptions();
+  const auto& bindingDescriptions = this->config.bindingDescriptions;
+  const auto& attributeDescriptions = this->config.attributeDescriptions;
 
   vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {};
   vertexInputInfo.vertexBindingDescriptionCount =
@@ -84,13 +114,17 @@ void Pipeline::create(const std::string& vertexShaderFilename,
 
   pipelineInfo.layout = pipelineLayout;
   pipelineInfo.renderPass = renderPass;
+  pipelineInfo.pNext = renderingInfo;
 
   pipelineInfo.subpass = 0;
   pipelineInfo.basePipelineHandle = nullptr;
 
   try {
     this->graphicsPipeline =
-        this->device.get()->createGraphicsPipeline(nullptr, pipelineInfo).value;
+        this->device.get()
+            ->createGraphicsPipeline(this->device.getPipelineCache(),
+                                     pipelineInfo)
+            .value;
     log::trace("created vk::Pipeline");
   } catch (const vk::SystemError& err) {
     log::fatal("failed to create vk::Pipeline");
@@ -98,12 +132,23 @@ void Pipeline::create(const std::string& vertexShaderFilename,
   }
 }
 
+void Pipeline::setVertexInput(
+    std::vector<vk::VertexInputBindingDescription> bindingDescriptions,
+    std::vector<vk::VertexInputAttributeDescription> attributeDescriptions) {
+  this->config.bindingDescriptions = std::move(bindingDescriptions);
+  this->config.attributeDescriptions = std::move(attributeDescriptions);
+}
+
 void Pipeline::bind(vk::CommandBuffer commandBuffer) {
   commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
                              this->graphicsPipeline);
 }
 
 void Pipeline::setDefaultPipelineConfig() {
+  this->config.bindingDescriptions = Model::Vertex::getBindingDescriptions();
+  this->config.attributeDescriptions =
+      Model::Vertex::getAttributeDescriptions();
+
   this->config.inputAssemblyInfo.topology =
       vk::PrimitiveTopology::eTriangleList;
   this->config.inputAssemblyInfo.primitiveRestartEnable = vk::False;
@@ -165,31 +210,4 @@ void Pipeline::setDefaultPipelineConfig() {
       static_cast<u32>(this->config.dynamicStateEnables.size());
 }
 
-vk::UniqueShaderModule Pipeline::createShaderModule(
-    const std::string& shaderFilename) {
-  std::ifstream file(shaderFilename, std::ios::ate | std::ios::binary);
-
-  if (!file.is_open()) {
-    log::error("failed to open: " + shaderFilename);
-    throw std::runtime_error("failed to open: " + shaderFilename);
-  }
-
-  size_t fileSize = (size_t)file.tellg();
-
-  std::vector<char> buffer(fileSize);
-
-  file.seekg(0);
-  file.read(buffer.data(), fileSize);
-  file.close();
-
-  try {
-    return device.get()->createShaderModuleUnique(
-        {vk::ShaderModuleCreateFlags(), buffer.size(),
-         reinterpret_cast<const u32*>(buffer.data())});
-  } catch (const vk::SystemError& err) {
-    log::fatal("failed to create shader module");
-    throw std::runtime_error("failed to create shader module");
-  }
-}
-
 }  // namespace hep
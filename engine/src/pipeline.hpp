@@ -43,11 +43,33 @@ class Pipeline {
               vk::PipelineLayout pipelineLayout,
               vk::RenderPass renderPass);
 
+  /**
+   * Creates the pipeline for dynamic rendering into attachments of the
+   * given formats, depthFormat may be eUndefined
+   */
+  void create(const std::string& vertexShaderFilename,
+              const std::string& fragmentShaderFilename,
+              vk::PipelineLayout pipelineLayout,
+              vk::Format colorFormat,
+              vk::Format depthFormat);
+
+  /**
+   * Replaces the default Model::Vertex input, must be called before create
+   */
+  void setVertexInput(
+      std::vector<vk::VertexInputBindingDescription> bindingDescriptions,
+      std::vector<vk::VertexInputAttributeDescription> attributeDescriptions);
+
   void bind(vk::CommandBuffer commandBuffer);
 
  private:
+  void createGraphicsPipeline(
+      const std::string& vertexShaderFilename,
+      const std::string& fragmentShaderFilename,
+      vk::PipelineLayout pipelineLayout,
+      vk::RenderPass renderPass,
+      const vk::PipelineRenderingCreateInfo* renderingInfo);
   void setDefaultPipelineConfig();
-  vk::UniqueShaderModule createShaderModule(const std::string& shaderFilename);
 
   Device& device;
   PipelineConfig config;
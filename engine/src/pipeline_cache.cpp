@@ -0,0 +1,120 @@
+#include "pipeline_cache.hpp"
+
+#include <cstring>
+
+#include "util/file_io.hpp"
+#include "util/hash.hpp"
+#include "util/logger.hpp"
+
+namespace hep {
+
+PipelineCache::PipelineCache(vk::Device device,
+                             const vk::PhysicalDeviceProperties& properties,
+                             std::filesystem::path path)
+    : device{device}, properties{properties}, path{std::move(path)} {
+  std::vector<u8> initialData;
+  if (!loadInitialData(initialData)) { initialData.clear(); }
+
+  vk::PipelineCacheCreateInfo createInfo{};
+  createInfo.initialDataSize = initialData.size();
+  createInfo.pInitialData = initialData.data();
+
+  try {
+    this->cache = this->device.createPipelineCache(createInfo);
+  } catch (const vk::SystemError& error) {
+    if (initialData.empty()) {
+      log::fatal("failed to create vk::PipelineCache");
+      throw std::runtime_error("failed to create vk::PipelineCache");
+    }
+
+    // Some drivers reject data they don't like instead of ignoring it
+    log::warning("vk::PipelineCache rejected cached data, starting empty");
+    createInfo.initialDataSize = 0;
+    createInfo.pInitialData = nullptr;
+    this->cache = this->device.createPipelineCache(createInfo);
+  }
+
+  log::trace("created vk::PipelineCache (" +
+             std::to_string(initialData.size()) + " bytes loaded)");
+}
+
+PipelineCache::~PipelineCache() {
+  this->device.destroyPipelineCache(this->cache);
+  log::trace("destroyed vk::PipelineCache");
+}
+
+void PipelineCache::save() {
+  std::vector<u8> data;
+  try {
+    data = this->device.getPipelineCacheData(this->cache);
+  } catch (const vk::SystemError& error) {
+    log::error("failed to read vk::PipelineCache data. Error: ", error.what());
+    return;
+  }
+
+  FileHeader header{};
+  header.magic = FILE_MAGIC;
+  header.version = FILE_VERSION;
+  header.vendorID = this->properties.vendorID;
+  header.deviceID = this->properties.deviceID;
+  header.driverVersion = this->properties.driverVersion;
+  header.apiVersion = this->properties.apiVersion;
+  std::memcpy(header.pipelineCacheUUID, this->properties.pipelineCacheUUID,
+              VK_UUID_SIZE);
+  header.dataSize = data.size();
+  header.checksum = fnv1a(data.data(), data.size());
+
+  std::vector<u8> file(sizeof(FileHeader) + data.size());
+  std::memcpy(file.data(), &header, sizeof(FileHeader));
+  std::memcpy(file.data() + sizeof(FileHeader), data.data(), data.size());
+
+  if (writeBinaryFileAtomic(this->path, file.data(), file.size())) {
+    log::trace("saved vk::PipelineCache to " + this->path.string() + " (" +
+               std::to_string(data.size()) + " bytes)");
+  }
+}
+
+bool PipelineCache::loadInitialData(std::vector<u8>& data) {
+  std::vector<u8> file;
+  if (!readBinaryFile(this->path, file)) { return false; }
+
+  if (file.size() < sizeof(FileHeader)) {
+    log::warning("pipeline cache file truncated, ignoring");
+    return false;
+  }
+
+  FileHeader header{};
+  std::memcpy(&header, file.data(), sizeof(FileHeader));
+
+  if (header.magic != FILE_MAGIC || header.version != FILE_VERSION) {
+    log::warning("pipeline cache file has unknown format, ignoring");
+    return false;
+  }
+
+  if (header.vendorID != this->properties.vendorID ||
+      header.deviceID != this->properties.deviceID ||
+      header.driverVersion != this->properties.driverVersion ||
+      header.apiVersion != this->properties.apiVersion ||
+      std::memcmp(header.pipelineCacheUUID,
+                  this->properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+    log::info("pipeline cache was created by another device or driver, "
+              "ignoring");
+    return false;
+  }
+
+  if (header.dataSize != file.size() - sizeof(FileHeader)) {
+    log::warning("pipeline cache file size mismatch, ignoring");
+    return false;
+  }
+
+  const u8* payload = file.data() + sizeof(FileHeader);
+  if (fnv1a(payload, header.dataSize) != header.checksum) {
+    log::warning("pipeline cache checksum mismatch, ignoring");
+    return false;
+  }
+
+  data.assign(payload, payload + header.dataSize);
+  return true;
+}
+
+}  // namespace hep
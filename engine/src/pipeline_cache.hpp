@@ -0,0 +1,63 @@
+#pragma once
+
+#include <filesystem>
+#include <vulkan/vulkan.hpp>
+
+#include "types.hpp"
+
+namespace hep {
+
+/**
+ * Engine wide vk::PipelineCache persisted between runs
+ *
+ * The driver blob is wrapped in our own header recording the device and
+ * driver it came from plus a checksum. Files written by another GPU or
+ * driver, truncated or otherwise corrupted files are ignored and the cache
+ * starts out empty.
+ */
+class PipelineCache {
+ public:
+  static constexpr const char* DEFAULT_PATH = "cache/pipeline_cache.bin";
+
+  PipelineCache(const PipelineCache&) = delete;
+  PipelineCache& operator=(const PipelineCache&) = delete;
+
+  PipelineCache(vk::Device device,
+                const vk::PhysicalDeviceProperties& properties,
+                std::filesystem::path path = DEFAULT_PATH);
+  ~PipelineCache();
+
+  vk::PipelineCache get() const { return this->cache; }
+
+  /**
+   * Writes the current cache contents to disk, replacing the old file
+   * atomically
+   */
+  void save();
+
+ private:
+  static constexpr u32 FILE_MAGIC = 0x43505048;  // "HPPC"
+  static constexpr u32 FILE_VERSION = 1;
+
+  struct FileHeader {
+    u32 magic;
+    u32 version;
+    u32 vendorID;
+    u32 deviceID;
+    u32 driverVersion;
+    u32 apiVersion;
+    u8 pipelineCacheUUID[VK_UUID_SIZE];
+    u64 dataSize;
+    u64 checksum;
+  };
+
+  bool loadInitialData(std::vector<u8>& data);
+
+  vk::Device device;
+  vk::PhysicalDeviceProperties properties;
+  std::filesystem::path path;
+
+  vk::PipelineCache cache;
+};
+
+}  // namespace hep
@@ -1,16 +1,45 @@
 #include "renderer.hpp"
 
+#include "deletion_queue.hpp"
+#include "transfer_context.hpp"
+#include "util/image_barrier.hpp"
 #include "util/logger.hpp"
 
 namespace hep {
 
-Renderer::Renderer(Window& window, Device& device)
+Renderer::Renderer(Window& window,
+                   Device& device,
+                   vk::DeviceSize frameAllocatorSize)
     : window{window}, device{device} {
   recreateSwapchain();
   createCommandBuffers();
+
+  this->profiler = std::make_unique<GpuProfiler>(this->device);
+
+  this->descriptorAllocator =
+      DescriptorAllocator::Builder(this->device)
+          .setFrameCount(Swapchain::MAX_FRAMES_IN_FLIGHT)
+          .addPoolRatio(vk::DescriptorType::eUniformBuffer, 2.0f)
+          .addPoolRatio(vk::DescriptorType::eStorageBuffer, 2.0f)
+          .addPoolRatio(vk::DescriptorType::eCombinedImageSampler, 4.0f)
+          .addPoolRatio(vk::DescriptorType::eStorageImage, 1.0f)
+          .build();
+  this->descriptorSetCache = std::make_unique<DescriptorSetCache>(this->device);
+  this->frameAllocator = std::make_unique<FrameAllocator>(
+      this->device, Swapchain::MAX_FRAMES_IN_FLIGHT, frameAllocatorSize);
+
+  if (this->device.isBindlessEnabled()) {
+    this->bindlessTable = std::make_unique<BindlessTable>(this->device);
+  }
+
+  this->recordingThreads = std::make_unique<ThreadPool>();
+  createThreadCommandPools();
 }
 
-Renderer::~Renderer() { freeCommandBuffers(); }
+Renderer::~Renderer() {
+  freeCommandBuffers();
+  destroyThreadCommandPools();
+}
 
 vk::CommandBuffer Renderer::beginFrame() {
   assert(!this->isFrameStarted &&
@@ -28,6 +57,14 @@ vk::CommandBuffer Renderer::beginFrame() {
 
   this->isFrameStarted = true;
 
+  this->device.getTransferContext().collect();
+  this->device.getDeletionQueue().beginFrame();
+
+  // The fence for this frame has been waited on in acquireNextImage
+  resetThreadCommandPools();
+  this->descriptorAllocator->beginFrame(this->currentFrameIndex);
+  this->frameAllocator->beginFrame(this->currentFrameIndex);
+
   vk::CommandBuffer commandBuffer = getCurrentCommandBuffer();
 
   vk::CommandBufferBeginInfo beginInfo = {};
@@ -40,6 +77,8 @@ vk::CommandBuffer Renderer::beginFrame() {
     throw std::runtime_error("failed to begin recording command buffer");
   }
 
+  this->profiler->beginFrame(commandBuffer, this->currentFrameIndex);
+
   return commandBuffer;
 }
 
@@ -75,12 +114,18 @@ void Renderer::endFrame() {
   currentFrameIndex = (currentFrameIndex + 1) % Swapchain::MAX_FRAMES_IN_FLIGHT;
 }
 
-void Renderer::beginSwapChainRenderPass(vk::CommandBuffer commandBuffer) {
+void Renderer::beginSwapChainRenderPass(vk::CommandBuffer commandBuffer,
+                                        vk::SubpassContents contents) {
   assert(isFrameStarted &&
          "Can't call beginSwapChainRenderPass if frame is not in progress");
   assert(commandBuffer == getCurrentCommandBuffer() &&
          "Can't begin render pass on command buffer from a different frame");
 
+  if (this->device.isDynamicRenderingEnabled()) {
+    beginSwapChainRendering(commandBuffer, contents);
+    return;
+  }
+
   vk::RenderPassBeginInfo renderPassInfo = {};
   renderPassInfo.renderPass = this->swapchain->getRenderPass();
   renderPassInfo.framebuffer =
@@ -94,18 +139,13 @@ void Renderer::beginSwapChainRenderPass(vk::CommandBuffer commandBuffer) {
   renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
   renderPassInfo.pClearValues = clearValues.data();
 
-  commandBuffer.beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
-
-  vk::Viewport viewport{0.0f,
-                        0.0f,
-                        static_cast<float>(this->swapchain->width()),
-                        static_cast<float>(this->swapchain->height()),
-                        0.0f,
-                        1.0f};
-  vk::Rect2D scissor{{0, 0}, this->swapchain->getExtent()};
+  commandBuffer.beginRenderPass(&renderPassInfo, contents);
 
-  commandBuffer.setViewport(0, 1, &viewport);
-  commandBuffer.setScissor(0, 1, &scissor);
+  // Only vkCmdExecuteCommands is allowed in a pass begun with secondary
+  // contents
+  if (contents == vk::SubpassContents::eInline) {
+    setViewportAndScissor(commandBuffer);
+  }
 }
 
 void Renderer::endSwapChainRenderPass(vk::CommandBuffer commandBuffer) {
@@ -113,10 +153,175 @@ void Renderer::endSwapChainRenderPass(vk::CommandBuffer commandBuffer) {
          "Can't call endSwapChainRenderPass if frame is not in progress");
   assert(commandBuffer == getCurrentCommandBuffer() &&
          "Can't end render pass on command buffer from a different frame");
+
+  if (this->device.isDynamicRenderingEnabled()) {
+    endSwapChainRendering(commandBuffer);
+    return;
+  }
+
   commandBuffer.endRenderPass();
 }
 
+void Renderer::beginSwapChainRendering(vk::CommandBuffer commandBuffer,
+                                       vk::SubpassContents contents) {
+  vk::Image image = this->swapchain->getImage(this->currentImageIndex);
+  vk::Image depthImage =
+      this->swapchain->getDepthImage(this->currentImageIndex);
+
+  // Acquire waits at color attachment output, start the transition there
+  transitionImageLayout(commandBuffer, image, vk::ImageAspectFlagBits::eColor,
+                        vk::ImageLayout::eUndefined,
+                        vk::ImageLayout::eColorAttachmentOptimal,
+                        vk::PipelineStageFlagBits::eColorAttachmentOutput, {},
+                        vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                        vk::AccessFlagBits::eColorAttachmentWrite);
+  transitionImageLayout(
+      commandBuffer, depthImage,
+      getDepthAspectMask(this->swapchain->getDepthFormat()),
+      vk::ImageLayout::eUndefined,
+      vk::ImageLayout::eDepthStencilAttachmentOptimal,
+      vk::PipelineStageFlagBits::eLateFragmentTests,
+      vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+      vk::PipelineStageFlagBits::eEarlyFragmentTests,
+      vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+
+  vk::RenderingAttachmentInfo colorAttachment{};
+  colorAttachment.imageView =
+      this->swapchain->getImageView(this->currentImageIndex);
+  colorAttachment.imageLayout = vk::ImageLayout::eColorAttachmentOptimal;
+  colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+  colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+  colorAttachment.clearValue.color = {0.01f, 0.01f, 0.01f, 1.0f};
+
+  vk::RenderingAttachmentInfo depthAttachment{};
+  depthAttachment.imageView =
+      this->swapchain->getDepthImageView(this->currentImageIndex);
+  depthAttachment.imageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+  depthAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+  depthAttachment.storeOp = vk::AttachmentStoreOp::eDontCare;
+  depthAttachment.clearValue.depthStencil = vk::ClearDepthStencilValue{1.0f, 0};
+
+  vk::RenderingInfo renderingInfo{};
+  renderingInfo.renderArea.offset = vk::Offset2D{0, 0};
+  renderingInfo.renderArea.extent = this->swapchain->getExtent();
+  renderingInfo.layerCount = 1;
+  renderingInfo.colorAttachmentCount = 1;
+  renderingInfo.pColorAttachments = &colorAttachment;
+  renderingInfo.pDepthAttachment = &depthAttachment;
+
+  if (contents == vk::SubpassContents::eSecondaryCommandBuffers) {
+    renderingInfo.flags =
+        vk::RenderingFlagBits::eContentsSecondaryCommandBuffers;
+  }
+
+  commandBuffer.beginRendering(renderingInfo);
+
+  if (contents == vk::SubpassContents::eInline) {
+    setViewportAndScissor(commandBuffer);
+  }
+}
+
+void Renderer::endSwapChainRendering(vk::CommandBuffer commandBuffer) {
+  commandBuffer.endRendering();
+
+  transitionImageLayout(
+      commandBuffer, this->swapchain->getImage(this->currentImageIndex),
+      vk::ImageAspectFlagBits::eColor, vk::ImageLayout::eColorAttachmentOptimal,
+      this->swapchain->getFinalLayout(),
+      vk::PipelineStageFlagBits::eColorAttachmentOutput,
+      vk::AccessFlagBits::eColorAttachmentWrite,
+      vk::PipelineStageFlagBits::eBottomOfPipe, {});
+}
+
+std::vector<vk::CommandBuffer> Renderer::recordSecondaryCommandBuffers(
+    u32 chunkCount,
+    const SecondaryRecordFunction& record) {
+  assert(isFrameStarted &&
+         "Can't record secondary command buffers if frame is not in progress");
+
+  std::vector<vk::CommandBuffer> secondaryCommandBuffers(chunkCount);
+
+  vk::CommandBufferInheritanceInfo inheritanceInfo{};
+  vk::CommandBufferInheritanceRenderingInfo inheritanceRenderingInfo{};
+  vk::Format colorFormat = this->swapchain->getImageFormat();
+
+  if (this->device.isDynamicRenderingEnabled()) {
+    inheritanceRenderingInfo.colorAttachmentCount = 1;
+    inheritanceRenderingInfo.pColorAttachmentFormats = &colorFormat;
+    inheritanceRenderingInfo.depthAttachmentFormat =
+        this->swapchain->getDepthFormat();
+    inheritanceRenderingInfo.rasterizationSamples =
+        vk::SampleCountFlagBits::e1;
+    inheritanceInfo.pNext = &inheritanceRenderingInfo;
+  } else {
+    inheritanceInfo.renderPass = this->swapchain->getRenderPass();
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer =
+        this->swapchain->getFrameBuffer(this->currentImageIndex);
+  }
+
+  auto& framePools = this->threadCommandPools[this->currentFrameIndex];
+
+  for (u32 chunk = 0; chunk < chunkCount; chunk++) {
+    this->recordingThreads->enqueue([&, chunk](u32 threadIndex) {
+      // Only ever touched by this worker, no locking needed
+      ThreadCommandPool& pool = framePools[threadIndex];
+      vk::CommandBuffer commandBuffer = acquireSecondaryCommandBuffer(pool);
+
+      vk::CommandBufferBeginInfo beginInfo{};
+      beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit |
+                        vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+      beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+      commandBuffer.begin(beginInfo);
+      setViewportAndScissor(commandBuffer);
+      record(commandBuffer, chunk);
+      commandBuffer.end();
+
+      secondaryCommandBuffers[chunk] = commandBuffer;
+    });
+  }
+
+  try {
+    this->recordingThreads->wait();
+  } catch (const vk::SystemError& error) {
+    log::fatal("failed to record secondary command buffers. Error: ",
+               error.what());
+    throw std::runtime_error("failed to record secondary command buffers");
+  }
+
+  return secondaryCommandBuffers;
+}
+
+void Renderer::executeSecondaryCommandBuffers(
+    vk::CommandBuffer commandBuffer,
+    const std::vector<vk::CommandBuffer>& secondaryCommandBuffers) {
+  assert(commandBuffer == getCurrentCommandBuffer() &&
+         "Can't execute secondaries on command buffer from a different frame");
+
+  if (secondaryCommandBuffers.empty()) { return; }
+  commandBuffer.executeCommands(secondaryCommandBuffers);
+}
+
 void Renderer::populateImGuiInitInfo(ImGui_ImplVulkan_InitInfo& initInfo) {
+#ifdef IMGUI_IMPL_VULKAN_HAS_DYNAMIC_RENDERING
+  if (this->device.isDynamicRenderingEnabled()) {
+    // ImGui keeps a pointer to the format, it has to outlive the init call
+    this->imguiColorFormat =
+        static_cast<VkFormat>(this->swapchain->getImageFormat());
+
+    initInfo.UseDynamicRendering = true;
+    initInfo.PipelineRenderingCreateInfo = {};
+    initInfo.PipelineRenderingCreateInfo.sType =
+        VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    initInfo.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
+    initInfo.PipelineRenderingCreateInfo.pColorAttachmentFormats =
+        &this->imguiColorFormat;
+    initInfo.PipelineRenderingCreateInfo.depthAttachmentFormat =
+        static_cast<VkFormat>(this->swapchain->getDepthFormat());
+  }
+#endif
+
   initInfo.RenderPass = getSwapChainRenderPass();
   initInfo.MinImageCount = 2;
   initInfo.ImageCount = getSwapChainImageCount();
@@ -147,6 +352,75 @@ void Renderer::freeCommandBuffers() {
   this->commandBuffers.clear();
 }
 
+void Renderer::createThreadCommandPools() {
+  vk::CommandPoolCreateInfo createInfo{};
+  createInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+  createInfo.queueFamilyIndex =
+      this->device.getQueueIndices().graphicsFamily.value();
+
+  try {
+    for (auto& framePools : this->threadCommandPools) {
+      framePools.resize(this->recordingThreads->getThreadCount());
+      for (auto& pool : framePools) {
+        pool.commandPool = this->device.get()->createCommandPool(createInfo);
+      }
+    }
+  } catch (const vk::SystemError& error) {
+    log::fatal("failed to create per-thread vk::CommandPool");
+    throw std::runtime_error("failed to create per-thread vk::CommandPool");
+  }
+
+  log::trace("created per-thread command pools for",
+             this->recordingThreads->getThreadCount(), "threads");
+}
+
+void Renderer::destroyThreadCommandPools() {
+  for (auto& framePools : this->threadCommandPools) {
+    for (auto& pool : framePools) {
+      // Destroying the pool frees its command buffers
+      this->device.get()->destroyCommandPool(pool.commandPool);
+    }
+    framePools.clear();
+  }
+}
+
+void Renderer::resetThreadCommandPools() {
+  for (auto& pool : this->threadCommandPools[this->currentFrameIndex]) {
+    if (pool.usedCount == 0) { continue; }
+
+    this->device.get()->resetCommandPool(pool.commandPool);
+    pool.usedCount = 0;
+  }
+}
+
+vk::CommandBuffer Renderer::acquireSecondaryCommandBuffer(
+    ThreadCommandPool& pool) {
+  if (pool.usedCount == pool.secondaryCommandBuffers.size()) {
+    vk::CommandBufferAllocateInfo allocInfo{};
+    allocInfo.level = vk::CommandBufferLevel::eSecondary;
+    allocInfo.commandPool = pool.commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    pool.secondaryCommandBuffers.push_back(
+        this->device.get()->allocateCommandBuffers(allocInfo).front());
+  }
+
+  return pool.secondaryCommandBuffers[pool.usedCount++];
+}
+
+void Renderer::setViewportAndScissor(vk::CommandBuffer commandBuffer) {
+  vk::Viewport viewport{0.0f,
+                        0.0f,
+                        static_cast<float>(this->swapchain->width()),
+                        static_cast<float>(this->swapchain->height()),
+                        0.0f,
+                        1.0f};
+  vk::Rect2D scissor{{0, 0}, this->swapchain->getExtent()};
+
+  commandBuffer.setViewport(0, 1, &viewport);
+  commandBuffer.setScissor(0, 1, &scissor);
+}
+
 void Renderer::recreateSwapchain() {
   vk::Extent2D extent = window.getExtent();
   while (extent.width == 0 || extent.height == 0) {
@@ -154,8 +428,6 @@ void Renderer::recreateSwapchain() {
     glfwWaitEvents();
   }
 
-  this->device.waitIdle();
-
   if (this->swapchain == nullptr) {
     this->swapchain = std::make_unique<Swapchain>(this->device, extent);
     return;
@@ -169,6 +441,11 @@ void Renderer::recreateSwapchain() {
     throw std::runtime_error("Swapchain image format has changed");
   }
 
+  // Frames in flight may still reference the old images and framebuffers,
+  // keep the old swapchain alive until they retire instead of waiting idle
+  this->device.getDeletionQueue().push(
+      [oldSwapChain]() mutable { oldSwapChain.reset(); });
+
   log::trace("recreated swapchain");
 }
 
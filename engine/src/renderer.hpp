@@ -1,21 +1,39 @@
 #pragma once
 
+#include <array>
+#include <functional>
 #include <memory>
 #include <vulkan/vulkan.hpp>
 
+#include "descriptors/bindless_table.hpp"
+#include "descriptors/descriptor_allocator.hpp"
+#include "descriptors/descriptor_set_cache.hpp"
 #include "device.hpp"
+#include "gpu_profiler.hpp"
+#include "memory/frame_allocator.hpp"
 #include "swapchain.hpp"
 #include "types.hpp"
+#include "util/thread_pool.hpp"
 #include "window.hpp"
 
 namespace hep {
 
 class Renderer {
  public:
+  using SecondaryRecordFunction =
+      std::function<void(vk::CommandBuffer commandBuffer, u32 chunkIndex)>;
+
   Renderer(const Renderer&) = delete;
   Renderer& operator=(const Renderer&) = delete;
 
-  Renderer(Window& window, Device& device);
+  /**
+   * @param frameAllocatorSize bytes of FrameAllocator memory for each frame
+   * in flight
+   */
+  Renderer(
+      Window& window,
+      Device& device,
+      vk::DeviceSize frameAllocatorSize = FrameAllocator::DEFAULT_REGION_SIZE);
   ~Renderer();
 
   vk::RenderPass getSwapChainRenderPass() const {
@@ -49,23 +67,105 @@ class Renderer {
     return this->swapchain->getImageFormat();
   }
 
+  vk::Format getSwapChainDepthFormat() const {
+    return this->swapchain->getDepthFormat();
+  }
+
   vk::CommandBuffer beginFrame();
   void endFrame();
-  void beginSwapChainRenderPass(vk::CommandBuffer commandBuffer);
+  /**
+   * @param contents pass eSecondaryCommandBuffers when the pass will only
+   * execute buffers from recordSecondaryCommandBuffers, viewport and scissor
+   * are then set inside each secondary instead
+   */
+  void beginSwapChainRenderPass(
+      vk::CommandBuffer commandBuffer,
+      vk::SubpassContents contents = vk::SubpassContents::eInline);
   void endSwapChainRenderPass(vk::CommandBuffer commandBuffer);
 
+  /**
+   * Records chunkCount secondary command buffers for the swapchain render
+   * pass in parallel, calling record once per chunk on a worker thread.
+   * Viewport and scissor are already set when record is called.
+   *
+   * Each worker allocates from its own per-frame command pool, the pools are
+   * reset once the frame's fence has signaled so the returned buffers are
+   * only valid for the current frame.
+   *
+   * @return the secondaries in chunk order, for
+   * executeSecondaryCommandBuffers
+   */
+  std::vector<vk::CommandBuffer> recordSecondaryCommandBuffers(
+      u32 chunkCount,
+      const SecondaryRecordFunction& record);
+  void executeSecondaryCommandBuffers(
+      vk::CommandBuffer commandBuffer,
+      const std::vector<vk::CommandBuffer>& secondaryCommandBuffers);
+
+  GpuProfiler& getProfiler() { return *this->profiler; }
+
+  /** Transient descriptor sets, reset when the frame slot comes around */
+  DescriptorAllocator& getDescriptorAllocator() {
+    return *this->descriptorAllocator;
+  }
+
+  /** Per frame uniform/storage data, rewound when the frame slot repeats */
+  FrameAllocator& getFrameAllocator() { return *this->frameAllocator; }
+
+  /** nullptr when the device lacks descriptor indexing */
+  BindlessTable* getBindlessTable() { return this->bindlessTable.get(); }
+
+  /** Long lived descriptor sets shared between identical resource sets */
+  DescriptorSetCache& getDescriptorSetCache() {
+    return *this->descriptorSetCache;
+  }
+
+  u32 getRecordingThreadCount() const {
+    return this->recordingThreads->getThreadCount();
+  }
+
   void populateImGuiInitInfo(ImGui_ImplVulkan_InitInfo& initInfo);
 
  private:
+  struct ThreadCommandPool {
+    vk::CommandPool commandPool;
+    std::vector<vk::CommandBuffer> secondaryCommandBuffers;
+    u32 usedCount = 0;
+  };
+
   void createCommandBuffers();
   void freeCommandBuffers();
   void recreateSwapchain();
 
+  void createThreadCommandPools();
+  void destroyThreadCommandPools();
+  void resetThreadCommandPools();
+  vk::CommandBuffer acquireSecondaryCommandBuffer(ThreadCommandPool& pool);
+
+  void setViewportAndScissor(vk::CommandBuffer commandBuffer);
+
+  void beginSwapChainRendering(vk::CommandBuffer commandBuffer,
+                               vk::SubpassContents contents);
+  void endSwapChainRendering(vk::CommandBuffer commandBuffer);
+
   Window& window;
   Device& device;
   std::unique_ptr<Swapchain> swapchain;
   std::vector<vk::CommandBuffer> commandBuffers;
 
+  std::unique_ptr<GpuProfiler> profiler;
+  std::unique_ptr<DescriptorAllocator> descriptorAllocator;
+  std::unique_ptr<FrameAllocator> frameAllocator;
+  std::unique_ptr<DescriptorSetCache> descriptorSetCache;
+  std::unique_ptr<BindlessTable> bindlessTable;
+
+  VkFormat imguiColorFormat = VK_FORMAT_UNDEFINED;
+
+  std::unique_ptr<ThreadPool> recordingThreads;
+  // [frame in flight][recording thread]
+  std::array<std::vector<ThreadCommandPool>, Swapchain::MAX_FRAMES_IN_FLIGHT>
+      threadCommandPools;
+
   u32 currentImageIndex;
   int currentFrameIndex = 0;
   bool isFrameStarted = false;
@@ -0,0 +1,15 @@
+#include "scene.hpp"
+
+namespace hep {
+
+void Scene::onPrepare(vk::CommandBuffer commandBuffer, FrameInfo frameInfo) {
+  (void)commandBuffer;
+  (void)frameInfo;
+}
+
+void Scene::onRender(vk::CommandBuffer commandBuffer, FrameInfo frameInfo) {
+  (void)commandBuffer;
+  (void)frameInfo;
+}
+
+}  // namespace hep
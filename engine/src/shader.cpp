@@ -1,13 +1,134 @@
 #include "shader.hpp"
 
+#include <cstring>
 #include <fstream>
 #include <shaderc/shaderc.hpp>
+#include <vulkan/vulkan_core.h>
 
+#include "util/file_io.hpp"
+#include "util/hash.hpp"
 #include "util/logger.hpp"
 
 namespace hep {
 
-void Shader::compile(const std::string& path, ShaderStage shaderStage) {
+static constexpr u32 CACHE_MAGIC = 0x56505348;  // "HSPV"
+static constexpr u32 CACHE_VERSION = 1;
+static constexpr u32 SPIRV_MAGIC = 0x07230203;
+
+// Set explicitly so the cache key can record them, these are shaderc's
+// defaults
+static constexpr shaderc_target_env TARGET_ENV = shaderc_target_env_vulkan;
+static constexpr shaderc_env_version TARGET_ENV_VERSION =
+    shaderc_env_version_vulkan_1_0;
+static constexpr shaderc_optimization_level OPTIMIZATION_LEVEL =
+    shaderc_optimization_level_zero;
+
+struct SpirvCacheHeader {
+  u32 magic;
+  u32 version;
+  u64 key;
+  u64 wordCount;
+  u64 checksum;
+};
+
+/**
+ * Everything that can change the compiler's output. shaderc has no
+ * library version query, the SPIR-V version it emits and the Vulkan SDK
+ * it ships with stand in for it.
+ */
+static u64 cacheKey(const std::vector<char>& source,
+                    shaderc_shader_kind stage,
+                    const std::vector<ShaderDefine>& defines) {
+  u64 key = fnv1a(source.data(), source.size());
+
+  hashCombine(key, static_cast<u64>(stage));
+  for (const ShaderDefine& define : defines) {
+    // Hashed apart so {"AB", ""} and {"A", "B"} differ
+    hashCombine(key, fnv1a(define.name.data(), define.name.size()));
+    hashCombine(key, fnv1a(define.value.data(), define.value.size()));
+  }
+
+  hashCombine(key, static_cast<u64>(TARGET_ENV));
+  hashCombine(key, static_cast<u64>(TARGET_ENV_VERSION));
+  hashCombine(key, static_cast<u64>(OPTIMIZATION_LEVEL));
+
+  unsigned int spirvVersion = 0;
+  unsigned int spirvRevision = 0;
+  shaderc_get_spv_version(&spirvVersion, &spirvRevision);
+  hashCombine(key, static_cast<u64>(spirvVersion));
+  hashCombine(key, static_cast<u64>(spirvRevision));
+  hashCombine(key, static_cast<u64>(VK_HEADER_VERSION_COMPLETE));
+
+  return key;
+}
+
+static std::filesystem::path cachePath(const std::filesystem::path& directory,
+                                       u64 key) {
+  static constexpr char HEX[] = "0123456789abcdef";
+
+  std::string name(16, '0');
+  for (u32 i = 0; i < 16; i++) { name[15 - i] = HEX[(key >> (i * 4)) & 0xf]; }
+
+  return directory / (name + ".spv");
+}
+
+static bool loadCachedSpirv(const std::filesystem::path& path,
+                            u64 key,
+                            std::vector<u32>& spirv) {
+  std::vector<u8> file;
+  if (!readBinaryFile(path, file)) { return false; }
+
+  if (file.size() < sizeof(SpirvCacheHeader)) {
+    log::warning("SPIR-V cache file truncated, ignoring " + path.string());
+    return false;
+  }
+
+  SpirvCacheHeader header{};
+  std::memcpy(&header, file.data(), sizeof(SpirvCacheHeader));
+
+  const u8* payload = file.data() + sizeof(SpirvCacheHeader);
+  u64 payloadSize = file.size() - sizeof(SpirvCacheHeader);
+
+  if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+      header.key != key || header.wordCount == 0 ||
+      header.wordCount * sizeof(u32) != payloadSize ||
+      fnv1a(payload, payloadSize) != header.checksum) {
+    log::warning("SPIR-V cache file is invalid, ignoring " + path.string());
+    return false;
+  }
+
+  spirv.resize(header.wordCount);
+  std::memcpy(spirv.data(), payload, payloadSize);
+
+  return spirv[0] == SPIRV_MAGIC;
+}
+
+static void saveCachedSpirv(const std::filesystem::path& path,
+                            u64 key,
+                            const std::vector<u32>& spirv) {
+  u64 payloadSize = spirv.size() * sizeof(u32);
+
+  SpirvCacheHeader header{};
+  header.magic = CACHE_MAGIC;
+  header.version = CACHE_VERSION;
+  header.key = key;
+  header.wordCount = spirv.size();
+  header.checksum = fnv1a(spirv.data(), payloadSize);
+
+  std::vector<u8> file(sizeof(SpirvCacheHeader) + payloadSize);
+  std::memcpy(file.data(), &header, sizeof(SpirvCacheHeader));
+  std::memcpy(file.data() + sizeof(SpirvCacheHeader), spirv.data(),
+              payloadSize);
+
+  // A failed write only costs a recompile next time
+  if (!writeBinaryFileAtomic(path, file.data(), file.size())) {
+    log::warning("failed to cache SPIR-V to " + path.string());
+  }
+}
+
+void Shader::compile(const std::string& path,
+                     ShaderStage shaderStage,
+                     const std::vector<ShaderDefine>& defines) {
   switch (shaderStage) {
     case ShaderStage::VERTEX:
       this->stage = shaderc_vertex_shader;
@@ -36,18 +157,41 @@ void Shader::compile(const std::string& path, ShaderStage shaderStage) {
   file.read(fileText.data(), fileSize);
   file.close();
 
-  log::info("Compiling shader...");
+  u64 key = cacheKey(fileText, this->stage, defines);
+  std::filesystem::path cacheFile;
+
+  if (!this->cacheDirectory.empty()) {
+    cacheFile = cachePath(this->cacheDirectory, key);
+
+    if (loadCachedSpirv(cacheFile, key, this->spirv)) {
+      log::trace("loaded cached SPIR-V for shader: " + path);
+      return;
+    }
+  }
 
+  log::trace("compiling shader: " + path);
+
+  shaderc::CompileOptions options;
+  options.SetTargetEnvironment(TARGET_ENV, TARGET_ENV_VERSION);
+  options.SetOptimizationLevel(OPTIMIZATION_LEVEL);
+  for (const ShaderDefine& define : defines) {
+    options.AddMacroDefinition(define.name, define.value);
+  }
+
+  // The source isn't null terminated, pass its size explicitly
   shaderc::Compiler compiler;
-  shaderc::SpvCompilationResult result =
-      compiler.CompileGlslToSpv(fileText.data(), this->stage, "user-shader");
+  shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(
+      fileText.data(), fileText.size(), this->stage, path.c_str(), options);
 
   if (result.GetCompilationStatus() != shaderc_compilation_status_success) {
-    log::error("failed to compile shader: ", result.GetErrorMessage());
+    log::fatal("failed to compile shader: ", result.GetErrorMessage());
+    throw std::runtime_error("failed to compile shader: " + path);
   }
 
   this->spirv.assign(result.cbegin(), result.cend());
 
+  if (!cacheFile.empty()) { saveCachedSpirv(cacheFile, key, this->spirv); }
+
   log::info("Successfully compiled shader: " + path + " (" +
             std::to_string(spirv.size() * 4) + " bytes)");
 }
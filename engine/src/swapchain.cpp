@@ -8,30 +8,38 @@
 namespace hep {
 
 Swapchain::Swapchain(Device& device, vk::Extent2D extent)
-    : device{device}, extent{extent} {
+    : device{device}, extent{extent}, headless{device.isHeadless()} {
   initialize();
 }
 
 Swapchain::Swapchain(Device& device,
                      vk::Extent2D extent,
                      std::shared_ptr<Swapchain> previous)
-    : device{device}, extent{extent}, oldSwapchain{previous} {
+    : device{device},
+      extent{extent},
+      headless{device.isHeadless()},
+      oldSwapchain{previous} {
   initialize();
   this->oldSwapchain = nullptr;
 }
 
 Swapchain::~Swapchain() {
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  // Empty when a newer swapchain took over the sync objects
+  for (size_t i = 0; i < this->inFlightFences.size(); i++) {
     this->device.get()->destroySemaphore(this->renderFinishedSemaphores[i]);
     this->device.get()->destroySemaphore(this->imageAvailableSemaphores[i]);
     this->device.get()->destroyFence(this->inFlightFences[i]);
   }
   // log::trace("destroyed sync objects");
 
+  if (this->headless) {
+    this->offscreenFrames.clear();
+    return;
+  }
+
   for (size_t i = 0; i < this->depthImages.size(); i++) {
     this->device.get()->destroyImageView(depthImageViews[i], nullptr);
-    this->device.get()->destroyImage(depthImages[i], nullptr);
-    this->device.get()->freeMemory(depthImageMemorys[i], nullptr);
+    this->device.destroyImage(depthImages[i], depthImageAllocations[i]);
   }
   // log::trace("destroyed depth resources");
 
@@ -61,6 +69,11 @@ vk::Result Swapchain::acquireNextImage(u32* imageIndex) {
     log::error("failed to wait for fence: " + vk::to_string(fenceResult));
   }
 
+  if (this->headless) {
+    *imageIndex = static_cast<u32>(this->currentFrame);
+    return vk::Result::eSuccess;
+  }
+
   vk::Result result = this->device.get()->acquireNextImageKHR(
       this->swapchain, std::numeric_limits<u64>::max(),
       this->imageAvailableSemaphores[this->currentFrame], VK_NULL_HANDLE,
@@ -92,17 +105,21 @@ vk::Result Swapchain::submitCommandBuffers(
       imageAvailableSemaphores[this->currentFrame]};
   vk::PipelineStageFlags waitStages[] = {
       vk::PipelineStageFlagBits::eColorAttachmentOutput};
-  submitInfo.waitSemaphoreCount = 1;
-  submitInfo.pWaitSemaphores = waitSemaphores;
-  submitInfo.pWaitDstStageMask = waitStages;
+  if (!this->headless) {
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = waitSemaphores;
+    submitInfo.pWaitDstStageMask = waitStages;
+  }
 
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = commandBuffers;
 
   vk::Semaphore signalSemaphores[] = {
       renderFinishedSemaphores[this->currentFrame]};
-  submitInfo.signalSemaphoreCount = 1;
-  submitInfo.pSignalSemaphores = signalSemaphores;
+  if (!this->headless) {
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = signalSemaphores;
+  }
 
   vk::Result resetFencesResult =
       this->device.get()->resetFences(1, &inFlightFences[this->currentFrame]);
@@ -120,6 +137,11 @@ vk::Result Swapchain::submitCommandBuffers(
     throw std::runtime_error("failed to submit draw command buffer");
   }
 
+  if (this->headless) {
+    this->currentFrame = (this->currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    return vk::Result::eSuccess;
+  }
+
   vk::PresentInfoKHR presentInfo = {};
   presentInfo.waitSemaphoreCount = 1;
   presentInfo.pWaitSemaphores = signalSemaphores;
@@ -136,12 +158,22 @@ vk::Result Swapchain::submitCommandBuffers(
 }
 
 void Swapchain::initialize() {
+  if (this->headless) {
+    createOffscreenFrames();
+    createSyncObjects();
+    return;
+  }
+
   setDefaultCreateInfo();
   createSwapchain();
   createImageViews();
-  createRenderPass();
   createDepthResources();
-  createFramebuffers();
+
+  if (!this->device.isDynamicRenderingEnabled()) {
+    createRenderPass();
+    createFramebuffers();
+  }
+
   createSyncObjects();
 }
 
@@ -306,7 +338,7 @@ void Swapchain::createDepthResources() {
   this->depthFormat = findDepthFormat();
 
   this->depthImages.resize(imageCount());
-  this->depthImageMemorys.resize(imageCount());
+  this->depthImageAllocations.resize(imageCount());
   this->depthImageViews.resize(imageCount());
 
   for (size_t i = 0; i < this->depthImages.size(); i++) {
@@ -326,7 +358,7 @@ void Swapchain::createDepthResources() {
 
     this->device.createImageWithInfo(
         imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal,
-        this->depthImages[i], depthImageMemorys[i]);
+        this->depthImages[i], depthImageAllocations[i]);
 
     vk::ImageViewCreateInfo viewInfo{};
     viewInfo.image = this->depthImages[i];
@@ -376,10 +408,28 @@ void Swapchain::createFramebuffers() {
 }
 
 void Swapchain::createSyncObjects() {
+  this->imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+
+  // Take over the previous swapchain's fences, they still guard the frames
+  // in flight and the Renderer's per-frame command buffers
+  if (this->oldSwapchain != nullptr &&
+      !this->oldSwapchain->inFlightFences.empty()) {
+    this->imageAvailableSemaphores =
+        std::move(this->oldSwapchain->imageAvailableSemaphores);
+    this->renderFinishedSemaphores =
+        std::move(this->oldSwapchain->renderFinishedSemaphores);
+    this->inFlightFences = std::move(this->oldSwapchain->inFlightFences);
+    this->currentFrame = this->oldSwapchain->currentFrame;
+
+    this->oldSwapchain->imageAvailableSemaphores.clear();
+    this->oldSwapchain->renderFinishedSemaphores.clear();
+    this->oldSwapchain->inFlightFences.clear();
+    return;
+  }
+
   this->imageAvailableSemaphores.resize(Swapchain::MAX_FRAMES_IN_FLIGHT);
   this->renderFinishedSemaphores.resize(Swapchain::MAX_FRAMES_IN_FLIGHT);
   this->inFlightFences.resize(Swapchain::MAX_FRAMES_IN_FLIGHT);
-  this->imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
 
   try {
     for (u32 i = 0; i < Swapchain::MAX_FRAMES_IN_FLIGHT; i++) {
@@ -398,6 +448,38 @@ void Swapchain::createSyncObjects() {
   }
 }
 
+void Swapchain::createOffscreenFrames() {
+  this->imageFormat = this->device.findSupportedFormat(
+      {vk::Format::eB8G8R8A8Unorm, vk::Format::eR8G8B8A8Unorm},
+      vk::ImageTiling::eOptimal,
+      vk::FormatFeatureFlagBits::eColorAttachment);
+  this->depthFormat = findDepthFormat();
+
+  // One target per frame in flight, the fences already keep a frame's
+  // target from being reused while the GPU still renders into it
+  for (u32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    auto frame = Frame::Builder(this->device)
+                     .setImageExtent(this->extent)
+                     .setImageFormat(this->imageFormat)
+                     .setImageUsage(vk::ImageUsageFlagBits::eColorAttachment |
+                                    vk::ImageUsageFlagBits::eSampled |
+                                    vk::ImageUsageFlagBits::eTransferSrc)
+                     .build();
+
+    this->images.push_back(frame->getImage());
+    this->imageViews.push_back(frame->getImageView());
+    this->depthImages.push_back(frame->getDepthImage());
+    this->depthImageViews.push_back(frame->getDepthImageView());
+    this->framebuffers.push_back(frame->getFramebuffer());
+    this->offscreenFrames.push_back(std::move(frame));
+  }
+
+  // Every Frame builds an identical, hence compatible, render pass
+  this->renderPass = this->offscreenFrames.front()->getRenderPass();
+
+  log::trace("created offscreen frames for headless rendering");
+}
+
 vk::SurfaceFormatKHR Swapchain::chooseSurfaceFormat(
     const std::vector<vk::SurfaceFormatKHR>& availableFormats) {
   if (availableFormats.size() == 1 &&
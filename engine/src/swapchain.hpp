@@ -5,6 +5,7 @@
 #include <vulkan/vulkan.hpp>
 
 #include "device.hpp"
+#include "frame.hpp"
 #include "types.hpp"
 
 namespace hep {
@@ -26,8 +27,21 @@ class Swapchain {
     return this->framebuffers.at(index);
   }
 
+  /** Null when the device uses dynamic rendering */
   vk::RenderPass getRenderPass() const { return this->renderPass; }
+  vk::Image getImage(int index) { return this->images.at(index); }
   vk::ImageView getImageView(int index) { return this->imageViews.at(index); }
+  vk::Image getDepthImage(int index) { return this->depthImages.at(index); }
+  vk::ImageView getDepthImageView(int index) {
+    return this->depthImageViews.at(index);
+  }
+  vk::Format getDepthFormat() { return this->depthFormat; }
+
+  /** Layout images must be left in at the end of a frame */
+  vk::ImageLayout getFinalLayout() const {
+    return this->headless ? vk::ImageLayout::eShaderReadOnlyOptimal
+                          : vk::ImageLayout::ePresentSrcKHR;
+  }
   size_t imageCount() { return this->images.size(); }
   vk::Format getImageFormat() { return this->imageFormat; }
   vk::Extent2D getExtent() { return this->extent; }
@@ -39,6 +53,12 @@ class Swapchain {
            static_cast<float>(this->extent.height);
   }
 
+  /**
+   * Headless swapchains render into offscreen Frames, acquiring never blocks
+   * on a presentation engine and submitting doesn't present
+   */
+  bool isHeadless() const { return this->headless; }
+
   vk::Result acquireNextImage(u32* imageIndex);
   vk::Result submitCommandBuffers(const vk::CommandBuffer* buffers,
                                   u32* imageIndex);
@@ -57,6 +77,7 @@ class Swapchain {
   void createDepthResources();
   void createFramebuffers();
   void createSyncObjects();
+  void createOffscreenFrames();
 
   vk::SurfaceFormatKHR chooseSurfaceFormat(
       const std::vector<vk::SurfaceFormatKHR>& availableFormats);
@@ -68,6 +89,7 @@ class Swapchain {
 
   Device& device;
   vk::Extent2D extent;
+  bool headless;
 
   vk::SwapchainKHR swapchain;
   vk::SwapchainCreateInfoKHR swapchainCreateInfo;
@@ -82,9 +104,12 @@ class Swapchain {
 
   vk::Format depthFormat;
   std::vector<vk::Image> depthImages;
-  std::vector<vk::DeviceMemory> depthImageMemorys;
+  std::vector<Allocation> depthImageAllocations;
   std::vector<vk::ImageView> depthImageViews;
 
+  // Owns images, views, framebuffers and the render pass when headless
+  std::vector<std::unique_ptr<Frame>> offscreenFrames;
+
   std::vector<vk::Semaphore> imageAvailableSemaphores;
   std::vector<vk::Semaphore> renderFinishedSemaphores;
   std::vector<vk::Fence> inFlightFences;
@@ -1,14 +1,31 @@
 #include "basic_render_system.hpp"
 
+#include <array>
+#include <cstring>
+
+#include "layout_cache.hpp"
+#include "memory/frame_allocator.hpp"
 #include "util/logger.hpp"
 
 namespace hep {
 
 BasicRenderSystem::BasicRenderSystem(Device& device, vk::RenderPass renderPass)
-    : device{device}, pipeline{device} {
+    : device{device}, pipeline{device}, instancedPipeline{device} {
   createPipelineLayout();
   createPipeline(renderPass);
+  createQuad();
+}
 
+BasicRenderSystem::BasicRenderSystem(Device& device,
+                                     vk::Format colorFormat,
+                                     vk::Format depthFormat)
+    : device{device}, pipeline{device}, instancedPipeline{device} {
+  createPipelineLayout();
+  createPipeline(colorFormat, depthFormat);
+  createQuad();
+}
+
+void BasicRenderSystem::createQuad() {
   Model::Builder quadBuilder{};
   quadBuilder.vertices = {{{-1.0f, -1.0f}, {1, 0, 0}},
                           {{-1.0f, 1.0f}, {1, 0, 0}},
@@ -21,10 +38,7 @@ BasicRenderSystem::BasicRenderSystem(Device& device, vk::RenderPass renderPass)
   pushConstant.transform = glm::mat4(1.0f);
 }
 
-BasicRenderSystem ::~BasicRenderSystem() {
-  log::trace("destroyed vk::PipelineLayout");
-  this->device.get()->destroyPipelineLayout(this->pipelineLayout);
-}
+BasicRenderSystem ::~BasicRenderSystem() {}
 
 void BasicRenderSystem::render(vk::CommandBuffer commandBuffer,
                                FrameInfo frameInfo) {
@@ -45,6 +59,114 @@ void BasicRenderSystem::render(vk::CommandBuffer commandBuffer,
   quad->draw(commandBuffer);
 }
 
+void BasicRenderSystem::renderPerDraw(vk::CommandBuffer commandBuffer,
+                                      FrameInfo frameInfo,
+                                      const Model::InstanceData* instances,
+                                      u32 count) {
+  if (count == 0) { return; }
+
+  this->pipeline.bind(commandBuffer);
+  quad->bind(commandBuffer);
+
+  // Local copy, pushConstant is shared with render()
+  PushConstantData push{};
+  push.data = {frameInfo.currentFramebufferExtent.x,
+               frameInfo.currentFramebufferExtent.y, frameInfo.elapsedTime,
+               0.0f};
+
+  for (u32 i = 0; i < count; i++) {
+    push.transform = instances[i].transform;
+    push.color = instances[i].color;
+    commandBuffer.pushConstants(
+        this->pipelineLayout,
+        vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+        0, sizeof(PushConstantData), &push);
+
+    quad->draw(commandBuffer);
+  }
+}
+
+void BasicRenderSystem::renderInstanced(
+    vk::CommandBuffer commandBuffer,
+    FrameInfo frameInfo,
+    const std::vector<Model::InstanceData>& instances) {
+  if (instances.empty()) { return; }
+
+  FrameAllocation instanceData = frameInfo.frameAllocator->allocate(
+      instances.size() * sizeof(Model::InstanceData));
+  std::memcpy(instanceData.data, instances.data(), instanceData.size);
+
+  bindInstancedPipeline(commandBuffer, frameInfo);
+
+  quad->bind(commandBuffer);
+  quad->bindInstances(commandBuffer, instanceData.buffer, instanceData.offset);
+  quad->drawInstanced(commandBuffer, static_cast<u32>(instances.size()));
+}
+
+void BasicRenderSystem::renderInstanced(
+    vk::CommandBuffer commandBuffer,
+    FrameInfo frameInfo,
+    Model& model,
+    const std::vector<Model::InstanceData>& instances,
+    std::vector<u32>& lods) {
+  if (instances.empty()) { return; }
+
+  assert(model.getVertexLayout() == VertexLayout::standard() &&
+         "instancedPipeline only reads VertexLayout::standard() vertices");
+
+  lods.resize(instances.size(), 0);
+
+  std::array<u32, Model::MAX_LODS> lodCounts{};
+  for (size_t i = 0; i < instances.size(); i++) {
+    f32 radius = model.getProjectedRadius(
+        instances[i].transform, frameInfo.currentFramebufferExtent.y);
+    lods[i] = model.selectLod(radius, lods[i]);
+    lodCounts[lods[i]]++;
+  }
+
+  // Instances are grouped by LOD so each level is one contiguous range
+  std::array<u32, Model::MAX_LODS> lodOffsets{};
+  for (u32 lod = 1; lod < Model::MAX_LODS; lod++) {
+    lodOffsets[lod] = lodOffsets[lod - 1] + lodCounts[lod - 1];
+  }
+
+  FrameAllocation instanceData = frameInfo.frameAllocator->allocate(
+      instances.size() * sizeof(Model::InstanceData));
+
+  auto* grouped = static_cast<Model::InstanceData*>(instanceData.data);
+  std::array<u32, Model::MAX_LODS> cursors = lodOffsets;
+  for (size_t i = 0; i < instances.size(); i++) {
+    grouped[cursors[lods[i]]++] = instances[i];
+  }
+
+  bindInstancedPipeline(commandBuffer, frameInfo);
+
+  model.bind(commandBuffer);
+  model.bindInstances(commandBuffer, instanceData.buffer, instanceData.offset);
+
+  for (u32 lod = 0; lod < model.getLodCount(); lod++) {
+    if (lodCounts[lod] == 0) { continue; }
+    model.drawLod(commandBuffer, lod, lodCounts[lod], lodOffsets[lod]);
+  }
+}
+
+void BasicRenderSystem::bindInstancedPipeline(vk::CommandBuffer commandBuffer,
+                                              FrameInfo frameInfo) {
+  this->instancedPipeline.bind(commandBuffer);
+
+  // Transform and color come from the instance stream, the fragment shader
+  // still reads the viewport and time from the push constants. Local copy
+  // like renderPerDraw, pushConstant is shared with render()
+  PushConstantData push{};
+  push.data = {frameInfo.currentFramebufferExtent.x,
+               frameInfo.currentFramebufferExtent.y, frameInfo.elapsedTime,
+               0.0f};
+  commandBuffer.pushConstants(
+      this->pipelineLayout,
+      vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0,
+      sizeof(PushConstantData), &push);
+}
+
 void BasicRenderSystem::createPipelineLayout() {
   vk::PushConstantRange pushConstantRange{};
 
@@ -53,19 +175,9 @@ void BasicRenderSystem::createPipelineLayout() {
   pushConstantRange.offset = 0;
   pushConstantRange.size = sizeof(PushConstantData);
 
-  vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {};
-  pipelineLayoutInfo.setLayoutCount = 0;
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-  try {
-    this->pipelineLayout =
-        this->device.get()->createPipelineLayout(pipelineLayoutInfo);
-    log::trace("created vk::PipelineLayout");
-  } catch (const vk::SystemError& err) {
-    log::fatal("failed to create vk::PipelineLayout");
-    throw std::runtime_error("failed to create vk::PipelineLayout");
-  }
+  // Owned by the LayoutCache, shared with any system using the same ranges
+  this->pipelineLayout =
+      this->device.getLayoutCache().getPipelineLayout({}, {pushConstantRange});
 }
 
 void BasicRenderSystem::createPipeline(vk::RenderPass renderPass) {
@@ -75,6 +187,44 @@ void BasicRenderSystem::createPipeline(vk::RenderPass renderPass) {
   this->pipeline.create("shaders/triangle.vert.spv",
                         "shaders/triangle.frag.spv", this->pipelineLayout,
                         renderPass);
+
+  setInstancedVertexInput();
+  this->instancedPipeline.create("shaders/instanced.vert.spv",
+                                 "shaders/triangle.frag.spv",
+                                 this->pipelineLayout, renderPass);
+}
+
+void BasicRenderSystem::createPipeline(vk::Format colorFormat,
+                                       vk::Format depthFormat) {
+  assert(pipelineLayout != nullptr &&
+         "Cannot create pipeline before pipeline layout");
+
+  this->pipeline.create("shaders/triangle.vert.spv",
+                        "shaders/triangle.frag.spv", this->pipelineLayout,
+                        colorFormat, depthFormat);
+
+  setInstancedVertexInput();
+  this->instancedPipeline.create("shaders/instanced.vert.spv",
+                                 "shaders/triangle.frag.spv",
+                                 this->pipelineLayout, colorFormat,
+                                 depthFormat);
+}
+
+void BasicRenderSystem::setInstancedVertexInput() {
+  auto bindingDescriptions = Model::Vertex::getBindingDescriptions();
+  auto attributeDescriptions = Model::Vertex::getAttributeDescriptions();
+
+  auto instanceBindings = Model::InstanceData::getBindingDescriptions();
+  auto instanceAttributes = Model::InstanceData::getAttributeDescriptions();
+
+  bindingDescriptions.insert(bindingDescriptions.end(),
+                             instanceBindings.begin(), instanceBindings.end());
+  attributeDescriptions.insert(attributeDescriptions.end(),
+                               instanceAttributes.begin(),
+                               instanceAttributes.end());
+
+  this->instancedPipeline.setVertexInput(std::move(bindingDescriptions),
+                                         std::move(attributeDescriptions));
 }
 
 }  // namespace hep
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 
 #define GLM_FORCE_RADIANS
@@ -32,13 +33,57 @@ class BasicRenderSystem {
   };
 
   BasicRenderSystem(Device& device, vk::RenderPass renderPass);
+  /** For dynamic rendering, see Renderer::getSwapChainImageFormat */
+  BasicRenderSystem(Device& device,
+                    vk::Format colorFormat,
+                    vk::Format depthFormat);
   ~BasicRenderSystem();
 
   void render(vk::CommandBuffer commandBuffer, FrameInfo frameInfo);
 
+  /**
+   * Draws one quad per entry, each with its own push constants and draw
+   * call. Leaves the system untouched, so threads may record disjoint
+   * ranges into their own command buffers at the same time.
+   */
+  void renderPerDraw(vk::CommandBuffer commandBuffer,
+                     FrameInfo frameInfo,
+                     const Model::InstanceData* instances,
+                     u32 count);
+
+  /**
+   * Draws one quad per entry with a single instanced draw, the instance
+   * stream is copied into frameInfo.frameAllocator
+   */
+  void renderInstanced(vk::CommandBuffer commandBuffer,
+                       FrameInfo frameInfo,
+                       const std::vector<Model::InstanceData>& instances);
+
+  /**
+   * Draws model once per entry, each instance at the LOD its projected
+   * size calls for (Model::selectLod), with one instanced draw per LOD.
+   * lods carries every instance's LOD over from the previous frame for
+   * hysteresis, it is resized to match instances and updated.
+   *
+   * @note model must use VertexLayout::standard(), the instanced pipeline
+   * is built for that layout only
+   */
+  void renderInstanced(vk::CommandBuffer commandBuffer,
+                       FrameInfo frameInfo,
+                       Model& model,
+                       const std::vector<Model::InstanceData>& instances,
+                       std::vector<u32>& lods);
+
  private:
   void createPipelineLayout();
   void createPipeline(vk::RenderPass renderPass);
+  void createPipeline(vk::Format colorFormat, vk::Format depthFormat);
+  void setInstancedVertexInput();
+  void createQuad();
+
+  /** Shared setup of both renderInstanced overloads */
+  void bindInstancedPipeline(vk::CommandBuffer commandBuffer,
+                             FrameInfo frameInfo);
 
   // temp
   PushConstantData pushConstant;
@@ -46,6 +91,7 @@ class BasicRenderSystem {
 
   Device& device;
   Pipeline pipeline;
+  Pipeline instancedPipeline;
   vk::PipelineLayout pipelineLayout;
 
   std::unique_ptr<Model> quad;
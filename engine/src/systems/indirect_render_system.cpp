@@ -0,0 +1,340 @@
+#include "indirect_render_system.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+#include "descriptors/descriptor_writer.hpp"
+#include "geometry_arena.hpp"
+#include "layout_cache.hpp"
+#include "util/logger.hpp"
+
+namespace hep {
+
+IndirectRenderSystem::IndirectRenderSystem(Device& device,
+                                           vk::RenderPass renderPass,
+                                           u32 maxDraws)
+    : device{device}, maxDraws{maxDraws}, drawPipeline{device} {
+  createLayouts();
+  createBuffers();
+  createPipeline(renderPass);
+}
+
+IndirectRenderSystem::IndirectRenderSystem(Device& device,
+                                           vk::Format colorFormat,
+                                           vk::Format depthFormat,
+                                           u32 maxDraws)
+    : device{device}, maxDraws{maxDraws}, drawPipeline{device} {
+  createLayouts();
+  createBuffers();
+  createPipeline(colorFormat, depthFormat);
+}
+
+IndirectRenderSystem::~IndirectRenderSystem() {}
+
+u32 IndirectRenderSystem::addDraw(const Model& model,
+                                  const glm::mat4& transform,
+                                  const glm::vec4& color) {
+  const MeshRange& mesh = model.getMeshRange();
+  assert(mesh.indexCount > 0 && "indirect draws need an indexed model");
+
+  // Every draw goes through one 32 bit index binding, u16 indices would be
+  // read in pairs as garbage
+  if (mesh.indexType != vk::IndexType::eUint32) {
+    log::fatal("indirect draws need 32 bit indices, build the model with",
+               "Model::Builder::allowIndex16 off");
+    throw std::runtime_error("indirect draws need 32 bit indices");
+  }
+
+  DrawRecord record{};
+  record.transform = transform;
+  record.color = color;
+  record.boundingSphere = model.getBoundingSphere();
+  // GPU driven draws stay on the full detail LOD
+  record.indexCount = model.getLod(0).indexCount;
+  record.firstIndex = mesh.firstIndex + model.getLod(0).firstIndex;
+  record.vertexOffset = static_cast<s32>(mesh.firstVertex);
+
+  u32 draw;
+  if (!this->freeDraws.empty()) {
+    draw = this->freeDraws.back();
+    this->freeDraws.pop_back();
+    this->records[draw] = record;
+  } else {
+    if (this->records.size() == this->maxDraws) {
+      log::fatal("indirect render system is full at", this->maxDraws,
+                 "draws");
+      throw std::runtime_error("indirect render system is full");
+    }
+
+    draw = static_cast<u32>(this->records.size());
+    this->records.push_back(record);
+  }
+
+  this->recordVersion++;
+  return draw;
+}
+
+void IndirectRenderSystem::setTransform(u32 draw, const glm::mat4& transform) {
+  assert(draw < this->records.size() && "draw out of range");
+
+  this->records[draw].transform = transform;
+  this->recordVersion++;
+}
+
+void IndirectRenderSystem::removeDraw(u32 draw) {
+  if (draw == INVALID_DRAW) { return; }
+  assert(draw < this->records.size() && "draw out of range");
+
+  // cull.comp skips records without indices
+  this->records[draw].indexCount = 0;
+  this->freeDraws.push_back(draw);
+  this->recordVersion++;
+}
+
+void IndirectRenderSystem::cull(vk::CommandBuffer commandBuffer,
+                                FrameInfo frameInfo,
+                                const glm::mat4& viewProjection) {
+  this->viewProjection = viewProjection;
+
+  if (this->records.empty()) { return; }
+
+  u32 frameIndex = frameInfo.frameIndex;
+  uploadRecords(frameIndex);
+
+  vk::DeviceSize countOffset =
+      this->countBuffer->getAlignmentSize() * frameIndex;
+  vk::DeviceSize commandOffset =
+      this->indirectBuffer->getAlignmentSize() * frameIndex;
+
+  commandBuffer.fillBuffer(this->countBuffer->getBuffer(), countOffset,
+                           sizeof(u32), 0);
+
+  vk::BufferMemoryBarrier clearBarrier{};
+  clearBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+  clearBarrier.dstAccessMask =
+      vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+  clearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  clearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  clearBarrier.buffer = this->countBuffer->getBuffer();
+  clearBarrier.offset = countOffset;
+  clearBarrier.size = sizeof(u32);
+
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                vk::PipelineStageFlagBits::eComputeShader,
+                                vk::DependencyFlags{}, nullptr, clearBarrier,
+                                nullptr);
+
+  this->cullPipeline->bind(commandBuffer);
+
+  vk::DescriptorBufferInfo recordInfo =
+      this->recordBuffer->descriptorInfoForIndex(frameIndex);
+  vk::DescriptorBufferInfo commandInfo =
+      this->indirectBuffer->descriptorInfoForIndex(frameIndex);
+  vk::DescriptorBufferInfo countInfo =
+      this->countBuffer->descriptorInfoForIndex(frameIndex);
+
+  DescriptorWriter(*this->cullSetLayout, *frameInfo.descriptorAllocator)
+      .writeBuffer(0, &recordInfo)
+      .writeBuffer(1, &commandInfo)
+      .writeBuffer(2, &countInfo)
+      .push(commandBuffer, this->cullPipelineLayout, 0,
+            vk::PipelineBindPoint::eCompute);
+
+  // Gribb/Hartmann, rows of the view projection give the clip planes. Near
+  // is row 2 alone because depth is zero to one.
+  glm::mat4 m = glm::transpose(viewProjection);
+  CullPushConstants push{};
+  push.frustumPlanes[0] = m[3] + m[0];
+  push.frustumPlanes[1] = m[3] - m[0];
+  push.frustumPlanes[2] = m[3] + m[1];
+  push.frustumPlanes[3] = m[3] - m[1];
+  push.frustumPlanes[4] = m[2];
+  push.frustumPlanes[5] = m[3] - m[2];
+  for (glm::vec4& plane : push.frustumPlanes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  push.recordCount = static_cast<u32>(this->records.size());
+  push.compact = this->device.isDrawIndirectCountEnabled() ? 1 : 0;
+
+  commandBuffer.pushConstants(this->cullPipelineLayout,
+                              vk::ShaderStageFlagBits::eCompute, 0,
+                              sizeof(CullPushConstants), &push);
+
+  u32 groupCount = (push.recordCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+  commandBuffer.dispatch(groupCount, 1, 1);
+
+  std::array<vk::BufferMemoryBarrier, 2> drawBarriers{};
+  for (auto& barrier : drawBarriers) {
+    barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  }
+  drawBarriers[0].buffer = this->indirectBuffer->getBuffer();
+  drawBarriers[0].offset = commandOffset;
+  drawBarriers[0].size = this->indirectBuffer->getAlignmentSize();
+  drawBarriers[1].buffer = this->countBuffer->getBuffer();
+  drawBarriers[1].offset = countOffset;
+  drawBarriers[1].size = sizeof(u32);
+
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                vk::PipelineStageFlagBits::eDrawIndirect,
+                                vk::DependencyFlags{}, nullptr, drawBarriers,
+                                nullptr);
+}
+
+void IndirectRenderSystem::render(vk::CommandBuffer commandBuffer,
+                                  FrameInfo frameInfo) {
+  if (this->records.empty()) { return; }
+
+  u32 frameIndex = frameInfo.frameIndex;
+
+  this->drawPipeline.bind(commandBuffer);
+
+  vk::DescriptorBufferInfo recordInfo =
+      this->recordBuffer->descriptorInfoForIndex(frameIndex);
+  DescriptorWriter(*this->drawSetLayout, *frameInfo.descriptorAllocator)
+      .writeBuffer(0, &recordInfo)
+      .push(commandBuffer, this->drawPipelineLayout, 0,
+            vk::PipelineBindPoint::eGraphics);
+
+  DrawPushConstants push{};
+  push.transform = this->viewProjection;
+  push.color = glm::vec4{1.0f};
+  push.data = {frameInfo.currentFramebufferExtent.x,
+               frameInfo.currentFramebufferExtent.y, frameInfo.elapsedTime,
+               0.0f};
+  commandBuffer.pushConstants(
+      this->drawPipelineLayout,
+      vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0,
+      sizeof(DrawPushConstants), &push);
+
+  this->device.getGeometryArena().bind(commandBuffer);
+
+  vk::Buffer indirect = this->indirectBuffer->getBuffer();
+  vk::DeviceSize commandOffset =
+      this->indirectBuffer->getAlignmentSize() * frameIndex;
+  u32 drawCount = static_cast<u32>(this->records.size());
+  u32 stride = sizeof(vk::DrawIndexedIndirectCommand);
+
+  if (this->device.isDrawIndirectCountEnabled()) {
+    commandBuffer.drawIndexedIndirectCount(
+        indirect, commandOffset, this->countBuffer->getBuffer(),
+        this->countBuffer->getAlignmentSize() * frameIndex, drawCount, stride);
+  } else if (this->device.isMultiDrawIndirectEnabled()) {
+    commandBuffer.drawIndexedIndirect(indirect, commandOffset, drawCount,
+                                      stride);
+  } else {
+    for (u32 i = 0; i < drawCount; i++) {
+      commandBuffer.drawIndexedIndirect(indirect, commandOffset + i * stride,
+                                        1, stride);
+    }
+  }
+}
+
+void IndirectRenderSystem::createLayouts() {
+  if (!this->device.isDrawIndirectFirstInstanceEnabled()) {
+    log::fatal("indirect rendering needs drawIndirectFirstInstance");
+    throw std::runtime_error(
+        "indirect rendering needs drawIndirectFirstInstance");
+  }
+
+  this->cullSetLayout =
+      DescriptorSetLayout::Builder(this->device)
+          .addBinding(0, vk::DescriptorType::eStorageBuffer,
+                      vk::ShaderStageFlagBits::eCompute)
+          .addBinding(1, vk::DescriptorType::eStorageBuffer,
+                      vk::ShaderStageFlagBits::eCompute)
+          .addBinding(2, vk::DescriptorType::eStorageBuffer,
+                      vk::ShaderStageFlagBits::eCompute)
+          .setPushDescriptor()
+          .build();
+
+  this->drawSetLayout =
+      DescriptorSetLayout::Builder(this->device)
+          .addBinding(0, vk::DescriptorType::eStorageBuffer,
+                      vk::ShaderStageFlagBits::eVertex)
+          .setPushDescriptor()
+          .build();
+
+  vk::PushConstantRange cullRange{};
+  cullRange.stageFlags = vk::ShaderStageFlagBits::eCompute;
+  cullRange.offset = 0;
+  cullRange.size = sizeof(CullPushConstants);
+
+  vk::PushConstantRange drawRange{};
+  drawRange.stageFlags =
+      vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+  drawRange.offset = 0;
+  drawRange.size = sizeof(DrawPushConstants);
+
+  LayoutCache& layoutCache = this->device.getLayoutCache();
+  this->cullPipelineLayout = layoutCache.getPipelineLayout(
+      {this->cullSetLayout->getDescriptorSetLayout()}, {cullRange});
+  this->drawPipelineLayout = layoutCache.getPipelineLayout(
+      {this->drawSetLayout->getDescriptorSetLayout()}, {drawRange});
+
+  this->cullPipeline = std::make_unique<ComputePipeline>(
+      this->device, "shaders/cull.comp.spv", this->cullPipelineLayout);
+}
+
+void IndirectRenderSystem::createBuffers() {
+  u32 frameCount = Swapchain::MAX_FRAMES_IN_FLIGHT;
+  vk::DeviceSize alignment =
+      this->device.properties.limits.minStorageBufferOffsetAlignment;
+
+  this->recordBuffer = std::make_unique<Buffer>(
+      this->device, sizeof(DrawRecord) * this->maxDraws, frameCount,
+      vk::BufferUsageFlagBits::eStorageBuffer,
+      vk::MemoryPropertyFlagBits::eHostVisible |
+          vk::MemoryPropertyFlagBits::eHostCoherent,
+      alignment);
+
+  if (this->recordBuffer->map() != vk::Result::eSuccess) {
+    log::fatal("failed to map indirect draw records");
+    throw std::runtime_error("failed to map indirect draw records");
+  }
+
+  this->indirectBuffer = std::make_unique<Buffer>(
+      this->device, sizeof(vk::DrawIndexedIndirectCommand) * this->maxDraws,
+      frameCount,
+      vk::BufferUsageFlagBits::eStorageBuffer |
+          vk::BufferUsageFlagBits::eIndirectBuffer,
+      vk::MemoryPropertyFlagBits::eDeviceLocal, alignment);
+
+  this->countBuffer = std::make_unique<Buffer>(
+      this->device, sizeof(u32), frameCount,
+      vk::BufferUsageFlagBits::eStorageBuffer |
+          vk::BufferUsageFlagBits::eIndirectBuffer |
+          vk::BufferUsageFlagBits::eTransferDst,
+      vk::MemoryPropertyFlagBits::eDeviceLocal, alignment);
+}
+
+void IndirectRenderSystem::createPipeline(vk::RenderPass renderPass) {
+  this->drawPipeline.create("shaders/indirect.vert.spv",
+                            "shaders/triangle.frag.spv",
+                            this->drawPipelineLayout, renderPass);
+}
+
+void IndirectRenderSystem::createPipeline(vk::Format colorFormat,
+                                          vk::Format depthFormat) {
+  this->drawPipeline.create("shaders/indirect.vert.spv",
+                            "shaders/triangle.frag.spv",
+                            this->drawPipelineLayout, colorFormat,
+                            depthFormat);
+}
+
+void IndirectRenderSystem::uploadRecords(u32 frameIndex) {
+  // The frame's fence has signaled, nothing reads this region anymore
+  if (this->frameVersions[frameIndex] == this->recordVersion) { return; }
+
+  u8* region = static_cast<u8*>(this->recordBuffer->getMappedMemory()) +
+               this->recordBuffer->getAlignmentSize() * frameIndex;
+  std::memcpy(region, this->records.data(),
+              this->records.size() * sizeof(DrawRecord));
+
+  this->frameVersions[frameIndex] = this->recordVersion;
+}
+
+}  // namespace hep
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "buffer.hpp"
+#include "compute_pipeline.hpp"
+#include "descriptors/descriptor_set_layout.hpp"
+#include "device.hpp"
+#include "frame_info.hpp"
+#include "model.hpp"
+#include "pipeline.hpp"
+#include "swapchain.hpp"
+
+namespace hep {
+
+/**
+ * GPU driven renderer for models living in the GeometryArena
+ *
+ * Every draw is a DrawRecord in a storage buffer. cull() dispatches
+ * cull.comp, which tests each record's bounding sphere against the view
+ * frustum and appends a vk::DrawIndexedIndirectCommand for the survivors,
+ * render() then issues a single drawIndexedIndirectCount. The CPU cost per
+ * frame doesn't depend on the number of draws, records are only copied
+ * again after they change.
+ *
+ * Without drawIndirectCount every record keeps its own command slot and
+ * culled ones get an instanceCount of 0, without multiDrawIndirect those
+ * slots are drawn one indirect call at a time.
+ */
+class IndirectRenderSystem {
+ public:
+  IndirectRenderSystem(const IndirectRenderSystem&) = delete;
+  IndirectRenderSystem& operator=(const IndirectRenderSystem&) = delete;
+
+  /** std430 layout, must match cull.comp and indirect.vert */
+  struct DrawRecord {
+    glm::mat4 transform;
+    glm::vec4 color;
+    glm::vec4 boundingSphere;
+    u32 indexCount;
+    u32 firstIndex;
+    s32 vertexOffset;
+    u32 padding;
+  };
+
+  struct CullPushConstants {
+    glm::vec4 frustumPlanes[6];
+    u32 recordCount;
+    u32 compact;
+  };
+
+  /** Same block as triangle.frag, transform holds the view projection */
+  struct DrawPushConstants {
+    glm::mat4 transform;
+    glm::vec4 color;
+    glm::vec4 data;
+  };
+
+  /** Must match local_size_x of cull.comp */
+  static constexpr u32 WORKGROUP_SIZE = 64;
+  static constexpr u32 INVALID_DRAW = ~0u;
+
+  IndirectRenderSystem(Device& device,
+                       vk::RenderPass renderPass,
+                       u32 maxDraws);
+  /** For dynamic rendering, see Renderer::getSwapChainImageFormat */
+  IndirectRenderSystem(Device& device,
+                       vk::Format colorFormat,
+                       vk::Format depthFormat,
+                       u32 maxDraws);
+  ~IndirectRenderSystem();
+
+  /**
+   * @note model must outlive the draw and be indexed with 32 bit indices,
+   * build it with Model::Builder::allowIndex16 off. Throws otherwise.
+   * @return id for setTransform/removeDraw
+   */
+  u32 addDraw(const Model& model,
+              const glm::mat4& transform,
+              const glm::vec4& color = glm::vec4{1.0f});
+  void setTransform(u32 draw, const glm::mat4& transform);
+  void removeDraw(u32 draw);
+
+  /** Records the culling dispatch, must be outside of a render pass */
+  void cull(vk::CommandBuffer commandBuffer,
+            FrameInfo frameInfo,
+            const glm::mat4& viewProjection);
+
+  /** Draws whatever the last cull() of this frame kept */
+  void render(vk::CommandBuffer commandBuffer, FrameInfo frameInfo);
+
+  u32 getDrawCount() const { return static_cast<u32>(this->records.size()); }
+
+ private:
+  void createLayouts();
+  void createBuffers();
+  void createPipeline(vk::RenderPass renderPass);
+  void createPipeline(vk::Format colorFormat, vk::Format depthFormat);
+  void uploadRecords(u32 frameIndex);
+
+  Device& device;
+  u32 maxDraws;
+
+  std::unique_ptr<DescriptorSetLayout> cullSetLayout;
+  std::unique_ptr<DescriptorSetLayout> drawSetLayout;
+  vk::PipelineLayout cullPipelineLayout;
+  vk::PipelineLayout drawPipelineLayout;
+
+  std::unique_ptr<ComputePipeline> cullPipeline;
+  Pipeline drawPipeline;
+
+  // One region per frame in flight, host written records and GPU written
+  // commands/count
+  std::unique_ptr<Buffer> recordBuffer;
+  std::unique_ptr<Buffer> indirectBuffer;
+  std::unique_ptr<Buffer> countBuffer;
+
+  std::vector<DrawRecord> records;
+  std::vector<u32> freeDraws;
+
+  // Bumped on every change, a frame's region is rewritten when it lags
+  u64 recordVersion = 1;
+  std::array<u64, Swapchain::MAX_FRAMES_IN_FLIGHT> frameVersions{};
+
+  glm::mat4 viewProjection{1.0f};
+};
+
+}  // namespace hep
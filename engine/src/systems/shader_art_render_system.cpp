@@ -1,12 +1,19 @@
 #include "shader_art_render_system.hpp"
 
+#include <optional>
+#include <stdexcept>
+
+#include "deletion_queue.hpp"
+#include "gpu_profiler.hpp"
+#include "layout_cache.hpp"
 #include "util/logger.hpp"
 
 namespace hep {
 
 ShaderArtRenderSystem::ShaderArtRenderSystem(Device& device,
-                                             vk::Extent2D extent)
-    : device{device}, extent{extent}, pipeline{device} {
+                                             vk::Extent2D extent,
+                                             BindlessTable* bindless)
+    : device{device}, extent{extent}, pipeline{device}, bindless{bindless} {
   this->frame = Frame::Builder(device)
                     .setImageExtent(extent)
                     .setImageFormat(vk::Format::eR8G8B8A8Unorm)
@@ -18,9 +25,14 @@ ShaderArtRenderSystem::ShaderArtRenderSystem(Device& device,
   createPipeline();
   createSampler();
 
-  createImGuiTexture();
   //  createDescriptorResources();
 
+  if (this->bindless) {
+    this->samplerBindlessIndex = this->bindless->registerSampler(this->sampler);
+    this->imageBindlessIndex =
+        this->bindless->registerImage(this->frame->getImageView());
+  }
+
   Model::Builder quadBuilder{};
   quadBuilder.vertices = {{{-1.0f, -1.0f}, {1, 0, 0}},
                           {{-1.0f, 1.0f}, {1, 0, 0}},
@@ -37,32 +49,30 @@ ShaderArtRenderSystem::ShaderArtRenderSystem(Device& device,
 }
 
 ShaderArtRenderSystem ::~ShaderArtRenderSystem() {
-  ImGui_ImplVulkan_RemoveTexture(this->imguiDescriptorSet);
-  log::trace("destroyed imgui texture");
+  if (this->bindless) {
+    this->bindless->releaseImage(this->imageBindlessIndex);
+    this->bindless->releaseSampler(this->samplerBindlessIndex);
+  }
+
+  if (this->imguiDescriptorSet) {
+    ImGui_ImplVulkan_RemoveTexture(this->imguiDescriptorSet);
+    log::trace("destroyed imgui texture");
+  }
 
   this->device.get()->destroySampler(sampler);
   log::trace("destroyed vk::Sampler");
-
-  this->device.get()->destroyPipelineLayout(this->pipelineLayout);
-  log::trace("destroyed vk::PipelineLayout");
 }
 
 void ShaderArtRenderSystem::render(vk::CommandBuffer commandBuffer,
                                    FrameInfo frameInfo) {
-  // begin render pass
-  vk::RenderPassBeginInfo beginInfo{};
-  beginInfo.renderPass = this->frame->getRenderPass();
-  beginInfo.framebuffer = this->frame->getFramebuffer();
-  beginInfo.renderArea.offset = vk::Offset2D{0, 0};
-  beginInfo.renderArea.extent = this->extent;
-
-  std::array<vk::ClearValue, 2> clearValues{};
-  clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
-  clearValues[1].depthStencil = vk::ClearDepthStencilValue{1.0f, 0};
-  beginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-  beginInfo.pClearValues = clearValues.data();
+  std::optional<GpuProfiler::Zone> zone;
+  if (frameInfo.profiler) {
+    zone.emplace(*frameInfo.profiler, commandBuffer, "shader art");
+  }
 
-  commandBuffer.beginRenderPass(&beginInfo, vk::SubpassContents::eInline);
+  // begin render pass
+  this->frame->beginRendering(commandBuffer,
+                              vk::ClearColorValue{0.01f, 0.01f, 0.01f, 1.0f});
 
   // Set graphics pipeline dynamic state
   vk::Viewport viewport{0.0f,
@@ -93,7 +103,57 @@ void ShaderArtRenderSystem::render(vk::CommandBuffer commandBuffer,
   quad->draw(commandBuffer);
 
   // end render pass
-  commandBuffer.endRenderPass();
+  this->frame->endRendering(commandBuffer);
+}
+
+void ShaderArtRenderSystem::createTargetPipeline(vk::RenderPass renderPass) {
+  if (!this->bindless) {
+    log::fatal("ShaderArtRenderSystem needs a BindlessTable for renderTarget");
+    throw std::runtime_error("renderTarget needs a BindlessTable");
+  }
+
+  this->targetPipeline = std::make_unique<Pipeline>(this->device);
+  this->targetPipeline->setVertexInput({}, {});
+  this->targetPipeline->create("shaders/fullscreen.vert.spv",
+                               "shaders/art_target.frag.spv",
+                               this->bindless->getPipelineLayout(), renderPass);
+}
+
+void ShaderArtRenderSystem::createTargetPipeline(vk::Format colorFormat,
+                                                 vk::Format depthFormat) {
+  if (!this->bindless) {
+    log::fatal("ShaderArtRenderSystem needs a BindlessTable for renderTarget");
+    throw std::runtime_error("renderTarget needs a BindlessTable");
+  }
+
+  this->targetPipeline = std::make_unique<Pipeline>(this->device);
+  this->targetPipeline->setVertexInput({}, {});
+  this->targetPipeline->create(
+      "shaders/fullscreen.vert.spv", "shaders/art_target.frag.spv",
+      this->bindless->getPipelineLayout(), colorFormat, depthFormat);
+}
+
+void ShaderArtRenderSystem::renderTarget(vk::CommandBuffer commandBuffer,
+                                         FrameInfo frameInfo) {
+  assert(this->targetPipeline != nullptr &&
+         "Cannot render target before createTargetPipeline");
+
+  std::optional<GpuProfiler::Zone> zone;
+  if (frameInfo.profiler) {
+    zone.emplace(*frameInfo.profiler, commandBuffer, "shader art target");
+  }
+
+  this->targetPipeline->bind(commandBuffer);
+  this->bindless->bind(commandBuffer);
+
+  TargetPushConstants push{this->imageBindlessIndex,
+                           this->samplerBindlessIndex};
+  commandBuffer.pushConstants(this->bindless->getPipelineLayout(),
+                              vk::ShaderStageFlagBits::eAll, 0,
+                              sizeof(TargetPushConstants), &push);
+
+  // fullscreen.vert builds one covering triangle from gl_VertexIndex
+  commandBuffer.draw(3, 1, 0, 0);
 }
 
 // vk::DescriptorSet ShaderArtRenderSystem::getImageDescriptorSet() {
@@ -112,25 +172,32 @@ void ShaderArtRenderSystem::render(vk::CommandBuffer commandBuffer,
 // }
 
 ImTextureID ShaderArtRenderSystem::getImageTextureID() {
+  if (!this->imguiDescriptorSet) { createImGuiTexture(); }
   return (ImTextureID)this->imguiDescriptorSet;
 }
 
-// void ShaderArtRenderSystem::onWindowResizeEvent(
-//     ShaderArtWindowResizeEvent& event) {
-//   this->extent = event.getExtent();
-//   // log::info("Window resize event callback: ", this->extent.width, "x",
-//   //           this->extent.height);
-//   // log::info("Recreating shader art viewport frame...");
-
-//   this->device.get()->waitIdle();  // NOTE: This is super slow
-
-//   ImGui_ImplVulkan_RemoveTexture(this->imguiDescriptorSet);
-//   // log::trace("destroyed imgui texture");
+void ShaderArtRenderSystem::resize(vk::Extent2D extent) {
+  if (extent == this->extent) { return; }
+  this->extent = extent;
+
+  // ImGui may still sample the old texture in a frame in flight, a new one
+  // is made the next time getImageTextureID is called
+  if (this->imguiDescriptorSet) {
+    VkDescriptorSet oldDescriptorSet = this->imguiDescriptorSet;
+    this->device.getDeletionQueue().push([oldDescriptorSet]() {
+      ImGui_ImplVulkan_RemoveTexture(oldDescriptorSet);
+    });
+    this->imguiDescriptorSet = VK_NULL_HANDLE;
+  }
 
-//   this->frame->resize(this->extent);
+  this->frame->resize(this->extent);
 
-//   createImGuiTexture();
-// }
+  if (this->bindless) {
+    this->bindless->releaseImage(this->imageBindlessIndex);
+    this->imageBindlessIndex =
+        this->bindless->registerImage(this->frame->getImageView());
+  }
+}
 
 void ShaderArtRenderSystem::createPipelineLayout() {
   vk::PushConstantRange pushConstantRange{};
@@ -140,19 +207,9 @@ void ShaderArtRenderSystem::createPipelineLayout() {
   pushConstantRange.offset = 0;
   pushConstantRange.size = sizeof(PushConstantData);
 
-  vk::PipelineLayoutCreateInfo pipelineLayoutInfo = {};
-  pipelineLayoutInfo.setLayoutCount = 0;
-  pipelineLayoutInfo.pushConstantRangeCount = 1;
-  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-
-  try {
-    this->pipelineLayout =
-        this->device.get()->createPipelineLayout(pipelineLayoutInfo);
-    log::trace("created vk::PipelineLayout");
-  } catch (const vk::SystemError& err) {
-    log::fatal("failed to create vk::PipelineLayout");
-    throw std::runtime_error("failed to create vk::PipelineLayout");
-  }
+  // Owned by the LayoutCache, shared with any system using the same ranges
+  this->pipelineLayout =
+      this->device.getLayoutCache().getPipelineLayout({}, {pushConstantRange});
 }
 
 void ShaderArtRenderSystem::createPipeline() {
@@ -162,6 +219,13 @@ void ShaderArtRenderSystem::createPipeline() {
   assert(this->frame != nullptr &&
          "Cannot create pipeline with no render pass");
 
+  if (this->device.isDynamicRenderingEnabled()) {
+    this->pipeline.create("shaders/quad.vert.spv", "shaders/art.frag.spv",
+                          this->pipelineLayout, this->frame->getImageFormat(),
+                          this->frame->getDepthFormat());
+    return;
+  }
+
   this->pipeline.create("shaders/quad.vert.spv", "shaders/art.frag.spv",
                         this->pipelineLayout, this->frame->getRenderPass());
 }
@@ -175,7 +239,8 @@ void ShaderArtRenderSystem::createSampler() {
   samplerInfo.addressModeW = vk::SamplerAddressMode::eRepeat;
   samplerInfo.borderColor = vk::BorderColor::eIntOpaqueBlack;
   samplerInfo.unnormalizedCoordinates = vk::False;
-  samplerInfo.compareEnable = vk::True;
+  // Color target, compare samplers are only valid for depth comparisons
+  samplerInfo.compareEnable = vk::False;
   samplerInfo.compareOp = vk::CompareOp::eAlways;
   samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
   samplerInfo.anisotropyEnable = vk::False;
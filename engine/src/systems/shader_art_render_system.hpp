@@ -7,6 +7,7 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include "descriptors/bindless_table.hpp"
 #include "descriptors/descriptor_pool.hpp"
 #include "descriptors/descriptor_set_layout.hpp"
 #include "descriptors/descriptor_writer.hpp"
@@ -35,15 +36,59 @@ class ShaderArtRenderSystem {
     glm::vec4 data;
   };
 
-  ShaderArtRenderSystem(Device& device, vk::Extent2D extent);
+  /** BindlessTable slots read by art_target.frag */
+  struct TargetPushConstants {
+    u32 image;
+    u32 sampler;
+  };
+
+  /**
+   * @param bindless when set the target image and sampler are registered
+   * there, see getImageBindlessIndex and renderTarget
+   */
+  ShaderArtRenderSystem(Device& device,
+                        vk::Extent2D extent,
+                        BindlessTable* bindless = nullptr);
   ~ShaderArtRenderSystem();
 
+  /** Renders the art into the target, must be outside of a render pass */
   void render(vk::CommandBuffer commandBuffer, FrameInfo frameInfo);
 
+  /**
+   * Pipeline for renderTarget in another pass, against its render pass or
+   * for dynamic rendering into the given formats. Needs the BindlessTable.
+   */
+  void createTargetPipeline(vk::RenderPass renderPass);
+  void createTargetPipeline(vk::Format colorFormat, vk::Format depthFormat);
+
+  /**
+   * Draws the target over the whole viewport of the current pass. It is
+   * sampled through the BindlessTable using the indices in the push
+   * constants, the table's set is the only descriptor set bound.
+   */
+  void renderTarget(vk::CommandBuffer commandBuffer, FrameInfo frameInfo);
+
   vk::DescriptorSet getImageDescriptorSet();
+
+  /**
+   * Registers the target with the ImGui Vulkan backend on first use, which
+   * binds its own set per texture and can't read from the BindlessTable
+   */
   ImTextureID getImageTextureID();
 
-  // void onWindowResizeEvent(ShaderArtWindowResizeEvent& event);
+  /**
+   * Slots of the target image and its sampler in the BindlessTable,
+   * BindlessTable::INVALID_INDEX without one. The image slot changes on
+   * resize.
+   */
+  u32 getImageBindlessIndex() const { return this->imageBindlessIndex; }
+  u32 getSamplerBindlessIndex() const { return this->samplerBindlessIndex; }
+
+  /**
+   * Recreates the target at extent without waiting for the GPU, the old
+   * target and ImGui texture are retired through the DeletionQueue
+   */
+  void resize(vk::Extent2D extent);
 
  private:
   void createPipelineLayout();
@@ -58,9 +103,14 @@ class ShaderArtRenderSystem {
 
   Pipeline pipeline;
   vk::PipelineLayout pipelineLayout;
+  std::unique_ptr<Pipeline> targetPipeline;
 
   vk::Sampler sampler;
-  VkDescriptorSet imguiDescriptorSet;
+  VkDescriptorSet imguiDescriptorSet = VK_NULL_HANDLE;
+
+  BindlessTable* bindless;
+  u32 imageBindlessIndex = BindlessTable::INVALID_INDEX;
+  u32 samplerBindlessIndex = BindlessTable::INVALID_INDEX;
 
   std::unique_ptr<Model> quad;
   PushConstantData pushConstant;
@@ -0,0 +1,429 @@
+#include "transfer_context.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "util/logger.hpp"
+
+namespace hep {
+
+UploadBatch& UploadBatch::copyBuffer(vk::Buffer source,
+                                     vk::Buffer destination,
+                                     const vk::BufferCopy& region,
+                                     vk::PipelineStageFlags dstStage,
+                                     vk::AccessFlags dstAccess) {
+  this->bufferCopies.push_back(
+      BufferCopy{source, destination, region, dstStage, dstAccess});
+  return *this;
+}
+
+UploadBatch& UploadBatch::uploadBuffer(std::unique_ptr<Buffer> staging,
+                                       vk::Buffer destination,
+                                       vk::DeviceSize size,
+                                       vk::PipelineStageFlags dstStage,
+                                       vk::AccessFlags dstAccess,
+                                       vk::DeviceSize dstOffset) {
+  vk::BufferCopy region{};
+  region.dstOffset = dstOffset;
+  region.size = size;
+
+  copyBuffer(staging->getBuffer(), destination, region, dstStage, dstAccess);
+  keepAlive(std::move(staging));
+  return *this;
+}
+
+UploadBatch& UploadBatch::copyBufferToImage(
+    vk::Buffer source,
+    vk::Image destination,
+    const vk::BufferImageCopy& region,
+    const vk::ImageSubresourceRange& range,
+    vk::ImageLayout finalLayout,
+    vk::PipelineStageFlags dstStage,
+    vk::AccessFlags dstAccess) {
+  this->imageCopies.push_back(ImageCopy{source, destination, region, range,
+                                        finalLayout, dstStage, dstAccess});
+  return *this;
+}
+
+TransferContext::TransferContext(Device& device)
+    : device{device}, stagingRing{device} {
+  QueueFamilyIndices indices = this->device.getQueueIndices();
+  this->graphicsFamily = indices.graphicsFamily.value();
+  this->transferFamily = indices.transferFamily.value_or(this->graphicsFamily);
+
+  createCommandPools();
+}
+
+TransferContext::~TransferContext() {
+  waitAll();
+
+  for (auto fence : this->freeFences) {
+    this->device.get()->destroyFence(fence);
+  }
+  for (auto semaphore : this->freeSemaphores) {
+    this->device.get()->destroySemaphore(semaphore);
+  }
+
+  this->device.get()->destroyCommandPool(this->transferCommandPool);
+  if (isCrossFamily()) {
+    this->device.get()->destroyCommandPool(this->acquireCommandPool);
+  }
+  log::trace("destroyed TransferContext");
+}
+
+UploadToken TransferContext::uploadBuffer(std::unique_ptr<Buffer> staging,
+                                          vk::Buffer dst,
+                                          vk::DeviceSize size,
+                                          vk::PipelineStageFlags dstStage,
+                                          vk::AccessFlags dstAccess) {
+  UploadBatch batch{};
+  batch.uploadBuffer(std::move(staging), dst, size, dstStage, dstAccess);
+  return submit(batch);
+}
+
+void TransferContext::stageBuffer(UploadBatch& batch,
+                                  const void* data,
+                                  vk::DeviceSize size,
+                                  vk::Buffer destination,
+                                  vk::PipelineStageFlags dstStage,
+                                  vk::AccessFlags dstAccess,
+                                  vk::DeviceSize dstOffset) {
+  const u8* bytes = static_cast<const u8*>(data);
+  vk::DeviceSize maxChunkSize =
+      this->stagingRing.getCapacity() / STAGING_CHUNKS_IN_RING;
+
+  while (size > 0) {
+    vk::DeviceSize chunkSize = std::min(size, maxChunkSize);
+
+    StagingAllocation staging{};
+    while (!this->stagingRing.tryAllocate(chunkSize, 1, staging)) {
+      waitForStagingSpace(batch);
+    }
+
+    std::memcpy(staging.data, bytes, chunkSize);
+
+    vk::BufferCopy region{};
+    region.srcOffset = staging.offset;
+    region.dstOffset = dstOffset;
+    region.size = chunkSize;
+
+    batch.copyBuffer(staging.buffer, destination, region, dstStage, dstAccess);
+    batch.stagingBlocks.push_back(staging.ringEnd);
+
+    bytes += chunkSize;
+    dstOffset += chunkSize;
+    size -= chunkSize;
+  }
+}
+
+UploadToken TransferContext::uploadData(const void* data,
+                                        vk::DeviceSize size,
+                                        vk::Buffer dst,
+                                        vk::PipelineStageFlags dstStage,
+                                        vk::AccessFlags dstAccess) {
+  UploadBatch batch{};
+  stageBuffer(batch, data, size, dst, dstStage, dstAccess);
+  return submit(batch);
+}
+
+bool TransferContext::isComplete(UploadToken token) {
+  if (token <= this->completedToken) { return true; }
+  collect();
+  return token <= this->completedToken;
+}
+
+void TransferContext::wait(UploadToken token) {
+  while (!this->inFlight.empty() && token > this->completedToken) {
+    Submission& oldest = this->inFlight.front();
+
+    vk::Result result = this->device.get()->waitForFences(
+        1, &oldest.fence, vk::True, std::numeric_limits<u64>::max());
+    if (result != vk::Result::eSuccess) {
+      log::error("failed to wait for upload fence: " + vk::to_string(result));
+    }
+
+    collect();
+  }
+}
+
+void TransferContext::waitAll() { wait(this->nextToken - 1); }
+
+void TransferContext::collect() {
+  while (!this->inFlight.empty()) {
+    Submission& oldest = this->inFlight.front();
+
+    if (this->device.get()->getFenceStatus(oldest.fence) !=
+        vk::Result::eSuccess) {
+      break;
+    }
+
+    this->completedToken = oldest.token;
+    retire(oldest);
+    this->inFlight.pop_front();
+  }
+
+  this->stagingRing.reclaim(this->completedToken);
+}
+
+UploadToken TransferContext::submit(UploadBatch& batch) {
+  collect();
+
+  if (batch.empty()) {
+    // Nothing to wait for, staging buffers can go right away
+    batch.stagingBuffers.clear();
+    return 0;
+  }
+
+  Submission submission{};
+  submission.token = this->nextToken++;
+  submission.fence = acquireFence();
+  submission.stagingBuffers = std::move(batch.stagingBuffers);
+
+  this->stagingRing.commit(submission.token, batch.stagingBlocks);
+  batch.stagingBlocks.clear();
+  submission.transferCommandBuffer =
+      allocateCommandBuffer(this->transferCommandPool);
+
+  vk::CommandBuffer transferCommandBuffer = submission.transferCommandBuffer;
+
+  vk::CommandBufferBeginInfo beginInfo{};
+  beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+  transferCommandBuffer.begin(beginInfo);
+
+  u32 srcFamily = isCrossFamily() ? this->transferFamily
+                                  : VK_QUEUE_FAMILY_IGNORED;
+  u32 dstFamily = isCrossFamily() ? this->graphicsFamily
+                                  : VK_QUEUE_FAMILY_IGNORED;
+
+  vk::PipelineStageFlags dstStages{};
+  std::vector<vk::BufferMemoryBarrier> releaseBarriers;
+  std::vector<vk::BufferMemoryBarrier> acquireBarriers;
+  std::vector<vk::ImageMemoryBarrier> imageReleaseBarriers;
+  std::vector<vk::ImageMemoryBarrier> imageAcquireBarriers;
+
+  if (!batch.imageCopies.empty()) {
+    std::vector<vk::ImageMemoryBarrier> toTransfer;
+    for (const auto& copy : batch.imageCopies) {
+      vk::ImageMemoryBarrier barrier{};
+      barrier.image = copy.destination;
+      barrier.subresourceRange = copy.range;
+      barrier.oldLayout = vk::ImageLayout::eUndefined;
+      barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+      barrier.srcAccessMask = {};
+      barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      toTransfer.push_back(barrier);
+    }
+
+    transferCommandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eTopOfPipe,
+        vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags{}, nullptr,
+        nullptr, toTransfer);
+  }
+
+  for (const auto& copy : batch.bufferCopies) {
+    transferCommandBuffer.copyBuffer(copy.source, copy.destination,
+                                     copy.region);
+
+    vk::BufferMemoryBarrier barrier{};
+    barrier.buffer = copy.destination;
+    barrier.offset = copy.region.dstOffset;
+    barrier.size = copy.region.size;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = copy.dstAccess;
+    barrier.srcQueueFamilyIndex = srcFamily;
+    barrier.dstQueueFamilyIndex = dstFamily;
+
+    if (isCrossFamily()) {
+      vk::BufferMemoryBarrier acquire = barrier;
+      acquire.srcAccessMask = {};
+      acquireBarriers.push_back(acquire);
+
+      barrier.dstAccessMask = {};
+    }
+
+    releaseBarriers.push_back(barrier);
+    dstStages |= copy.dstStage;
+  }
+
+  for (const auto& copy : batch.imageCopies) {
+    transferCommandBuffer.copyBufferToImage(
+        copy.source, copy.destination, vk::ImageLayout::eTransferDstOptimal,
+        copy.region);
+
+    // The layout transition is part of the release/acquire pair, both halves
+    // must specify the same old and new layout
+    vk::ImageMemoryBarrier barrier{};
+    barrier.image = copy.destination;
+    barrier.subresourceRange = copy.range;
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout = copy.finalLayout;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = copy.dstAccess;
+    barrier.srcQueueFamilyIndex = srcFamily;
+    barrier.dstQueueFamilyIndex = dstFamily;
+
+    if (isCrossFamily()) {
+      vk::ImageMemoryBarrier acquire = barrier;
+      acquire.srcAccessMask = {};
+      imageAcquireBarriers.push_back(acquire);
+
+      barrier.dstAccessMask = {};
+    }
+
+    imageReleaseBarriers.push_back(barrier);
+    dstStages |= copy.dstStage;
+  }
+
+  // Same family: a plain barrier makes the copies visible to every later
+  // submission on the queue. Cross family: this is the release half of the
+  // ownership transfer, the acquire half is recorded on the graphics queue.
+  transferCommandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eTransfer,
+      isCrossFamily() ? vk::PipelineStageFlagBits::eBottomOfPipe : dstStages,
+      vk::DependencyFlags{}, nullptr, releaseBarriers, imageReleaseBarriers);
+
+  transferCommandBuffer.end();
+
+  batch.bufferCopies.clear();
+  batch.imageCopies.clear();
+
+  vk::SubmitInfo transferSubmit{};
+  transferSubmit.commandBufferCount = 1;
+  transferSubmit.pCommandBuffers = &transferCommandBuffer;
+
+  try {
+    if (!isCrossFamily()) {
+      this->device.getGraphicsQueue().submit(transferSubmit, submission.fence);
+      this->inFlight.push_back(std::move(submission));
+      return this->inFlight.back().token;
+    }
+
+    submission.semaphore = acquireSemaphore();
+    transferSubmit.signalSemaphoreCount = 1;
+    transferSubmit.pSignalSemaphores = &submission.semaphore;
+    this->device.getTransferQueue().submit(transferSubmit, nullptr);
+
+    submission.acquireCommandBuffer =
+        allocateCommandBuffer(this->acquireCommandPool);
+    vk::CommandBuffer acquireCommandBuffer = submission.acquireCommandBuffer;
+
+    acquireCommandBuffer.begin(beginInfo);
+    // srcStage matches the semaphore wait stage so the two form a
+    // dependency chain with later graphics work
+    acquireCommandBuffer.pipelineBarrier(dstStages, dstStages,
+                                         vk::DependencyFlags{}, nullptr,
+                                         acquireBarriers, imageAcquireBarriers);
+    acquireCommandBuffer.end();
+
+    vk::SubmitInfo acquireSubmit{};
+    acquireSubmit.waitSemaphoreCount = 1;
+    acquireSubmit.pWaitSemaphores = &submission.semaphore;
+    acquireSubmit.pWaitDstStageMask = &dstStages;
+    acquireSubmit.commandBufferCount = 1;
+    acquireSubmit.pCommandBuffers = &acquireCommandBuffer;
+
+    this->device.getGraphicsQueue().submit(acquireSubmit, submission.fence);
+  } catch (const vk::SystemError& error) {
+    log::fatal("failed to submit upload. Error: ", error.what());
+    throw std::runtime_error("failed to submit upload");
+  }
+
+  this->inFlight.push_back(std::move(submission));
+  return this->inFlight.back().token;
+}
+
+void TransferContext::createCommandPools() {
+  vk::CommandPoolCreateInfo createInfo{};
+  createInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+  createInfo.queueFamilyIndex = this->transferFamily;
+
+  try {
+    this->transferCommandPool =
+        this->device.get()->createCommandPool(createInfo);
+
+    if (isCrossFamily()) {
+      createInfo.queueFamilyIndex = this->graphicsFamily;
+      this->acquireCommandPool =
+          this->device.get()->createCommandPool(createInfo);
+    }
+  } catch (const vk::SystemError& error) {
+    log::fatal("failed to create transfer vk::CommandPool");
+    throw std::runtime_error("failed to create transfer vk::CommandPool");
+  }
+}
+
+vk::CommandBuffer TransferContext::allocateCommandBuffer(vk::CommandPool pool) {
+  vk::CommandBufferAllocateInfo allocInfo{};
+  allocInfo.level = vk::CommandBufferLevel::ePrimary;
+  allocInfo.commandPool = pool;
+  allocInfo.commandBufferCount = 1;
+
+  try {
+    return this->device.get()->allocateCommandBuffers(allocInfo).front();
+  } catch (const vk::SystemError& error) {
+    log::fatal("failed to allocate transfer command buffer");
+    throw std::runtime_error("failed to allocate transfer command buffer");
+  }
+}
+
+vk::Fence TransferContext::acquireFence() {
+  if (this->freeFences.empty()) {
+    return this->device.get()->createFence({});
+  }
+
+  vk::Fence fence = this->freeFences.back();
+  this->freeFences.pop_back();
+  return fence;
+}
+
+vk::Semaphore TransferContext::acquireSemaphore() {
+  if (this->freeSemaphores.empty()) {
+    return this->device.get()->createSemaphore({});
+  }
+
+  vk::Semaphore semaphore = this->freeSemaphores.back();
+  this->freeSemaphores.pop_back();
+  return semaphore;
+}
+
+void TransferContext::retire(Submission& submission) {
+  this->device.get()->freeCommandBuffers(this->transferCommandPool,
+                                         submission.transferCommandBuffer);
+
+  if (submission.acquireCommandBuffer) {
+    this->device.get()->freeCommandBuffers(this->acquireCommandPool,
+                                           submission.acquireCommandBuffer);
+  }
+
+  if (submission.semaphore) {
+    this->freeSemaphores.push_back(submission.semaphore);
+  }
+
+  vk::Result result = this->device.get()->resetFences(1, &submission.fence);
+  if (result != vk::Result::eSuccess) {
+    log::error("failed to reset upload fence: " + vk::to_string(result));
+  }
+  this->freeFences.push_back(submission.fence);
+
+  submission.stagingBuffers.clear();
+}
+
+void TransferContext::waitForStagingSpace(UploadBatch& batch) {
+  // The chunks this batch already staged may be what fills the ring, they
+  // can only be reclaimed once submitted
+  if (!batch.stagingBlocks.empty()) { submit(batch); }
+
+  if (this->inFlight.empty()) {
+    log::fatal("staging ring is held by upload batches that were never "
+               "submitted");
+    throw std::runtime_error("staging ring exhausted");
+  }
+
+  wait(this->inFlight.front().token);
+}
+
+}  // namespace hep
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cassert>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "buffer.hpp"
+#include "device.hpp"
+#include "memory/staging_ring.hpp"
+#include "types.hpp"
+
+namespace hep {
+
+/**
+ * Identifies a submission made through TransferContext. Tokens increase
+ * monotonically, 0 is never handed out and always counts as complete.
+ */
+using UploadToken = u64;
+
+/**
+ * Collects buffer and image copies so they can be recorded into a single
+ * command buffer and submitted once through TransferContext::submit
+ *
+ * dstStage/dstAccess describe how the graphics queue will first use each
+ * destination.
+ *
+ * @note a batch filled through TransferContext::stageBuffer holds staging
+ * ring space and must be submitted
+ */
+class UploadBatch {
+ public:
+  UploadBatch(const UploadBatch&) = delete;
+  UploadBatch& operator=(const UploadBatch&) = delete;
+
+  UploadBatch() = default;
+  UploadBatch(UploadBatch&&) = default;
+  UploadBatch& operator=(UploadBatch&&) = default;
+
+  ~UploadBatch() {
+    assert(this->stagingBlocks.empty() &&
+           "UploadBatch holding staging ring space was never submitted");
+  }
+
+  UploadBatch& copyBuffer(vk::Buffer source,
+                          vk::Buffer destination,
+                          const vk::BufferCopy& region,
+                          vk::PipelineStageFlags dstStage,
+                          vk::AccessFlags dstAccess);
+
+  /**
+   * Copies size bytes from staging into destination, the batch keeps
+   * staging alive until the submission completes
+   */
+  UploadBatch& uploadBuffer(std::unique_ptr<Buffer> staging,
+                            vk::Buffer destination,
+                            vk::DeviceSize size,
+                            vk::PipelineStageFlags dstStage,
+                            vk::AccessFlags dstAccess,
+                            vk::DeviceSize dstOffset = 0);
+
+  /**
+   * Transitions the whole subresourceRange of destination from undefined to
+   * finalLayout around the copy
+   */
+  UploadBatch& copyBufferToImage(vk::Buffer source,
+                                 vk::Image destination,
+                                 const vk::BufferImageCopy& region,
+                                 const vk::ImageSubresourceRange& range,
+                                 vk::ImageLayout finalLayout,
+                                 vk::PipelineStageFlags dstStage,
+                                 vk::AccessFlags dstAccess);
+
+  void keepAlive(std::unique_ptr<Buffer> staging) {
+    this->stagingBuffers.push_back(std::move(staging));
+  }
+
+  bool empty() const {
+    return this->bufferCopies.empty() && this->imageCopies.empty();
+  }
+
+ private:
+  struct BufferCopy {
+    vk::Buffer source;
+    vk::Buffer destination;
+    vk::BufferCopy region;
+    vk::PipelineStageFlags dstStage;
+    vk::AccessFlags dstAccess;
+  };
+
+  struct ImageCopy {
+    vk::Buffer source;
+    vk::Image destination;
+    vk::BufferImageCopy region;
+    vk::ImageSubresourceRange range;
+    vk::ImageLayout finalLayout;
+    vk::PipelineStageFlags dstStage;
+    vk::AccessFlags dstAccess;
+  };
+
+  std::vector<BufferCopy> bufferCopies;
+  std::vector<ImageCopy> imageCopies;
+  std::vector<std::unique_ptr<Buffer>> stagingBuffers;
+  // StagingAllocation::ringEnd of every chunk staged into this batch
+  std::vector<vk::DeviceSize> stagingBlocks;
+
+  friend class TransferContext;
+};
+
+/**
+ * Records uploads on the transfer queue and hands back an UploadToken
+ * instead of blocking on the GPU
+ *
+ * When the device exposes a dedicated transfer family the copy runs there,
+ * ownership of the destination is released to the graphics family and a
+ * small acquire submission on the graphics queue waits on a semaphore
+ * before taking it back. Either way the destination is visible to
+ * everything submitted to the graphics queue afterwards, so callers only
+ * need the token to know when the staging memory can be reused.
+ *
+ * Host data is staged through one persistently mapped StagingRing whose
+ * space is reclaimed as submissions complete, uploads larger than a chunk
+ * of the ring are split and, when the ring fills up, flushed across several
+ * submissions.
+ *
+ * @note not thread safe, submits to the graphics queue
+ */
+class TransferContext {
+ public:
+  TransferContext(const TransferContext&) = delete;
+  TransferContext& operator=(const TransferContext&) = delete;
+
+  /** Uploads are split into chunks of at most a quarter of the ring */
+  static constexpr vk::DeviceSize STAGING_CHUNKS_IN_RING = 4;
+
+  TransferContext(Device& device);
+  ~TransferContext();
+
+  /**
+   * Copies size bytes of data into the staging ring and records the copy
+   * into destination on batch. If the ring is full, the chunks staged so
+   * far are submitted and the call blocks until enough earlier uploads have
+   * completed, so the last token handed out for batch covers all of it.
+   */
+  void stageBuffer(UploadBatch& batch,
+                   const void* data,
+                   vk::DeviceSize size,
+                   vk::Buffer destination,
+                   vk::PipelineStageFlags dstStage,
+                   vk::AccessFlags dstAccess,
+                   vk::DeviceSize dstOffset = 0);
+
+  /**
+   * Shorthand for submitting a batch holding a single stageBuffer
+   */
+  UploadToken uploadData(const void* data,
+                         vk::DeviceSize size,
+                         vk::Buffer dst,
+                         vk::PipelineStageFlags dstStage,
+                         vk::AccessFlags dstAccess);
+
+  /**
+   * Records every copy in batch into one command buffer and submits it.
+   * Never waits, pass the token to wait() if the result is needed on the
+   * host.
+   */
+  UploadToken submit(UploadBatch& batch);
+
+  /**
+   * Shorthand for submitting a batch holding a single uploadBuffer
+   */
+  UploadToken uploadBuffer(std::unique_ptr<Buffer> staging,
+                           vk::Buffer dst,
+                           vk::DeviceSize size,
+                           vk::PipelineStageFlags dstStage,
+                           vk::AccessFlags dstAccess);
+
+  bool isComplete(UploadToken token);
+  void wait(UploadToken token);
+  void waitAll();
+
+  /**
+   * Retires finished submissions, releasing their staging buffers, ring
+   * space and command buffers. Called once per frame by the Renderer.
+   */
+  void collect();
+
+ private:
+  struct Submission {
+    UploadToken token;
+    vk::CommandBuffer transferCommandBuffer;
+    vk::CommandBuffer acquireCommandBuffer;
+    vk::Semaphore semaphore;
+    vk::Fence fence;
+    std::vector<std::unique_ptr<Buffer>> stagingBuffers;
+  };
+
+  void createCommandPools();
+  vk::CommandBuffer allocateCommandBuffer(vk::CommandPool pool);
+  vk::Fence acquireFence();
+  vk::Semaphore acquireSemaphore();
+  void retire(Submission& submission);
+  void waitForStagingSpace(UploadBatch& batch);
+
+  bool isCrossFamily() const {
+    return this->transferFamily != this->graphicsFamily;
+  }
+
+  Device& device;
+  StagingRing stagingRing;
+
+  u32 graphicsFamily;
+  u32 transferFamily;
+
+  vk::CommandPool transferCommandPool;
+  vk::CommandPool acquireCommandPool;
+
+  std::deque<Submission> inFlight;
+  std::vector<vk::Fence> freeFences;
+  std::vector<vk::Semaphore> freeSemaphores;
+
+  UploadToken nextToken = 1;
+  UploadToken completedToken = 0;
+};
+
+}  // namespace hep
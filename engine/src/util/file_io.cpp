@@ -0,0 +1,86 @@
+#include "util/file_io.hpp"
+
+#include <fstream>
+#include <system_error>
+
+#include "util/logger.hpp"
+
+namespace hep {
+
+bool readBinaryFile(const std::filesystem::path& path, std::vector<u8>& data) {
+  std::ifstream file(path, std::ios::ate | std::ios::binary);
+  if (!file.is_open()) { return false; }
+
+  std::streamoff fileSize = file.tellg();
+  if (fileSize < 0) { return false; }
+
+  data.resize(static_cast<size_t>(fileSize));
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(data.data()), fileSize);
+
+  return static_cast<bool>(file);
+}
+
+bool readSpirvFile(const std::filesystem::path& path, std::vector<u32>& code) {
+  std::ifstream file(path, std::ios::ate | std::ios::binary);
+  if (!file.is_open()) { return false; }
+
+  std::streamoff fileSize = file.tellg();
+  if (fileSize <= 0 || fileSize % sizeof(u32) != 0) { return false; }
+
+  code.resize(static_cast<size_t>(fileSize) / sizeof(u32));
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(code.data()), fileSize);
+
+  return static_cast<bool>(file);
+}
+
+bool writeBinaryFileAtomic(const std::filesystem::path& path,
+                           const void* data,
+                           size_t size) {
+  std::error_code error;
+
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path(), error);
+    if (error) {
+      log::error("failed to create directory: " +
+                 path.parent_path().string() + " (" + error.message() + ")");
+      return false;
+    }
+  }
+
+  std::filesystem::path tempPath = path;
+  tempPath += ".tmp";
+
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      log::error("failed to open for writing: " + tempPath.string());
+      return false;
+    }
+
+    file.write(static_cast<const char*>(data),
+               static_cast<std::streamsize>(size));
+    file.flush();
+
+    if (!file) {
+      log::error("failed to write: " + tempPath.string());
+      file.close();
+      std::filesystem::remove(tempPath, error);
+      return false;
+    }
+  }
+
+  // rename replaces the destination in a single step on POSIX and Windows
+  std::filesystem::rename(tempPath, path, error);
+  if (error) {
+    log::error("failed to replace " + path.string() + " (" + error.message() +
+               ")");
+    std::filesystem::remove(tempPath, error);
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace hep
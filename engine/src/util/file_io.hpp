@@ -0,0 +1,37 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+#include "types.hpp"
+
+namespace hep {
+
+/**
+ * Reads the whole file into data
+ *
+ * @return false if the file could not be opened or read
+ */
+bool readBinaryFile(const std::filesystem::path& path, std::vector<u8>& data);
+
+/**
+ * Reads a SPIR-V binary as the u32 words vk::ShaderModuleCreateInfo takes,
+ * the vector keeps them aligned
+ *
+ * @return false if the file could not be read or isn't a whole number of
+ * words
+ */
+bool readSpirvFile(const std::filesystem::path& path, std::vector<u32>& code);
+
+/**
+ * Writes to a temporary file next to path and renames it over path, so
+ * readers never observe a partially written file. Missing parent
+ * directories are created.
+ *
+ * @return false if any step failed, path is left untouched in that case
+ */
+bool writeBinaryFileAtomic(const std::filesystem::path& path,
+                           const void* data,
+                           size_t size);
+
+}  // namespace hep
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "types.hpp"
+
+namespace hep {
+
+constexpr u64 FNV1A_OFFSET_BASIS = 0xcbf29ce484222325ull;
+constexpr u64 FNV1A_PRIME = 0x100000001b3ull;
+
+/**
+ * 64 bit FNV-1a, cheap and good enough for cache keys and checksums
+ *
+ * @note not cryptographic
+ */
+inline u64 fnv1a(const void* data,
+                 size_t size,
+                 u64 seed = FNV1A_OFFSET_BASIS) {
+  const u8* bytes = static_cast<const u8*>(data);
+
+  u64 hash = seed;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= FNV1A_PRIME;
+  }
+
+  return hash;
+}
+
+inline void hashCombine(u64& seed, u64 value) {
+  seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+template <typename T>
+void hashCombine(u64& seed, const T& value) {
+  hashCombine(seed, static_cast<u64>(std::hash<T>{}(value)));
+}
+
+/**
+ * Flat hash map key built from integer fields, for caches keyed by the
+ * contents of Vulkan create infos. Fields are compared word for word.
+ *
+ * Keys are built for every lookup, up to INLINE_WORDS fields live in the
+ * key itself so a lookup doesn't allocate. Longer keys move to the heap.
+ */
+class HashKey {
+ public:
+  static constexpr size_t INLINE_WORDS = 32;
+
+  void add(u64 word) {
+    if (this->size < INLINE_WORDS) {
+      this->inlineWords[this->size++] = word;
+      return;
+    }
+
+    if (this->heapWords.empty()) {
+      this->heapWords.assign(this->inlineWords.begin(),
+                             this->inlineWords.end());
+    }
+    this->heapWords.push_back(word);
+    this->size++;
+  }
+
+  const u64* data() const {
+    return this->heapWords.empty() ? this->inlineWords.data()
+                                   : this->heapWords.data();
+  }
+  size_t getSize() const { return this->size; }
+
+  bool operator==(const HashKey& other) const {
+    return this->size == other.size &&
+           std::memcmp(data(), other.data(), this->size * sizeof(u64)) == 0;
+  }
+
+ private:
+  std::array<u64, INLINE_WORDS> inlineWords{};
+  std::vector<u64> heapWords;
+  size_t size = 0;
+};
+
+struct HashKeyHasher {
+  size_t operator()(const HashKey& key) const {
+    return static_cast<size_t>(
+        fnv1a(key.data(), key.getSize() * sizeof(u64)));
+  }
+};
+
+/**
+ * Raw value of a vulkan.hpp handle as an integer, the same for every wrapper
+ * of the same object on both 32 and 64 bit builds
+ */
+template <typename Handle>
+u64 handleKey(Handle handle) {
+  auto raw = static_cast<typename Handle::CType>(handle);
+
+  u64 key = 0;
+  std::memcpy(&key, &raw, sizeof(raw));
+  return key;
+}
+
+}  // namespace hep
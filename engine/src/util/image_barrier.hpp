@@ -0,0 +1,46 @@
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+namespace hep {
+
+inline vk::ImageAspectFlags getDepthAspectMask(vk::Format depthFormat) {
+  switch (depthFormat) {
+    case vk::Format::eD16UnormS8Uint:
+    case vk::Format::eD24UnormS8Uint:
+    case vk::Format::eD32SfloatS8Uint:
+      return vk::ImageAspectFlagBits::eDepth |
+             vk::ImageAspectFlagBits::eStencil;
+    default:
+      return vk::ImageAspectFlagBits::eDepth;
+  }
+}
+
+/**
+ * Records a single image layout transition covering the first mip level
+ * and array layer
+ */
+inline void transitionImageLayout(vk::CommandBuffer commandBuffer,
+                                  vk::Image image,
+                                  vk::ImageAspectFlags aspectMask,
+                                  vk::ImageLayout oldLayout,
+                                  vk::ImageLayout newLayout,
+                                  vk::PipelineStageFlags srcStage,
+                                  vk::AccessFlags srcAccess,
+                                  vk::PipelineStageFlags dstStage,
+                                  vk::AccessFlags dstAccess) {
+  vk::ImageMemoryBarrier barrier{};
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstAccessMask = dstAccess;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange = {aspectMask, 0, 1, 0, 1};
+
+  commandBuffer.pipelineBarrier(srcStage, dstStage, vk::DependencyFlags{},
+                                nullptr, nullptr, barrier);
+}
+
+}  // namespace hep
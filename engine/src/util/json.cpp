@@ -0,0 +1,291 @@
+#include "util/json.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace hep {
+
+static const JsonValue NULL_VALUE{};
+
+// Nesting deeper than this is rejected instead of overflowing the stack
+static constexpr u32 MAX_DEPTH = 128;
+
+class JsonParser {
+ public:
+  explicit JsonParser(std::string_view text) : text{text} {}
+
+  bool parseDocument(JsonValue& value) {
+    if (!parseValue(value, 0)) { return false; }
+    skipWhitespace();
+    return this->position == this->text.size();
+  }
+
+ private:
+  void skipWhitespace() {
+    while (this->position < this->text.size()) {
+      char c = this->text[this->position];
+      if (c != ' ' && c != '\t' && c != '\n' && c != '\r') { break; }
+      this->position++;
+    }
+  }
+
+  bool consume(char expected) {
+    skipWhitespace();
+    if (this->position < this->text.size() &&
+        this->text[this->position] == expected) {
+      this->position++;
+      return true;
+    }
+    return false;
+  }
+
+  bool consumeLiteral(std::string_view literal) {
+    if (this->text.substr(this->position, literal.size()) != literal) {
+      return false;
+    }
+    this->position += literal.size();
+    return true;
+  }
+
+  bool parseValue(JsonValue& value, u32 depth) {
+    if (depth > MAX_DEPTH) { return false; }
+
+    skipWhitespace();
+    if (this->position >= this->text.size()) { return false; }
+
+    switch (this->text[this->position]) {
+      case '{':
+        return parseObject(value, depth);
+      case '[':
+        return parseArray(value, depth);
+      case '"':
+        value.type = JsonValue::Type::eString;
+        return parseString(value.string);
+      case 't':
+        value.type = JsonValue::Type::eBool;
+        value.boolean = true;
+        return consumeLiteral("true");
+      case 'f':
+        value.type = JsonValue::Type::eBool;
+        value.boolean = false;
+        return consumeLiteral("false");
+      case 'n':
+        return consumeLiteral("null");
+      default:
+        value.type = JsonValue::Type::eNumber;
+        return parseNumber(value.number);
+    }
+  }
+
+  bool parseObject(JsonValue& value, u32 depth) {
+    value.type = JsonValue::Type::eObject;
+    this->position++;
+
+    if (consume('}')) { return true; }
+
+    do {
+      skipWhitespace();
+      std::string key;
+      if (!parseString(key) || !consume(':')) { return false; }
+
+      value.members.emplace_back(std::move(key), JsonValue{});
+      if (!parseValue(value.members.back().second, depth + 1)) {
+        return false;
+      }
+    } while (consume(','));
+
+    return consume('}');
+  }
+
+  bool parseArray(JsonValue& value, u32 depth) {
+    value.type = JsonValue::Type::eArray;
+    this->position++;
+
+    if (consume(']')) { return true; }
+
+    do {
+      value.elements.emplace_back();
+      if (!parseValue(value.elements.back(), depth + 1)) { return false; }
+    } while (consume(','));
+
+    return consume(']');
+  }
+
+  bool parseNumber(f64& number) {
+    // strtod accepts more than JSON does (hex, inf, nan), check the charset
+    // first so those are rejected
+    size_t start = this->position;
+    while (this->position < this->text.size()) {
+      char c = this->text[this->position];
+      bool numberChar = (c >= '0' && c <= '9') || c == '-' || c == '+' ||
+                        c == '.' || c == 'e' || c == 'E';
+      if (!numberChar) { break; }
+      this->position++;
+    }
+    if (start == this->position) { return false; }
+
+    std::string digits(this->text.substr(start, this->position - start));
+    char* end = nullptr;
+    number = std::strtod(digits.c_str(), &end);
+
+    return end == digits.c_str() + digits.size() && std::isfinite(number);
+  }
+
+  static void appendUtf8(std::string& out, u32 codePoint) {
+    if (codePoint < 0x80) {
+      out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+      out += static_cast<char>(0xc0 | (codePoint >> 6));
+      out += static_cast<char>(0x80 | (codePoint & 0x3f));
+    } else if (codePoint < 0x10000) {
+      out += static_cast<char>(0xe0 | (codePoint >> 12));
+      out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+      out += static_cast<char>(0x80 | (codePoint & 0x3f));
+    } else {
+      out += static_cast<char>(0xf0 | (codePoint >> 18));
+      out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f));
+      out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f));
+      out += static_cast<char>(0x80 | (codePoint & 0x3f));
+    }
+  }
+
+  bool parseHex4(u32& value) {
+    if (this->position + 4 > this->text.size()) { return false; }
+
+    value = 0;
+    for (u32 i = 0; i < 4; i++) {
+      char c = this->text[this->position++];
+      value <<= 4;
+      if (c >= '0' && c <= '9') {
+        value |= static_cast<u32>(c - '0');
+      } else if (c >= 'a' && c <= 'f') {
+        value |= static_cast<u32>(c - 'a' + 10);
+      } else if (c >= 'A' && c <= 'F') {
+        value |= static_cast<u32>(c - 'A' + 10);
+      } else {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool parseString(std::string& out) {
+    if (this->position >= this->text.size() ||
+        this->text[this->position] != '"') {
+      return false;
+    }
+    this->position++;
+
+    while (this->position < this->text.size()) {
+      char c = this->text[this->position++];
+      if (c == '"') { return true; }
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+
+      if (this->position >= this->text.size()) { return false; }
+      char escaped = this->text[this->position++];
+      switch (escaped) {
+        case '"':
+        case '\\':
+        case '/':
+          out += escaped;
+          break;
+        case 'b':
+          out += '\b';
+          break;
+        case 'f':
+          out += '\f';
+          break;
+        case 'n':
+          out += '\n';
+          break;
+        case 'r':
+          out += '\r';
+          break;
+        case 't':
+          out += '\t';
+          break;
+        case 'u': {
+          u32 codePoint = 0;
+          if (!parseHex4(codePoint)) { return false; }
+
+          // Characters outside the BMP come as a surrogate pair
+          if (codePoint >= 0xd800 && codePoint < 0xdc00) {
+            u32 low = 0;
+            if (!consumeLiteral("\\u") || !parseHex4(low) || low < 0xdc00 ||
+                low >= 0xe000) {
+              return false;
+            }
+            codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+          }
+          appendUtf8(out, codePoint);
+          break;
+        }
+        default:
+          return false;
+      }
+    }
+
+    return false;
+  }
+
+  std::string_view text;
+  size_t position = 0;
+};
+
+bool JsonValue::parse(std::string_view text, JsonValue& value) {
+  value = JsonValue{};
+
+  JsonParser parser{text};
+  if (!parser.parseDocument(value)) {
+    value = JsonValue{};
+    return false;
+  }
+  return true;
+}
+
+bool JsonValue::asBool(bool fallback) const {
+  return this->type == Type::eBool ? this->boolean : fallback;
+}
+
+f64 JsonValue::asNumber(f64 fallback) const {
+  return this->type == Type::eNumber ? this->number : fallback;
+}
+
+u32 JsonValue::asU32(u32 fallback) const {
+  if (this->type != Type::eNumber || this->number < 0.0 ||
+      this->number > static_cast<f64>(~0u)) {
+    return fallback;
+  }
+  return static_cast<u32>(this->number);
+}
+
+size_t JsonValue::size() const {
+  if (this->type == Type::eArray) { return this->elements.size(); }
+  if (this->type == Type::eObject) { return this->members.size(); }
+  return 0;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const {
+  if (this->type != Type::eArray || index >= this->elements.size()) {
+    return NULL_VALUE;
+  }
+  return this->elements[index];
+}
+
+const JsonValue& JsonValue::operator[](std::string_view key) const {
+  if (this->type != Type::eObject) { return NULL_VALUE; }
+
+  for (const auto& [name, member] : this->members) {
+    if (name == key) { return member; }
+  }
+  return NULL_VALUE;
+}
+
+bool JsonValue::contains(std::string_view key) const {
+  return !(*this)[key].isNull();
+}
+
+}  // namespace hep
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "types.hpp"
+
+namespace hep {
+
+/**
+ * Minimal read only JSON document, enough for asset headers such as the
+ * glTF JSON chunk
+ *
+ * Lookups never fail: a missing key, an out of range index or a type
+ * mismatch yields a null value, and the as* accessors return their
+ * fallback, so deep lookups don't need a check at every level.
+ */
+class JsonValue {
+ public:
+  enum class Type : u8 { eNull, eBool, eNumber, eString, eArray, eObject };
+
+  /** @return false on malformed input, value is left null in that case */
+  static bool parse(std::string_view text, JsonValue& value);
+
+  Type getType() const { return this->type; }
+  bool isNull() const { return this->type == Type::eNull; }
+  bool isNumber() const { return this->type == Type::eNumber; }
+  bool isString() const { return this->type == Type::eString; }
+  bool isArray() const { return this->type == Type::eArray; }
+  bool isObject() const { return this->type == Type::eObject; }
+
+  bool asBool(bool fallback = false) const;
+  f64 asNumber(f64 fallback = 0.0) const;
+  u32 asU32(u32 fallback = 0) const;
+  const std::string& asString() const { return this->string; }
+
+  /** Element count of an array or member count of an object */
+  size_t size() const;
+
+  const JsonValue& operator[](size_t index) const;
+  const JsonValue& operator[](std::string_view key) const;
+  bool contains(std::string_view key) const;
+
+ private:
+  friend class JsonParser;
+
+  Type type = Type::eNull;
+  bool boolean = false;
+  f64 number = 0.0;
+  std::string string;
+  std::vector<JsonValue> elements;
+  std::vector<std::pair<std::string, JsonValue>> members;
+};
+
+}  // namespace hep
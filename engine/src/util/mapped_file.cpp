@@ -0,0 +1,104 @@
+#include "util/mapped_file.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace hep {
+
+MappedFile::~MappedFile() {
+  close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::filesystem::path& path) {
+  close();
+
+  HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING,
+                            FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) { return false; }
+
+  LARGE_INTEGER fileSize{};
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  // The view keeps the mapping alive, the mapping keeps the file alive
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) { return false; }
+
+  void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == nullptr) {
+    CloseHandle(mapping);
+    return false;
+  }
+
+  this->mapping = mapping;
+  this->data = static_cast<const u8*>(view);
+  this->size = static_cast<size_t>(fileSize.QuadPart);
+  return true;
+}
+
+void MappedFile::close() {
+  if (this->data != nullptr) { UnmapViewOfFile(this->data); }
+  if (this->mapping != nullptr) { CloseHandle(this->mapping); }
+
+  this->data = nullptr;
+  this->size = 0;
+  this->mapping = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::filesystem::path& path) {
+  close();
+
+  int file = ::open(path.c_str(), O_RDONLY);
+  if (file < 0) { return false; }
+
+  struct stat status {};
+  if (fstat(file, &status) != 0 || status.st_size <= 0) {
+    ::close(file);
+    return false;
+  }
+
+  size_t fileSize = static_cast<size_t>(status.st_size);
+  void* view = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+  // The mapping holds its own reference to the file
+  ::close(file);
+  if (view == MAP_FAILED) { return false; }
+
+  // Readers go front to back, let the kernel read ahead aggressively.
+  // Advice values aren't flags, each needs its own call.
+  madvise(view, fileSize, MADV_SEQUENTIAL);
+  madvise(view, fileSize, MADV_WILLNEED);
+
+  this->data = static_cast<const u8*>(view);
+  this->size = fileSize;
+  return true;
+}
+
+void MappedFile::close() {
+  if (this->data != nullptr) {
+    munmap(const_cast<u8*>(this->data), this->size);
+  }
+
+  this->data = nullptr;
+  this->size = 0;
+}
+
+#endif
+
+}  // namespace hep
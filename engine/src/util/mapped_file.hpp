@@ -0,0 +1,45 @@
+#pragma once
+
+#include <filesystem>
+
+#include "types.hpp"
+
+namespace hep {
+
+/**
+ * Read only memory mapping of a whole file
+ *
+ * Pages are faulted in by the OS on first access, so copying straight out
+ * of the mapping reads the file once with no intermediate buffer.
+ */
+class MappedFile {
+ public:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile() = default;
+  ~MappedFile();
+
+  /**
+   * Maps path, closing any previous mapping first
+   *
+   * @return false if the file could not be opened or mapped, empty files
+   * can't be mapped either
+   */
+  bool open(const std::filesystem::path& path);
+  void close();
+
+  bool isOpen() const { return this->data != nullptr; }
+  const u8* getData() const { return this->data; }
+  size_t getSize() const { return this->size; }
+
+ private:
+  const u8* data = nullptr;
+  size_t size = 0;
+
+#ifdef _WIN32
+  void* mapping = nullptr;
+#endif
+};
+
+}  // namespace hep
@@ -0,0 +1,83 @@
+#include "util/thread_pool.hpp"
+
+#include <algorithm>
+
+namespace hep {
+
+ThreadPool::ThreadPool(u32 threadCount) {
+  threadCount = std::max(threadCount, 1u);
+
+  this->threads.reserve(threadCount);
+  for (u32 i = 0; i < threadCount; i++) {
+    this->threads.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+  this->taskAvailable.notify_all();
+
+  for (auto& thread : this->threads) { thread.join(); }
+}
+
+void ThreadPool::enqueue(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->tasks.push(std::move(task));
+    this->pendingTasks++;
+  }
+  this->taskAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->tasksFinished.wait(lock, [this] { return this->pendingTasks == 0; });
+
+  if (this->firstError) {
+    std::exception_ptr error = this->firstError;
+    this->firstError = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+u32 ThreadPool::defaultThreadCount() {
+  u32 hardwareThreads = std::thread::hardware_concurrency();
+  return hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+}
+
+void ThreadPool::workerLoop(u32 threadIndex) {
+  while (true) {
+    Task task;
+
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->taskAvailable.wait(
+          lock, [this] { return this->stopping || !this->tasks.empty(); });
+
+      if (this->tasks.empty()) { return; }
+
+      task = std::move(this->tasks.front());
+      this->tasks.pop();
+    }
+
+    std::exception_ptr error;
+    try {
+      task(threadIndex);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      if (error && !this->firstError) { this->firstError = std::move(error); }
+      error = nullptr;
+      this->pendingTasks--;
+      if (this->pendingTasks == 0) { this->tasksFinished.notify_all(); }
+    }
+  }
+}
+
+}  // namespace hep
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "types.hpp"
+
+namespace hep {
+
+/**
+ * Fixed size pool of worker threads
+ *
+ * Tasks receive the index of the worker running them, in
+ * [0, getThreadCount()), so callers can keep per-thread state such as
+ * command pools without any locking.
+ *
+ * @note enqueue and wait must be called from the same (owning) thread
+ */
+class ThreadPool {
+ public:
+  using Task = std::function<void(u32 threadIndex)>;
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  explicit ThreadPool(u32 threadCount = defaultThreadCount());
+  ~ThreadPool();
+
+  u32 getThreadCount() const { return static_cast<u32>(this->threads.size()); }
+
+  void enqueue(Task task);
+
+  /**
+   * Blocks until every enqueued task has finished. Rethrows the first
+   * exception thrown by a task, if any.
+   */
+  void wait();
+
+  /** Hardware threads minus the calling thread, at least 1 */
+  static u32 defaultThreadCount();
+
+ private:
+  void workerLoop(u32 threadIndex);
+
+  std::vector<std::thread> threads;
+  std::queue<Task> tasks;
+
+  std::mutex mutex;
+  std::condition_variable taskAvailable;
+  std::condition_variable tasksFinished;
+  u32 pendingTasks = 0;
+  bool stopping = false;
+
+  std::exception_ptr firstError;
+};
+
+}  // namespace hep
@@ -0,0 +1,141 @@
+#include "vertex_layout.hpp"
+
+#include <cassert>
+#include <cstring>
+
+namespace hep {
+
+static u32 attributeSize(VertexLayout::Format format, u32 components) {
+  switch (format) {
+    case VertexLayout::Format::eNone:
+      return 0;
+    case VertexLayout::Format::eFloat32:
+      return 4 * components;
+    case VertexLayout::Format::eFloat16:
+    case VertexLayout::Format::eUnorm8:
+    case VertexLayout::Format::eSnorm8:
+      return 4;
+  }
+  return 0;
+}
+
+static vk::Format attributeFormat(VertexLayout::Format format,
+                                  u32 components) {
+  switch (format) {
+    case VertexLayout::Format::eFloat32:
+      return components == 2 ? vk::Format::eR32G32Sfloat
+                             : vk::Format::eR32G32B32Sfloat;
+    case VertexLayout::Format::eFloat16:
+      return vk::Format::eR16G16Sfloat;
+    case VertexLayout::Format::eUnorm8:
+      return vk::Format::eR8G8B8A8Unorm;
+    case VertexLayout::Format::eSnorm8:
+      return vk::Format::eR8G8B8A8Snorm;
+    default:
+      return vk::Format::eUndefined;
+  }
+}
+
+bool VertexLayout::isValid() const {
+  // Half floats only for the 2 component attributes, 8 bit formats only
+  // for the 3 component ones, which get a padding 4th byte
+  bool positionValid =
+      this->position == Format::eFloat32 || this->position == Format::eFloat16;
+  bool colorValid = this->color == Format::eNone ||
+                    this->color == Format::eFloat32 ||
+                    this->color == Format::eUnorm8;
+  bool normalValid = this->normal == Format::eNone ||
+                     this->normal == Format::eFloat32 ||
+                     this->normal == Format::eSnorm8;
+  bool uvValid = this->uv == Format::eNone || this->uv == Format::eFloat32 ||
+                 this->uv == Format::eFloat16;
+
+  return positionValid && colorValid && normalValid && uvValid;
+}
+
+u32 VertexLayout::getStride() const {
+  return attributeSize(this->position, 2) + attributeSize(this->color, 3) +
+         attributeSize(this->normal, 3) + attributeSize(this->uv, 2);
+}
+
+std::vector<vk::VertexInputBindingDescription>
+VertexLayout::getBindingDescriptions(u32 binding) const {
+  std::vector<vk::VertexInputBindingDescription> bindingDescriptions(1);
+  bindingDescriptions[0].binding = binding;
+  bindingDescriptions[0].stride = getStride();
+  bindingDescriptions[0].inputRate = vk::VertexInputRate::eVertex;
+
+  return bindingDescriptions;
+}
+
+std::vector<vk::VertexInputAttributeDescription>
+VertexLayout::getAttributeDescriptions(u32 binding) const {
+  assert(isValid() && "unsupported vertex attribute format");
+
+  std::vector<vk::VertexInputAttributeDescription> attributeDescriptions{};
+
+  struct Attribute {
+    u32 location;
+    Format format;
+    u32 components;
+  };
+  const Attribute attributes[] = {{POSITION_LOCATION, this->position, 2},
+                                  {COLOR_LOCATION, this->color, 3},
+                                  {NORMAL_LOCATION, this->normal, 3},
+                                  {UV_LOCATION, this->uv, 2}};
+
+  u32 offset = 0;
+  for (const Attribute& attribute : attributes) {
+    if (attribute.format == Format::eNone) { continue; }
+
+    attributeDescriptions.push_back(
+        {attribute.location, binding,
+         attributeFormat(attribute.format, attribute.components), offset});
+    offset += attributeSize(attribute.format, attribute.components);
+  }
+
+  return attributeDescriptions;
+}
+
+void VertexLayout::write(u8* dst,
+                         const glm::vec2& position,
+                         const glm::vec3& color,
+                         const glm::vec3& normal,
+                         const glm::vec2& uv) const {
+  assert(isValid() && "unsupported vertex attribute format");
+
+  auto put = [&dst](const void* data, size_t size) {
+    std::memcpy(dst, data, size);
+    dst += size;
+  };
+
+  if (this->position == Format::eFloat16) {
+    u32 packed = glm::packHalf2x16(position);
+    put(&packed, sizeof(packed));
+  } else {
+    put(&position, sizeof(position));
+  }
+
+  if (this->color == Format::eUnorm8) {
+    u32 packed = glm::packUnorm4x8(glm::vec4(color, 1.0f));
+    put(&packed, sizeof(packed));
+  } else if (this->color == Format::eFloat32) {
+    put(&color, sizeof(color));
+  }
+
+  if (this->normal == Format::eSnorm8) {
+    u32 packed = glm::packSnorm4x8(glm::vec4(normal, 0.0f));
+    put(&packed, sizeof(packed));
+  } else if (this->normal == Format::eFloat32) {
+    put(&normal, sizeof(normal));
+  }
+
+  if (this->uv == Format::eFloat16) {
+    u32 packed = glm::packHalf2x16(uv);
+    put(&packed, sizeof(packed));
+  } else if (this->uv == Format::eFloat32) {
+    put(&uv, sizeof(uv));
+  }
+}
+
+}  // namespace hep
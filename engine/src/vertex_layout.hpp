@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "types.hpp"
+
+namespace hep {
+
+/**
+ * GPU encoding of a vertex, one format per attribute
+ *
+ * Attributes keep fixed locations (position 0, color 1, normal 2, uv 3) and
+ * are read as floats in shaders whatever the format, so quantizing a mesh
+ * only requires a pipeline built from the same layout. Every attribute is
+ * padded to 4 bytes.
+ *
+ * Position and uv may be half floats, colors 8 bit unorm and normals 8 bit
+ * snorm. compact() stores today's vec2 + vec3 vertex in 8 bytes instead of
+ * 20.
+ */
+struct VertexLayout {
+  enum class Format : u8 { eNone, eFloat32, eFloat16, eUnorm8, eSnorm8 };
+
+  static constexpr u32 POSITION_LOCATION = 0;
+  static constexpr u32 COLOR_LOCATION = 1;
+  static constexpr u32 NORMAL_LOCATION = 2;
+  static constexpr u32 UV_LOCATION = 3;
+
+  // eFloat32 or eFloat16, 2 components
+  Format position = Format::eFloat32;
+  // eNone, eFloat32 or eUnorm8, 3 components
+  Format color = Format::eFloat32;
+  // eNone, eFloat32 or eSnorm8, 3 components
+  Format normal = Format::eNone;
+  // eNone, eFloat32 or eFloat16, 2 components
+  Format uv = Format::eNone;
+
+  /** Full precision position and color, the original Model::Vertex */
+  static VertexLayout standard() { return VertexLayout{}; }
+
+  /** Half float position and unorm color */
+  static VertexLayout compact() {
+    VertexLayout layout{};
+    layout.position = Format::eFloat16;
+    layout.color = Format::eUnorm8;
+    return layout;
+  }
+
+  /** Checks every attribute uses one of the formats listed above */
+  bool isValid() const;
+
+  u32 getStride() const;
+
+  std::vector<vk::VertexInputBindingDescription> getBindingDescriptions(
+      u32 binding = 0) const;
+  std::vector<vk::VertexInputAttributeDescription> getAttributeDescriptions(
+      u32 binding = 0) const;
+
+  /** Encodes one vertex into getStride() bytes at dst */
+  void write(u8* dst,
+             const glm::vec2& position,
+             const glm::vec3& color,
+             const glm::vec3& normal,
+             const glm::vec2& uv) const;
+
+  bool operator==(const VertexLayout& other) const {
+    return this->position == other.position && this->color == other.color &&
+           this->normal == other.normal && this->uv == other.uv;
+  }
+};
+
+}  // namespace hep
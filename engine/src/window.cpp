@@ -5,18 +5,31 @@
 
 namespace hep {
 
-Window::Window(int width, int height, const std::string& name)
-    : width{width}, height{height}, name{name} {
+Window::Window(int width, int height, const std::string& name, bool headless)
+    : width{width}, height{height}, headless{headless}, name{name} {
+  if (this->headless) {
+    log::info("Running headless, no window will be created");
+    return;
+  }
+
   initialize();
 }
 
 Window::~Window() {
+  if (this->headless) { return; }
+
   glfwDestroyWindow(window);
   glfwTerminate();
 }
 
 void Window::createSurface(const vk::Instance& instance,
                            vk::SurfaceKHR& surface) {
+  if (this->headless) {
+    log::fatal("cannot create vk::SurfaceKHR for a headless window");
+    throw std::runtime_error(
+        "cannot create vk::SurfaceKHR for a headless window");
+  }
+
   VkSurfaceKHR rawSurface;
   if (glfwCreateWindowSurface(static_cast<VkInstance>(instance), window,
                               nullptr, &rawSurface) != VK_SUCCESS) {
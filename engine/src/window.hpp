@@ -16,10 +16,21 @@ class Window {
   Window(const Window&) = delete;
   Window& operator=(const Window&) = delete;
 
-  Window(int width, int height, const std::string& name = "hephaestus");
+  /**
+   * @param headless when true no GLFW window is created, the Window only
+   * carries the render extent and the Device skips surface creation
+   */
+  Window(int width,
+         int height,
+         const std::string& name = "hephaestus",
+         bool headless = false);
   ~Window();
 
-  bool shouldClose() { return glfwWindowShouldClose(window); }
+  bool shouldClose() {
+    return !this->headless && glfwWindowShouldClose(window);
+  }
+
+  bool isHeadless() const { return this->headless; }
 
   int getWidth() const { return this->width; }
   int getHeight() const { return this->height; }
@@ -44,8 +55,9 @@ class Window {
 
   int width, height;
   bool resized = false;
+  bool headless;
   std::string name;
-  GLFWwindow* window;
+  GLFWwindow* window = nullptr;
 };
 
 }  // namespace hep
@@ -1,10 +1,13 @@
 #include <imgui.h>
 
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
 #include "application.hpp"
+#include "benchmark.hpp"
 #include "panel.hpp"
+#include "testbed_scene.hpp"
 
 class DebugPanel : public hep::Panel {
  public:
@@ -66,14 +69,65 @@ class TestbedPanel : public hep::Panel {
   }
 };
 
+struct Benchmark {
+  const char* name;
+  int (*run)(hep::Application& app);
+};
+
+static const Benchmark BENCHMARKS[] = {
+    {"buffers", testbed::runBufferBenchmark},
+    {"models", testbed::runModelBenchmark},
+    {"recording", testbed::runRecordingBenchmark},
+    {"instancing", testbed::runInstancingBenchmark},
+    {"import", testbed::runImportBenchmark},
+};
+
+static int runBenchmark(const char* name) {
+  for (const Benchmark& benchmark : BENCHMARKS) {
+    if (std::strcmp(benchmark.name, name) != 0) { continue; }
+
+    // Room for the 100k instance stream of the instancing benchmark
+    hep::Application app{{.width = 750,
+                          .height = 1000,
+                          .name = "Hep",
+                          .headless = true,
+                          .frameAllocatorSize = 16ull * 1024 * 1024}};
+    return benchmark.run(app);
+  }
+
+  std::cerr << "unknown benchmark " << name << ", available:";
+  for (const Benchmark& benchmark : BENCHMARKS) {
+    std::cerr << ' ' << benchmark.name;
+  }
+  std::cerr << '\n';
+  return EXIT_FAILURE;
+}
+
 int main(int argc, const char** argv) {
-  (void)argc;
-  (void)argv;
   std::cout << __FILE__ << "::" << __LINE__ << '\n';
 
-  hep::Application app{{.width = 750, .height = 1000, .name = "Hep"}};
+  // --headless renders a fixed number of offscreen frames and exits,
+  // --bench <name> runs one of BENCHMARKS instead of the testbed
+  bool headless = false;
+  const char* benchmark = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--headless") == 0) {
+      headless = true;
+    } else if (std::strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+      benchmark = argv[++i];
+    }
+  }
+
+  if (benchmark) { return runBenchmark(benchmark); }
+
+  hep::Application app{{.width = 750,
+                        .height = 1000,
+                        .name = "Hep",
+                        .headless = headless,
+                        .frameLimit = headless ? 1000u : 0u}};
 
   app.registerPanel(std::make_unique<TestbedPanel>());
+  app.setScene(std::make_unique<testbed::TestbedScene>(app));
 
   app.run();
 
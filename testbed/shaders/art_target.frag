@@ -0,0 +1,18 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "bindless.glsl"
+
+layout (location = 0) in vec2 uv;
+
+layout (location = 0) out vec4 outColor;
+
+// ShaderArtRenderSystem::TargetPushConstants
+layout (push_constant) uniform Push {
+  uint image;
+  uint samp;
+} push;
+
+void main() {
+  outColor = bindlessSample(push.image, push.samp, uv);
+}
@@ -0,0 +1,29 @@
+// Global resource table, see BindlessTable. Include with
+// GL_GOOGLE_include_directive and pass indices through push constants,
+// art_target.frag is an example:
+//
+//   vec4 c = texture(sampler2D(bindlessImages[nonuniformEXT(push.image)],
+//                              bindlessSamplers[push.sampler]), uv);
+//
+// The #include is resolved by glslc when shaders are compiled offline,
+// runtime compilation through Shader::compile has no includer.
+
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Bindings must match BindlessTable::*_BINDING
+layout (set = 0, binding = 0) uniform texture2D bindlessImages[];
+layout (set = 0, binding = 1) uniform sampler bindlessSamplers[];
+
+// Storage buffers are exposed as raw words, for typed access declare
+// another unsized block array on set 0 binding 2 aliasing the same slots
+layout (set = 0, binding = 2) readonly buffer BindlessWords {
+  uint words[];
+} bindlessBuffers[];
+
+const uint BINDLESS_INVALID_INDEX = 0xffffffffu;
+
+vec4 bindlessSample(uint image, uint samp, vec2 uv) {
+  return texture(sampler2D(bindlessImages[nonuniformEXT(image)],
+                           bindlessSamplers[nonuniformEXT(samp)]),
+                 uv);
+}
@@ -0,0 +1,35 @@
+#version 450
+
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec3 color;
+
+layout (location = 0) out vec3 fragColor;
+
+// Must match IndirectRenderSystem::DrawRecord
+struct DrawRecord {
+  mat4 transform;
+  vec4 color;
+  vec4 boundingSphere;
+  uint indexCount;
+  uint firstIndex;
+  int vertexOffset;
+  uint padding;
+};
+
+layout (set = 0, binding = 0) readonly buffer Records {
+  DrawRecord records[];
+};
+
+layout (push_constant) uniform Push {
+  mat4 transform;
+  vec4 color;
+  vec4 data;
+} push;
+
+void main() {
+  // cull.comp stores the record index as firstInstance
+  DrawRecord record = records[gl_InstanceIndex];
+
+  gl_Position = push.transform * record.transform * vec4(position, 0.0, 1.0);
+  fragColor = color * record.color.rgb;
+}
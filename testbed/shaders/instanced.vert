@@ -0,0 +1,15 @@
+#version 450
+
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec3 color;
+
+// Model::InstanceData, a mat4 spans locations 4 to 7
+layout (location = 4) in mat4 instanceTransform;
+layout (location = 8) in vec4 instanceColor;
+
+layout (location = 0) out vec3 fragColor;
+
+void main() {
+  gl_Position = instanceTransform * vec4(position, 0.0, 1.0);
+  fragColor = color * instanceColor.rgb;
+}
@@ -0,0 +1,37 @@
+#include "benchmark.hpp"
+
+#include <random>
+
+namespace testbed {
+
+std::unique_ptr<hep::BasicRenderSystem> createBasicRenderSystem(
+    hep::Application& app) {
+  hep::Device& device = app.getDevice();
+  hep::Renderer& renderer = app.getRenderer();
+
+  if (device.isDynamicRenderingEnabled()) {
+    return std::make_unique<hep::BasicRenderSystem>(
+        device, renderer.getSwapChainImageFormat(),
+        renderer.getSwapChainDepthFormat());
+  }
+  return std::make_unique<hep::BasicRenderSystem>(
+      device, renderer.getSwapChainRenderPass());
+}
+
+std::vector<hep::Model::InstanceData> createQuadInstances(u32 count,
+                                                          u64 seed) {
+  std::mt19937_64 rng{seed};
+  std::uniform_real_distribution<f32> position{-1.0f, 1.0f};
+  std::uniform_real_distribution<f32> channel{0.2f, 1.0f};
+
+  std::vector<hep::Model::InstanceData> instances(count);
+  for (auto& instance : instances) {
+    // Uniform scale of 0.01, translation in the last column
+    instance.transform = glm::mat4{0.01f};
+    instance.transform[3] = {position(rng), position(rng), 0.0f, 1.0f};
+    instance.color = {channel(rng), channel(rng), channel(rng), 1.0f};
+  }
+  return instances;
+}
+
+}  // namespace testbed
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "application.hpp"
+#include "systems/basic_render_system.hpp"
+
+namespace testbed {
+
+using hep::f32;
+using hep::f64;
+using hep::u32;
+using hep::u64;
+
+/** Wall clock time since construction or the last restart */
+class Stopwatch {
+ public:
+  Stopwatch() { restart(); }
+
+  void restart() { this->start = Clock::now(); }
+
+  double milliseconds() const {
+    return std::chrono::duration<double, std::milli>(Clock::now() -
+                                                     this->start)
+        .count();
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  Clock::time_point start;
+};
+
+/** For the swapchain pass, against its render pass or its formats */
+std::unique_ptr<hep::BasicRenderSystem> createBasicRenderSystem(
+    hep::Application& app);
+
+/** count small quads scattered over the screen, the same for a given seed */
+std::vector<hep::Model::InstanceData> createQuadInstances(u32 count,
+                                                          u64 seed);
+
+/*
+ Benchmark modes, selected with --bench <name>. Each one gets a headless
+ Application, prints its results to stdout and returns the exit code.
+*/
+
+/** Creates and destroys tens of thousands of buffers through the Allocator */
+int runBufferBenchmark(hep::Application& app);
+
+/**
+ * Model creation throughput, blocking copies per buffer against batched
+ * TransferContext uploads
+ */
+int runModelBenchmark(hep::Application& app);
+
+/** CPU time to record thousands of draws as secondaries on 1..N threads */
+int runRecordingBenchmark(hep::Application& app);
+
+/**
+ * GPU and CPU frame time of 1k, 10k and 100k quads drawn with per draw push
+ * constants and with one instanced draw
+ */
+int runInstancingBenchmark(hep::Application& app);
+
+/**
+ * MeshLoader throughput on generated multi million triangle OBJ and GLB
+ * files, on 1..N loader threads. Doesn't touch the device.
+ */
+int runImportBenchmark(hep::Application& app);
+
+}  // namespace testbed
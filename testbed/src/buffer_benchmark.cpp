@@ -0,0 +1,155 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "buffer.hpp"
+
+namespace testbed {
+
+static constexpr u32 BUFFER_COUNT = 50000;
+static constexpr u32 CHURN_ROUNDS = 4;
+static constexpr u64 SEED = 0x5eed;
+
+static const vk::BufferUsageFlags USAGE =
+    vk::BufferUsageFlagBits::eVertexBuffer |
+    vk::BufferUsageFlagBits::eTransferDst;
+
+// Mostly small buffers with a long tail, 256 B to 32 KiB
+static std::vector<vk::DeviceSize> randomSizes(u32 count,
+                                               std::mt19937_64& rng) {
+  std::uniform_int_distribution<u32> shift{8, 14};
+
+  std::vector<vk::DeviceSize> sizes(count);
+  for (auto& size : sizes) {
+    vk::DeviceSize base = 1ull << shift(rng);
+    size = base + rng() % base;
+  }
+  return sizes;
+}
+
+static void printRate(const char* label, u32 count, double ms) {
+  std::printf("  %-34s %8u in %9.2f ms  %8.2f us each  %10.0f /s\n", label,
+              count, ms, ms * 1000.0 / count, count / (ms / 1000.0));
+}
+
+static void printHeapStats(hep::Device& device) {
+  for (const auto& heap : device.getAllocator().getHeapStats()) {
+    if (heap.reservedBytes == 0) { continue; }
+
+    std::printf(
+        "  heap %u: %u blocks, %u dedicated, %u allocations, %.1f / %.1f "
+        "MiB used, largest free %.1f MiB, fragmentation %.3f\n",
+        heap.heapIndex, heap.blockCount, heap.dedicatedCount,
+        heap.allocationCount, heap.usedBytes / 1048576.0,
+        heap.reservedBytes / 1048576.0, heap.largestFreeRange / 1048576.0,
+        heap.fragmentation);
+  }
+}
+
+/**
+ * One vkAllocateMemory per buffer, what Device::createBuffer did before
+ * the Allocator. Capped at half of maxMemoryAllocationCount.
+ */
+static void runDedicatedBaseline(hep::Device& device,
+                                 const std::vector<vk::DeviceSize>& sizes,
+                                 vk::MemoryPropertyFlags properties) {
+  vk::Device handle = *device.get();
+
+  u32 count = std::min<u32>(
+      static_cast<u32>(sizes.size()),
+      device.properties.limits.maxMemoryAllocationCount / 2);
+
+  std::vector<vk::Buffer> buffers(count);
+  std::vector<vk::DeviceMemory> memories(count);
+
+  Stopwatch stopwatch;
+  for (u32 i = 0; i < count; i++) {
+    buffers[i] = handle.createBuffer({vk::BufferCreateFlags(), sizes[i], USAGE,
+                                      vk::SharingMode::eExclusive});
+
+    vk::MemoryRequirements requirements =
+        handle.getBufferMemoryRequirements(buffers[i]);
+    memories[i] = handle.allocateMemory(
+        {requirements.size,
+         device.findMemoryType(requirements.memoryTypeBits, properties)});
+    handle.bindBufferMemory(buffers[i], memories[i], 0);
+  }
+  printRate("vkAllocateMemory per buffer", count, stopwatch.milliseconds());
+
+  stopwatch.restart();
+  for (u32 i = 0; i < count; i++) {
+    handle.destroyBuffer(buffers[i]);
+    handle.freeMemory(memories[i]);
+  }
+  printRate("vkFreeMemory per buffer", count, stopwatch.milliseconds());
+}
+
+static void runAllocator(hep::Device& device,
+                         const std::vector<vk::DeviceSize>& sizes,
+                         vk::MemoryPropertyFlags properties,
+                         std::mt19937_64& rng) {
+  auto count = static_cast<u32>(sizes.size());
+  std::vector<std::unique_ptr<hep::Buffer>> buffers(count);
+
+  Stopwatch stopwatch;
+  for (u32 i = 0; i < count; i++) {
+    buffers[i] =
+        std::make_unique<hep::Buffer>(device, sizes[i], 1, USAGE, properties);
+  }
+  printRate("Allocator create", count, stopwatch.milliseconds());
+
+  // Free a random half and refill it with new sizes, so the free-lists see
+  // scattered holes instead of stack order
+  std::vector<u32> order(count);
+  for (u32 i = 0; i < count; i++) { order[i] = i; }
+
+  for (u32 round = 0; round < CHURN_ROUNDS; round++) {
+    std::shuffle(order.begin(), order.end(), rng);
+    std::vector<vk::DeviceSize> churnSizes = randomSizes(count / 2, rng);
+
+    stopwatch.restart();
+    for (u32 i = 0; i < count / 2; i++) { buffers[order[i]].reset(); }
+    for (u32 i = 0; i < count / 2; i++) {
+      buffers[order[i]] = std::make_unique<hep::Buffer>(
+          device, churnSizes[i], 1, USAGE, properties);
+    }
+    printRate("Allocator churn destroy + create", count,
+              stopwatch.milliseconds());
+  }
+
+  printHeapStats(device);
+
+  stopwatch.restart();
+  buffers.clear();
+  printRate("Allocator destroy", count, stopwatch.milliseconds());
+}
+
+int runBufferBenchmark(hep::Application& app) {
+  hep::Device& device = app.getDevice();
+  std::mt19937_64 rng{SEED};
+
+  std::vector<vk::DeviceSize> sizes = randomSizes(BUFFER_COUNT, rng);
+
+  struct MemoryKind {
+    const char* name;
+    vk::MemoryPropertyFlags properties;
+  };
+  const MemoryKind kinds[] = {
+      {"device local", vk::MemoryPropertyFlagBits::eDeviceLocal},
+      {"host visible", vk::MemoryPropertyFlagBits::eHostVisible |
+                           vk::MemoryPropertyFlagBits::eHostCoherent}};
+
+  for (const MemoryKind& kind : kinds) {
+    std::printf("%u %s buffers\n", BUFFER_COUNT, kind.name);
+    runDedicatedBaseline(device, sizes, kind.properties);
+    runAllocator(device, sizes, kind.properties, rng);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+}  // namespace testbed
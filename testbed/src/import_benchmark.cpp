@@ -0,0 +1,219 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "mesh_loader.hpp"
+#include "util/file_io.hpp"
+
+namespace testbed {
+
+// Vertices per side of the generated grid, about 2.9M triangles
+static constexpr u32 GRID_SIZE = 1201;
+static constexpr u32 RUNS = 3;
+
+static constexpr u32 GLB_MAGIC = 0x46546c67;
+static constexpr u32 GLB_CHUNK_JSON = 0x4e4f534a;
+static constexpr u32 GLB_CHUNK_BIN = 0x004e4942;
+
+static f32 gridCoordinate(u32 i) {
+  return static_cast<f32>(i) / (GRID_SIZE - 1) * 2.0f - 1.0f;
+}
+
+template <typename Emit>
+static void forEachTriangle(Emit emit) {
+  for (u32 y = 0; y + 1 < GRID_SIZE; y++) {
+    for (u32 x = 0; x + 1 < GRID_SIZE; x++) {
+      u32 i = y * GRID_SIZE + x;
+      emit(i, i + GRID_SIZE, i + GRID_SIZE + 1);
+      emit(i, i + GRID_SIZE + 1, i + 1);
+    }
+  }
+}
+
+/** Positions with vertex colors and triangle faces, 1 based indices */
+static std::string createObj() {
+  std::string text;
+  char line[96];
+
+  for (u32 y = 0; y < GRID_SIZE; y++) {
+    for (u32 x = 0; x < GRID_SIZE; x++) {
+      int length = std::snprintf(
+          line, sizeof(line), "v %.6f %.6f 0 %.4f %.4f 1\n", gridCoordinate(x),
+          gridCoordinate(y), static_cast<f32>(x) / (GRID_SIZE - 1),
+          static_cast<f32>(y) / (GRID_SIZE - 1));
+      text.append(line, length);
+    }
+  }
+
+  forEachTriangle([&](u32 a, u32 b, u32 c) {
+    int length =
+        std::snprintf(line, sizeof(line), "f %u %u %u\n", a + 1, b + 1, c + 1);
+    text.append(line, length);
+  });
+
+  return text;
+}
+
+/** One primitive with float positions and colors and 32 bit indices */
+static std::vector<hep::u8> createGlb() {
+  u32 vertexCount = GRID_SIZE * GRID_SIZE;
+  u32 indexCount = (GRID_SIZE - 1) * (GRID_SIZE - 1) * 6;
+
+  std::vector<f32> attributes;
+  attributes.reserve(static_cast<size_t>(vertexCount) * 6);
+  for (u32 y = 0; y < GRID_SIZE; y++) {
+    for (u32 x = 0; x < GRID_SIZE; x++) {
+      attributes.insert(attributes.end(),
+                        {gridCoordinate(x), gridCoordinate(y), 0.0f,
+                         static_cast<f32>(x) / (GRID_SIZE - 1),
+                         static_cast<f32>(y) / (GRID_SIZE - 1), 1.0f});
+    }
+  }
+
+  std::vector<u32> indices;
+  indices.reserve(indexCount);
+  forEachTriangle([&](u32 a, u32 b, u32 c) {
+    indices.insert(indices.end(), {a, b, c});
+  });
+
+  // Interleaved positions and colors in the first view, indices in the
+  // second
+  u32 attributeBytes = static_cast<u32>(attributes.size() * sizeof(f32));
+  u32 indexBytes = static_cast<u32>(indices.size() * sizeof(u32));
+
+  std::string json =
+      "{\"asset\":{\"version\":\"2.0\"},"
+      "\"buffers\":[{\"byteLength\":" +
+      std::to_string(attributeBytes + indexBytes) +
+      "}],"
+      "\"bufferViews\":["
+      "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" +
+      std::to_string(attributeBytes) +
+      ",\"byteStride\":24},"
+      "{\"buffer\":0,\"byteOffset\":" +
+      std::to_string(attributeBytes) +
+      ",\"byteLength\":" + std::to_string(indexBytes) +
+      "}],"
+      "\"accessors\":["
+      "{\"bufferView\":0,\"byteOffset\":0,\"componentType\":5126,"
+      "\"count\":" +
+      std::to_string(vertexCount) +
+      ",\"type\":\"VEC3\"},"
+      "{\"bufferView\":0,\"byteOffset\":12,\"componentType\":5126,"
+      "\"count\":" +
+      std::to_string(vertexCount) +
+      ",\"type\":\"VEC3\"},"
+      "{\"bufferView\":1,\"componentType\":5125,\"count\":" +
+      std::to_string(indexCount) +
+      ",\"type\":\"SCALAR\"}],"
+      "\"meshes\":[{\"primitives\":[{\"attributes\":"
+      "{\"POSITION\":0,\"COLOR_0\":1},\"indices\":2}]}]}";
+  // Chunks are 4 byte aligned, JSON is padded with spaces
+  json.resize((json.size() + 3) & ~size_t{3}, ' ');
+
+  u32 jsonLength = static_cast<u32>(json.size());
+  u32 binLength = attributeBytes + indexBytes;
+  u32 totalLength = 12 + 8 + jsonLength + 8 + binLength;
+
+  std::vector<hep::u8> data(totalLength);
+  hep::u8* out = data.data();
+  auto write = [&](const void* source, size_t size) {
+    std::memcpy(out, source, size);
+    out += size;
+  };
+  auto writeU32 = [&](u32 value) { write(&value, sizeof(value)); };
+
+  writeU32(GLB_MAGIC);
+  writeU32(2);
+  writeU32(totalLength);
+  writeU32(jsonLength);
+  writeU32(GLB_CHUNK_JSON);
+  write(json.data(), jsonLength);
+  writeU32(binLength);
+  writeU32(GLB_CHUNK_BIN);
+  write(attributes.data(), attributeBytes);
+  write(indices.data(), indexBytes);
+
+  return data;
+}
+
+/** 1, 2, 4, ... up to and including the default pool size */
+static std::vector<u32> getThreadCounts() {
+  u32 maxThreads = hep::ThreadPool::defaultThreadCount();
+  std::vector<u32> counts;
+  for (u32 threads = 1; threads < maxThreads; threads *= 2) {
+    counts.push_back(threads);
+  }
+  counts.push_back(maxThreads);
+  return counts;
+}
+
+static void benchmarkFile(const std::filesystem::path& path, u64 fileBytes) {
+  std::printf("%s, %.1f MB\n", path.filename().string().c_str(),
+              fileBytes / (1024.0 * 1024.0));
+
+  double singleThreadMs = 0.0;
+  for (u32 threads : getThreadCounts()) {
+    hep::MeshLoader loader{threads};
+    hep::Model::Builder builder{};
+
+    // Warms the page cache and the builder's capacity
+    loader.load(path, builder);
+
+    double totalMs = 0.0;
+    for (u32 run = 0; run < RUNS; run++) {
+      Stopwatch stopwatch;
+      loader.load(path, builder);
+      totalMs += stopwatch.milliseconds();
+    }
+
+    double average = totalMs / RUNS;
+    if (threads == 1) { singleThreadMs = average; }
+
+    double triangles = builder.indicies.size() / 3.0;
+    std::printf(
+        "  %2u threads  %9.2f ms  %6.2fx  %7.2f Mtris/s  %7.1f MB/s\n",
+        threads, average, singleThreadMs / average,
+        triangles / (average * 1000.0),
+        fileBytes / (1024.0 * 1024.0) / (average / 1000.0));
+  }
+}
+
+int runImportBenchmark(hep::Application&) {
+  std::filesystem::path directory = std::filesystem::temp_directory_path();
+  std::filesystem::path objPath = directory / "hep_import_benchmark.obj";
+  std::filesystem::path glbPath = directory / "hep_import_benchmark.glb";
+
+  std::printf("%ux%u vertex grid, %u triangles, average of %u loads\n",
+              GRID_SIZE, GRID_SIZE, (GRID_SIZE - 1) * (GRID_SIZE - 1) * 2,
+              RUNS);
+
+  int result = EXIT_SUCCESS;
+  try {
+    std::string obj = createObj();
+    std::vector<hep::u8> glb = createGlb();
+    if (!hep::writeBinaryFileAtomic(objPath, obj.data(), obj.size()) ||
+        !hep::writeBinaryFileAtomic(glbPath, glb.data(), glb.size())) {
+      throw std::runtime_error("failed to write the generated meshes");
+    }
+
+    benchmarkFile(objPath, obj.size());
+    benchmarkFile(glbPath, glb.size());
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "import benchmark failed: %s\n", e.what());
+    result = EXIT_FAILURE;
+  }
+
+  std::error_code error;
+  std::filesystem::remove(objPath, error);
+  std::filesystem::remove(glbPath, error);
+
+  return result;
+}
+
+}  // namespace testbed
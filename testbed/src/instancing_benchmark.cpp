@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+
+#include "benchmark.hpp"
+
+namespace testbed {
+
+static constexpr u32 INSTANCE_COUNTS[] = {1000, 10000, 100000};
+// More than MAX_FRAMES_IN_FLIGHT, GpuProfiler results lag that many frames
+static constexpr u32 WARMUP_FRAMES = 10;
+static constexpr u32 MEASURED_FRAMES = 100;
+static constexpr u64 SEED = 0x5eed;
+
+/**
+ * Draws every count of INSTANCE_COUNTS with BasicRenderSystem::renderPerDraw
+ * and then renderInstanced, each in its own GpuProfiler zone
+ */
+class InstancingBenchmarkScene : public hep::Scene {
+ public:
+  explicit InstancingBenchmarkScene(hep::Application& app)
+      : app{app}, renderSystem{createBasicRenderSystem(app)} {
+    startStep();
+  }
+
+  void onRender(vk::CommandBuffer commandBuffer,
+                hep::FrameInfo frameInfo) override {
+    const char* zoneName = this->instanced ? "instanced" : "push constants";
+
+    Stopwatch stopwatch;
+    {
+      hep::GpuProfiler::Zone zone{*frameInfo.profiler, commandBuffer,
+                                  zoneName};
+      if (this->instanced) {
+        this->renderSystem->renderInstanced(commandBuffer, frameInfo,
+                                            this->instances);
+      } else {
+        this->renderSystem->renderPerDraw(
+            commandBuffer, frameInfo, this->instances.data(),
+            static_cast<u32>(this->instances.size()));
+      }
+    }
+    double cpuMs = stopwatch.milliseconds();
+
+    if (++this->frame > WARMUP_FRAMES) {
+      this->cpuTotalMs += cpuMs;
+      this->gpuTotalMs += frameInfo.profiler->getZoneMilliseconds(zoneName);
+    }
+    if (this->frame < WARMUP_FRAMES + MEASURED_FRAMES) { return; }
+
+    std::printf("  %6zu quads  %-14s  cpu %8.3f ms  gpu ",
+                this->instances.size(), zoneName,
+                this->cpuTotalMs / MEASURED_FRAMES);
+    if (frameInfo.profiler->isSupported()) {
+      std::printf("%8.3f ms\n", this->gpuTotalMs / MEASURED_FRAMES);
+    } else {
+      std::printf("     n/a\n");
+    }
+
+    if (this->instanced) { this->step++; }
+    this->instanced = !this->instanced;
+
+    if (this->step == std::size(INSTANCE_COUNTS)) {
+      this->app.stop();
+      return;
+    }
+    startStep();
+  }
+
+ private:
+  void startStep() {
+    this->instances = createQuadInstances(INSTANCE_COUNTS[this->step], SEED);
+    this->frame = 0;
+    this->cpuTotalMs = 0.0;
+    this->gpuTotalMs = 0.0;
+  }
+
+  hep::Application& app;
+  std::unique_ptr<hep::BasicRenderSystem> renderSystem;
+  std::vector<hep::Model::InstanceData> instances;
+
+  size_t step = 0;
+  bool instanced = false;
+  u32 frame = 0;
+  double cpuTotalMs = 0.0;
+  double gpuTotalMs = 0.0;
+};
+
+int runInstancingBenchmark(hep::Application& app) {
+  std::printf("Average frame time over %u frames, cpu is recording only\n",
+              MEASURED_FRAMES);
+
+  app.setScene(std::make_unique<InstancingBenchmarkScene>(app));
+  app.run();
+
+  return EXIT_SUCCESS;
+}
+
+}  // namespace testbed
@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "benchmark.hpp"
+
+namespace testbed {
+
+static constexpr u32 DRAW_COUNT = 20000;
+static constexpr u32 WARMUP_FRAMES = 10;
+static constexpr u32 MEASURED_FRAMES = 100;
+static constexpr u64 SEED = 0x5eed;
+
+/**
+ * Records DRAW_COUNT push constant draws split across 1, 2, ... N chunks,
+ * N being the Renderer's recording thread count, and times
+ * recordSecondaryCommandBuffers on the host
+ */
+class RecordingBenchmarkScene : public hep::Scene {
+ public:
+  explicit RecordingBenchmarkScene(hep::Application& app)
+      : app{app},
+        renderSystem{createBasicRenderSystem(app)},
+        instances{createQuadInstances(DRAW_COUNT, SEED)},
+        maxThreads{app.getRenderer().getRecordingThreadCount()} {}
+
+  vk::SubpassContents getSubpassContents() const override {
+    return vk::SubpassContents::eSecondaryCommandBuffers;
+  }
+
+  void onRender(vk::CommandBuffer commandBuffer,
+                hep::FrameInfo frameInfo) override {
+    hep::Renderer& renderer = this->app.getRenderer();
+    u32 chunks = this->threads;
+
+    Stopwatch stopwatch;
+    std::vector<vk::CommandBuffer> secondaries =
+        renderer.recordSecondaryCommandBuffers(
+            chunks, [&](vk::CommandBuffer secondary, u32 chunk) {
+              u32 begin = DRAW_COUNT * chunk / chunks;
+              u32 end = DRAW_COUNT * (chunk + 1) / chunks;
+              this->renderSystem->renderPerDraw(
+                  secondary, frameInfo, this->instances.data() + begin,
+                  end - begin);
+            });
+    double ms = stopwatch.milliseconds();
+
+    renderer.executeSecondaryCommandBuffers(commandBuffer, secondaries);
+
+    if (++this->frame > WARMUP_FRAMES) { this->totalMs += ms; }
+    if (this->frame < WARMUP_FRAMES + MEASURED_FRAMES) { return; }
+
+    double average = this->totalMs / MEASURED_FRAMES;
+    if (this->threads == 1) { this->singleThreadMs = average; }
+
+    std::printf("  %2u threads  %8.3f ms  %6.2fx  %8.0f draws/ms\n",
+                this->threads, average, this->singleThreadMs / average,
+                DRAW_COUNT / average);
+
+    this->frame = 0;
+    this->totalMs = 0.0;
+    if (++this->threads > this->maxThreads) { this->app.stop(); }
+  }
+
+ private:
+  hep::Application& app;
+  std::unique_ptr<hep::BasicRenderSystem> renderSystem;
+  std::vector<hep::Model::InstanceData> instances;
+
+  u32 maxThreads;
+  u32 threads = 1;
+  u32 frame = 0;
+  double totalMs = 0.0;
+  double singleThreadMs = 0.0;
+};
+
+int runRecordingBenchmark(hep::Application& app) {
+  std::printf("%u draws recorded as secondaries, average of %u frames\n",
+              DRAW_COUNT, MEASURED_FRAMES);
+
+  app.setScene(std::make_unique<RecordingBenchmarkScene>(app));
+  app.run();
+
+  return EXIT_SUCCESS;
+}
+
+}  // namespace testbed
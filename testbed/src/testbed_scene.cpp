@@ -0,0 +1,126 @@
+#include "testbed_scene.hpp"
+
+#include <cmath>
+#include <numbers>
+
+#include "benchmark.hpp"
+
+namespace testbed {
+
+// Tessellation of each disc, fine enough for several LODs
+static constexpr u32 DISC_RINGS = 48;
+static constexpr u32 DISC_SEGMENTS = 192;
+static constexpr u32 DISC_COLUMNS = 6;
+static constexpr u32 DISC_ROWS = 8;
+// Model space scale the discs pulse between, a few pixels to about a
+// hundred across at the default window height
+static constexpr f32 DISC_MIN_SCALE = 0.01f;
+static constexpr f32 DISC_MAX_SCALE = 0.12f;
+
+TestbedScene::TestbedScene(hep::Application& app) : app{app} {
+  hep::Device& device = app.getDevice();
+  hep::Renderer& renderer = app.getRenderer();
+
+  this->basicRenderSystem = createBasicRenderSystem(app);
+  createDisc();
+
+  this->shaderArt = std::make_unique<hep::ShaderArtRenderSystem>(
+      device, renderer.getCurrentFramebufferExtent(),
+      renderer.getBindlessTable());
+
+  // Without descriptor indexing the art is still rendered, just not shown
+  if (!renderer.getBindlessTable()) { return; }
+
+  if (device.isDynamicRenderingEnabled()) {
+    this->shaderArt->createTargetPipeline(renderer.getSwapChainImageFormat(),
+                                          renderer.getSwapChainDepthFormat());
+  } else {
+    this->shaderArt->createTargetPipeline(renderer.getSwapChainRenderPass());
+  }
+}
+
+void TestbedScene::createDisc() {
+  constexpr f32 PI = std::numbers::pi_v<f32>;
+  hep::Model::Builder builder{};
+
+  // White center fading into a hue wheel on the rim
+  builder.vertices.push_back({{0.0f, 0.0f}, {1.0f, 1.0f, 1.0f}});
+  for (u32 ring = 1; ring <= DISC_RINGS; ring++) {
+    f32 radius = static_cast<f32>(ring) / DISC_RINGS;
+    for (u32 segment = 0; segment < DISC_SEGMENTS; segment++) {
+      f32 angle = 2.0f * PI * segment / DISC_SEGMENTS;
+      glm::vec3 hue = 0.5f + 0.5f * glm::vec3{std::cos(angle),
+                                              std::cos(angle + PI * 2 / 3),
+                                              std::cos(angle + PI * 4 / 3)};
+      builder.vertices.push_back(
+          {{radius * std::cos(angle), radius * std::sin(angle)},
+           glm::mix(glm::vec3{1.0f}, hue, radius)});
+    }
+  }
+
+  auto ringVertex = [](u32 ring, u32 segment) {
+    return 1 + (ring - 1) * DISC_SEGMENTS + segment % DISC_SEGMENTS;
+  };
+
+  for (u32 segment = 0; segment < DISC_SEGMENTS; segment++) {
+    builder.indicies.insert(builder.indicies.end(),
+                            {0, ringVertex(1, segment + 1),
+                             ringVertex(1, segment)});
+  }
+  for (u32 ring = 2; ring <= DISC_RINGS; ring++) {
+    for (u32 segment = 0; segment < DISC_SEGMENTS; segment++) {
+      u32 a = ringVertex(ring - 1, segment);
+      u32 b = ringVertex(ring - 1, segment + 1);
+      u32 c = ringVertex(ring, segment);
+      u32 d = ringVertex(ring, segment + 1);
+      builder.indicies.insert(builder.indicies.end(), {a, b, d, a, d, c});
+    }
+  }
+
+  builder.optimize();
+  builder.generateLods();
+
+  this->disc = std::make_unique<hep::Model>(this->app.getDevice(), builder);
+  this->discs.resize(DISC_COLUMNS * DISC_ROWS);
+}
+
+void TestbedScene::updateDiscs(f32 elapsedTime) {
+  for (u32 row = 0; row < DISC_ROWS; row++) {
+    for (u32 column = 0; column < DISC_COLUMNS; column++) {
+      u32 i = row * DISC_COLUMNS + column;
+
+      // Phases spread over the grid so discs cross LOD thresholds at
+      // different times
+      f32 pulse = 0.5f + 0.5f * std::sin(elapsedTime * 0.8f + i * 0.7f);
+      f32 scale = glm::mix(DISC_MIN_SCALE, DISC_MAX_SCALE, pulse);
+
+      hep::Model::InstanceData& instance = this->discs[i];
+      instance.transform = glm::mat4{scale};
+      instance.transform[3] = {
+          (column + 0.5f) / DISC_COLUMNS * 1.6f - 0.8f,
+          (row + 0.5f) / DISC_ROWS * 1.6f - 0.8f, 0.0f, 1.0f};
+    }
+  }
+}
+
+void TestbedScene::onPrepare(vk::CommandBuffer commandBuffer,
+                             hep::FrameInfo frameInfo) {
+  hep::Renderer& renderer = this->app.getRenderer();
+
+  this->shaderArt->resize(renderer.getCurrentFramebufferExtent());
+  this->shaderArt->render(commandBuffer, frameInfo);
+}
+
+void TestbedScene::onRender(vk::CommandBuffer commandBuffer,
+                            hep::FrameInfo frameInfo) {
+  if (frameInfo.bindless) {
+    this->shaderArt->renderTarget(commandBuffer, frameInfo);
+  }
+
+  updateDiscs(frameInfo.elapsedTime);
+  this->basicRenderSystem->renderInstanced(commandBuffer, frameInfo,
+                                           *this->disc, this->discs,
+                                           this->discLods);
+}
+
+}  // namespace testbed
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "application.hpp"
+#include "model.hpp"
+#include "systems/basic_render_system.hpp"
+#include "systems/shader_art_render_system.hpp"
+
+namespace testbed {
+
+/**
+ * What the testbed draws without --bench: the shader art, rendered
+ * offscreen and drawn behind the UI through the BindlessTable, and a grid
+ * of finely tessellated discs pulsing in size. The discs go through
+ * Model::Builder::generateLods and BasicRenderSystem's LOD path, their
+ * LODs are kept across frames so the hysteresis is exercised.
+ */
+class TestbedScene : public hep::Scene {
+ public:
+  explicit TestbedScene(hep::Application& app);
+
+  void onPrepare(vk::CommandBuffer commandBuffer,
+                 hep::FrameInfo frameInfo) override;
+  void onRender(vk::CommandBuffer commandBuffer,
+                hep::FrameInfo frameInfo) override;
+
+ private:
+  void createDisc();
+  void updateDiscs(hep::f32 elapsedTime);
+
+  hep::Application& app;
+
+  std::unique_ptr<hep::ShaderArtRenderSystem> shaderArt;
+  std::unique_ptr<hep::BasicRenderSystem> basicRenderSystem;
+
+  std::unique_ptr<hep::Model> disc;
+  std::vector<hep::Model::InstanceData> discs;
+  // Each disc's LOD from the previous frame, see Model::selectLod
+  std::vector<hep::u32> discLods;
+};
+
+}  // namespace testbed